@@ -0,0 +1,187 @@
+/*
+ * 一次性到达 50 个 map request（会话恢复）时，逐个处理与批量处理的对比。
+ *
+ * 用一个计数用的 backend 替换 X11 backend：事件全部已经在队列中，
+ * backend_apply_effect 按 X11 backend 的方式合并同一窗口的 configure，
+ * 统计刷新次数与最终发出的 X 请求数。逐个处理模式下 backend_poll_event
+ * 每返回一个事件就返回一次空，相当于逐个事件布局并刷新。
+ *
+ * backend 的 fd 是写端已关闭的管道，事件循环第一次等待就会看到连接断开，
+ * 处理完全部事件后 runtime_run 返回。
+ */
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "base/memory.h"
+#include "bench.h"
+#include "core/backend.h"
+#include "core/event.h"
+#include "core/layout.h"
+#include "core/plan.h"
+#include "core/runtime.h"
+#include "core/types.h"
+#include "core/wm_desc.h"
+#include "layouts/fair.h"
+
+static constexpr size_t WINDOW_COUNT = 50;
+static constexpr size_t ROUND_COUNT  = 200;
+
+struct backend_t {
+  bool batch;
+  bool yielded; /* 逐个处理模式下刚刚返回过一个事件 */
+  size_t next_window;
+  int fds[2];
+
+  size_t flushes;
+  size_t effects;
+  size_t requests;
+};
+
+backend_t *backend_create(const char *display_name) { return nullptr; }
+void backend_destroy(backend_t *backend) {}
+backend_detect_t *backend_detect(backend_t *backend) { return nullptr; }
+void backend_detect_destroy(backend_detect_t *detect) {}
+
+static bool bench_backend_map_request(backend_t *backend, event_t *event) {
+  if (backend->next_window == WINDOW_COUNT) return false;
+
+  auto e      = &event->as.window_map_request;
+  event->type = ZDWM_EVENT_WINDOW_MAP_REQUEST;
+  e->window   = bench_window_id(backend->next_window++);
+  e->rect     = (rect_t){.x = 0, .y = 0, .width = 640, .height = 480};
+  return true;
+}
+
+bool backend_next_event(backend_t *backend, event_t *event) {
+  return bench_backend_map_request(backend, event);
+}
+
+bool backend_poll_event(backend_t *backend, event_t *event) {
+  if (!backend->batch) {
+    backend->yielded = !backend->yielded;
+    if (!backend->yielded) return false;
+  }
+  return bench_backend_map_request(backend, event);
+}
+
+int backend_get_fd(const backend_t *backend) { return backend->fds[0]; }
+int backend_poll_timeout(const backend_t *backend) { return -1; }
+
+/* 与 X11 backend 一致：同一窗口的多个 configure 在一次应用中合并为一个请求 */
+bool backend_apply_effect(
+  backend_t *backend,
+  const effect_t *effects,
+  size_t effect_count
+) {
+  window_id_t configured[WINDOW_COUNT];
+  size_t configured_count = 0;
+
+  for (size_t i = 0; i < effect_count; ++i) {
+    const effect_t *e = &effects[i];
+    switch (e->type) {
+    case ZDWM_EFFECT_CONFIGURE_WINDOW: {
+      bool merged = false;
+      for (size_t j = 0; j < configured_count && !merged; ++j) {
+        merged = configured[j] == e->as.configure.window;
+      }
+      if (!merged) configured[configured_count++] = e->as.configure.window;
+    } break;
+    case ZDWM_EFFECT_MAP_WINDOW:
+      backend->requests += 2; /* ChangeWindowAttributes + MapWindow */
+      break;
+    case ZDWM_EFFECT_RESTACK_WINDOWS:
+      backend->requests += e->as.restack_windows.count;
+      break;
+    default:
+      backend->requests++;
+      break;
+    }
+  }
+
+  backend->requests += configured_count;
+  backend->effects  += effect_count;
+  backend->flushes++;
+  return true;
+}
+
+void backend_set_title_refresh_interval(
+  backend_t *backend,
+  uint32_t interval_ms
+) {}
+void backend_get_stats(const backend_t *backend, backend_stats_t *stats) {
+  *stats = (backend_stats_t){0};
+}
+
+static void bench_runtime_init(runtime_t *runtime, backend_t *backend) {
+  static const layout_id_t layout_ids[] = {0};
+
+  output_info_t output = {
+    .name     = "bench",
+    .geometry = {.x = 0, .y = 0, .width = 1920, .height = 1080},
+  };
+
+  workspace_desc_t *workspace  = p_new(workspace_desc_t, 1);
+  workspace->name              = p_strdup("bench");
+  workspace->layout_ids        = p_copy(layout_ids, 1);
+  workspace->layout_count      = 1;
+  workspace->initial_layout_id = 0;
+
+  runtime_init_desc_t desc = {
+    .backend         = backend,
+    .outputs         = &output,
+    .output_count    = 1,
+    .workspaces      = workspace,
+    .workspace_count = 1,
+  };
+  layout_register(&desc.layouts, "fair", "[F]", nullptr, fair);
+
+  if (!runtime_init(runtime, &desc)) {
+    fprintf(stderr, "runtime_init failed\n");
+  }
+  runtime_init_desc_cleanup(&desc);
+}
+
+static void bench_mode(const char *name, bool batch) {
+  backend_t total     = {0};
+  uint64_t eliminated = 0;
+  uint64_t start      = bench_now_ns();
+  for (size_t round = 0; round < ROUND_COUNT; ++round) {
+    backend_t backend = {.batch = batch};
+    runtime_t runtime = {0};
+    if (pipe(backend.fds) != 0) return;
+    close(backend.fds[1]);
+
+    bench_runtime_init(&runtime, &backend);
+    runtime_run(&runtime);
+    eliminated += runtime.effects_eliminated;
+    runtime_shutdown(&runtime);
+    close(backend.fds[0]);
+
+    total.flushes  += backend.flushes;
+    total.effects  += backend.effects;
+    total.requests += backend.requests;
+  }
+  uint64_t elapsed = bench_now_ns() - start;
+
+  printf(
+    "%-10s %4zu flushes  %6zu effects (%4" PRIu64 " eliminated)  "
+    "%6zu X requests  %8.2f us/round\n",
+    name,
+    total.flushes / ROUND_COUNT,
+    total.effects / ROUND_COUNT,
+    eliminated / ROUND_COUNT,
+    total.requests / ROUND_COUNT,
+    (double)elapsed / 1000.0 / (double)ROUND_COUNT
+  );
+}
+
+int main(void) {
+  printf("%zu queued map requests per round\n", WINDOW_COUNT);
+  bench_mode("per-event", false);
+  bench_mode("batched", true);
+
+  return 0;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "core/state.h"
+#include "core/types.h"
+#include "core/wm_desc.h"
+
+static inline uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* xorshift32，保证每次运行的访问序列一致 */
+static inline uint32_t bench_rand(uint32_t *seed) {
+  uint32_t x  = *seed;
+  x          ^= x << 13;
+  x          ^= x >> 17;
+  x          ^= x << 5;
+  *seed       = x;
+  return x;
+}
+
+/*
+ * 模拟 X 服务器分配的稀疏窗口 id：每个客户端占用一段资源基址，
+ * 基址内的窗口 id 递增。
+ */
+static inline window_id_t bench_window_id(size_t index) {
+  static constexpr size_t clients = 32;
+  uint32_t client                 = (uint32_t)(index % clients) + 1;
+  uint32_t serial                 = (uint32_t)(index / clients) + 1;
+  return (client << 21) | (serial * 3);
+}
+
+/* 单 output、单 workspace 的最小 state */
+static inline void bench_state_init(state_t *state, size_t workspace_count) {
+  static const layout_id_t layout_ids[] = {0};
+
+  output_info_t output = {
+    .name     = "bench",
+    .geometry = {.x = 0, .y = 0, .width = 1920, .height = 1080},
+  };
+
+  workspace_desc_t workspaces[workspace_count];
+  for (size_t i = 0; i < workspace_count; ++i) {
+    workspaces[i] = (workspace_desc_t){
+      .output_index      = 0,
+      .name              = "bench",
+      .layout_ids        = layout_ids,
+      .layout_count      = 1,
+      .initial_layout_id = 0,
+    };
+  }
+
+  state_init(state, &output, 1, workspaces, workspace_count);
+}
+
+static inline void bench_state_add_windows(
+  state_t *state,
+  size_t count,
+  size_t workspace_count
+) {
+  for (size_t i = 0; i < count; ++i) {
+    window_info_t info = {
+      .id            = bench_window_id(i),
+      .transient_for = ZDWM_WINDOW_ID_INVALID,
+      .frame_rect    = {.x = 0, .y = 0, .width = 640, .height = 480},
+      .class_name    = "bench",
+      .instance_name = "bench",
+      .layer_type    = ZDWM_WINDOW_LAYER_NORMAL,
+    };
+    state_window_add(state, &info);
+    state_window_set_workspace(
+      state,
+      info.id,
+      (workspace_id_t)(i % workspace_count)
+    );
+  }
+}
@@ -0,0 +1,177 @@
+/*
+ * 用回放 backend 驱动完整的 runtime：policy、布局、state 与副作用生成，
+ * 不需要 X 服务器。
+ *
+ *   zdwm-bench [trace [effect-log]]
+ *
+ * 不指定 trace 时生成一份固定种子的合成 trace：先接管一批窗口，之后混合
+ * 指针进入、configure 请求、标题变化与窗口的关闭和新建，每若干个事件一批。
+ * 指定 effect-log 时把收到的副作用写入该文件，两次运行的结果可以直接比较。
+ */
+#define _GNU_SOURCE /* open_memstream */
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "backend/replay/replay.h"
+#include "base/memory.h"
+#include "bench.h"
+#include "core/backend.h"
+#include "core/layout.h"
+#include "core/runtime.h"
+#include "core/types.h"
+#include "core/wm_desc.h"
+#include "layouts/fair.h"
+
+static constexpr size_t WINDOW_COUNT = 64;
+static constexpr size_t EVENT_COUNT  = 1000000;
+static constexpr size_t BATCH_SIZE   = 16;
+
+static void bench_trace_map(FILE *out, size_t index) {
+  fprintf(
+    out,
+    "map 0x%x 0 0 640 480 class=bench instance=bench title=bench\n",
+    bench_window_id(index)
+  );
+}
+
+static char *bench_trace_generate(size_t *size) {
+  char *text = nullptr;
+  FILE *out  = open_memstream(&text, size);
+  if (!out) return nullptr;
+
+  /* live[] 为当前存在的窗口，关闭一个窗口后用新的窗口顶替其位置 */
+  size_t live[WINDOW_COUNT];
+  size_t next_index = 0;
+  for (size_t i = 0; i < WINDOW_COUNT; ++i) {
+    live[i] = next_index++;
+    bench_trace_map(out, live[i]);
+  }
+  fputs("sync\n", out);
+
+  uint32_t seed = 0x9e3779b9u;
+  for (size_t i = 0; i < EVENT_COUNT; ++i) {
+    size_t slot        = bench_rand(&seed) % WINDOW_COUNT;
+    window_id_t window = bench_window_id(live[slot]);
+    uint32_t kind      = bench_rand(&seed) % 16;
+    if (kind < 9) {
+      fprintf(out, "enter 0x%x\n", window);
+    } else if (kind < 12) {
+      fprintf(
+        out,
+        "configure 0x%x x=%u y=%u width=%u height=%u\n",
+        window,
+        bench_rand(&seed) % 1280,
+        bench_rand(&seed) % 720,
+        320 + bench_rand(&seed) % 640,
+        240 + bench_rand(&seed) % 360
+      );
+    } else if (kind < 14) {
+      fprintf(out, "title 0x%x bench %u\n", window, bench_rand(&seed));
+    } else {
+      fprintf(out, "remove 0x%x destroy\n", window);
+      live[slot] = next_index++;
+      bench_trace_map(out, live[slot]);
+    }
+
+    if ((i + 1) % BATCH_SIZE == 0) fputs("sync\n", out);
+  }
+
+  fclose(out);
+  return text;
+}
+
+static bool bench_runtime_init(runtime_t *runtime, backend_t *backend) {
+  static const layout_id_t layout_ids[] = {0};
+
+  backend_detect_t *detect = backend_detect(backend);
+  size_t count             = detect->output_count;
+
+  workspace_desc_t *workspaces = p_new(workspace_desc_t, count);
+  for (size_t i = 0; i < count; ++i) {
+    workspaces[i] = (workspace_desc_t){
+      .output_index      = i,
+      .name              = p_strdup("bench"),
+      .layout_ids        = p_copy(layout_ids, 1),
+      .layout_count      = 1,
+      .initial_layout_id = 0,
+    };
+  }
+
+  runtime_init_desc_t desc = {
+    .backend         = backend,
+    .outputs         = detect->outputs,
+    .output_count    = count,
+    .workspaces      = workspaces,
+    .workspace_count = count,
+  };
+  layout_register(&desc.layouts, "fair", "[F]", nullptr, fair);
+
+  bool inited = runtime_init(runtime, &desc);
+  runtime_init_desc_cleanup(&desc);
+  backend_detect_destroy(detect);
+  return inited;
+}
+
+int main(int argc, char *argv[]) {
+  const char *trace_path = argc > 1 ? argv[1] : nullptr;
+  const char *log_path   = argc > 2 ? argv[2] : nullptr;
+
+  uint64_t start     = bench_now_ns();
+  backend_t *backend = nullptr;
+  if (trace_path) {
+    backend = backend_create(trace_path);
+  } else {
+    size_t size = 0;
+    char *text  = bench_trace_generate(&size);
+    if (text) backend = replay_backend_create_from_text(text, size);
+    free(text);
+  }
+  if (!backend) {
+    fprintf(stderr, "cannot load trace\n");
+    return 1;
+  }
+  uint64_t loaded = bench_now_ns();
+
+  FILE *log = nullptr;
+  if (log_path) {
+    log = fopen(log_path, "w");
+    if (!log) {
+      fprintf(stderr, "cannot open %s\n", log_path);
+      backend_destroy(backend);
+      return 1;
+    }
+    replay_backend_record(backend, log);
+  }
+
+  runtime_t runtime = {0};
+  if (!bench_runtime_init(&runtime, backend)) {
+    fprintf(stderr, "runtime_init failed\n");
+    if (log) fclose(log);
+    return 1;
+  }
+
+  runtime_run(&runtime);
+  uint64_t finished = bench_now_ns();
+
+  size_t events       = replay_backend_event_count(runtime.backend);
+  uint64_t elapsed    = finished - loaded;
+  uint64_t eliminated = runtime.effects_eliminated;
+  runtime_shutdown(&runtime);
+  if (log) fclose(log);
+
+  printf(
+    "%zu events  load %.2f ms  run %.2f ms  %.0f events/s  "
+    "%" PRIu64 " effects eliminated\n",
+    events,
+    (double)(loaded - start) / 1e6,
+    (double)elapsed / 1e6,
+    elapsed ? (double)events * 1e9 / (double)elapsed : 0.0,
+    eliminated
+  );
+
+  return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * state_window_get() 查找开销随窗口数量的变化。
+ *
+ * 对每个窗口规模随机查找固定次数，输出单次查找的平均耗时；
+ * 哈希索引下该值应基本不随窗口数量增长。
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "base/memory.h"
+#include "bench.h"
+#include "core/state.h"
+#include "core/types.h"
+
+static constexpr size_t LOOKUP_COUNT = 4000000;
+
+static void bench_lookup(size_t window_count) {
+  state_t state = {0};
+  bench_state_init(&state, 1);
+  bench_state_add_windows(&state, window_count, 1);
+
+  window_id_t *keys = p_new(window_id_t, LOOKUP_COUNT);
+  uint32_t seed     = 0x9e3779b9u;
+  for (size_t i = 0; i < LOOKUP_COUNT; ++i) {
+    keys[i] = bench_window_id(bench_rand(&seed) % window_count);
+  }
+
+  size_t found   = 0;
+  uint64_t start = bench_now_ns();
+  for (size_t i = 0; i < LOOKUP_COUNT; ++i) {
+    if (state_window_get(&state, keys[i])) found++;
+  }
+  uint64_t elapsed = bench_now_ns() - start;
+
+  printf(
+    "%8zu windows  %8.2f ns/lookup  (%zu hits)\n",
+    window_count,
+    (double)elapsed / (double)LOOKUP_COUNT,
+    found
+  );
+
+  p_delete(&keys);
+  state_cleanup(&state);
+}
+
+int main(void) {
+  static const size_t sizes[] = {16, 128, 1024, 4096, 16384, 65536};
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+    bench_lookup(sizes[i]);
+  }
+
+  return 0;
+}
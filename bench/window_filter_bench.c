@@ -0,0 +1,145 @@
+/*
+ * 拆分 window_t 冷热数据前后，过滤遍历 10k 窗口的开销。
+ *
+ * legacy_window_t 复刻拆分前的布局：布尔字段各占一字节，元数据字符串
+ * 指针与几何信息混在一起。每一轮遍历统计某个 workspace 中需要参与布局
+ * 的窗口，与 state_get_windows_need_layout_in_workspace 的过滤条件一致。
+ */
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "base/memory.h"
+#include "bench.h"
+#include "core/state.h"
+#include "core/types.h"
+#include "core/window.h"
+
+static constexpr size_t WINDOW_COUNT    = 10000;
+static constexpr size_t WORKSPACE_COUNT = 9;
+static constexpr size_t PASS_COUNT      = 20000;
+
+typedef struct legacy_window_t {
+  window_id_t id;
+  window_id_t transient_for;
+  workspace_id_t workspace_id;
+
+  window_layer_type_t layer;
+  bool fullscreen;
+  bool maximized;
+  bool minimized;
+  bool floating;
+  bool sticky;
+  bool urgent;
+  bool fixed_size;
+  bool skip_taskbar;
+
+  rect_t float_rect;
+  rect_t frame_rect;
+
+  char *title;
+  char *app_id;
+  char *role;
+  char *class_name;
+  char *instance_name;
+
+  uint32_t border_width;
+} legacy_window_t;
+
+static inline bool legacy_window_need_layout(const legacy_window_t *window) {
+  if (window->floating) return false;
+
+  if (window->fullscreen || window->maximized || window->minimized) {
+    return false;
+  }
+
+  return true;
+}
+
+static void report(const char *name, size_t size, uint64_t ns, size_t hits) {
+  printf(
+    "%-18s %3zu bytes/window  %8.2f us/pass  (%zu hits)\n",
+    name,
+    size,
+    (double)ns / 1000.0 / (double)PASS_COUNT,
+    hits
+  );
+}
+
+static void bench_legacy(void) {
+  legacy_window_t *windows = p_new(legacy_window_t, WINDOW_COUNT);
+  for (size_t i = 0; i < WINDOW_COUNT; ++i) {
+    windows[i] = (legacy_window_t){
+      .id            = bench_window_id(i),
+      .workspace_id  = (workspace_id_t)(i % WORKSPACE_COUNT),
+      .layer         = ZDWM_WINDOW_LAYER_NORMAL,
+      .floating      = i % 7 == 0,
+      .frame_rect    = {.x = 0, .y = 0, .width = 640, .height = 480},
+      .class_name    = p_strdup("bench"),
+      .instance_name = p_strdup("bench"),
+    };
+  }
+
+  size_t hits    = 0;
+  uint64_t start = bench_now_ns();
+  for (size_t pass = 0; pass < PASS_COUNT; ++pass) {
+    workspace_id_t workspace_id = (workspace_id_t)(pass % WORKSPACE_COUNT);
+    for (size_t i = 0; i < WINDOW_COUNT; ++i) {
+      const legacy_window_t *window = &windows[i];
+      if (window->workspace_id != workspace_id) continue;
+      if (legacy_window_need_layout(window)) hits++;
+    }
+  }
+  uint64_t elapsed = bench_now_ns() - start;
+  report("legacy window_t", sizeof(legacy_window_t), elapsed, hits);
+
+  for (size_t i = 0; i < WINDOW_COUNT; ++i) {
+    p_delete(&windows[i].class_name);
+    p_delete(&windows[i].instance_name);
+  }
+  p_delete(&windows);
+}
+
+static void bench_state(void) {
+  state_t state = {0};
+  bench_state_init(&state, WORKSPACE_COUNT);
+  bench_state_add_windows(&state, WINDOW_COUNT, WORKSPACE_COUNT);
+  for (size_t i = 0; i < WINDOW_COUNT; i += 7) {
+    state_window_set_floating(&state, bench_window_id(i), true);
+  }
+
+  size_t hits    = 0;
+  uint64_t start = bench_now_ns();
+  for (size_t pass = 0; pass < PASS_COUNT; ++pass) {
+    workspace_id_t workspace_id = (workspace_id_t)(pass % WORKSPACE_COUNT);
+    for (size_t i = 0; i < state.window_slot_count; ++i) {
+      const window_t *window = &state.windows[i];
+      if (window->workspace_id != workspace_id) continue;
+      if (window_need_layout(window)) hits++;
+    }
+  }
+  uint64_t elapsed = bench_now_ns() - start;
+  report("hot window_t", sizeof(window_t), elapsed, hits);
+
+  hits  = 0;
+  start = bench_now_ns();
+  for (size_t pass = 0; pass < PASS_COUNT; ++pass) {
+    workspace_id_t workspace_id = (workspace_id_t)(pass % WORKSPACE_COUNT);
+    for (auto window = state_workspace_window_first(&state, workspace_id);
+         window;
+         window = state_workspace_window_next(&state, window)) {
+      if (window_need_layout(window)) hits++;
+    }
+  }
+  elapsed = bench_now_ns() - start;
+  report("workspace list", sizeof(window_t), elapsed, hits);
+
+  state_cleanup(&state);
+}
+
+int main(void) {
+  bench_legacy();
+  bench_state();
+
+  return 0;
+}
@@ -21,6 +21,12 @@ zdwm_action_fn(const zdwm_action_ctx_t *ctx, const zdwm_action_arg_t *arg);
 
 struct zdwm_action_ctx_t {
   void (*spawn)(const char *command);
+  /* 聚焦当前 workspace 中上一个获得焦点的窗口 */
+  void (*focus_previous)(const zdwm_action_ctx_t *ctx);
+  /* 按最近使用顺序依次聚焦当前 workspace 中的窗口 */
+  void (*focus_next_mru)(const zdwm_action_ctx_t *ctx);
+  /* 供上面的回调使用的私有数据，动作不应访问 */
+  void *userdata;
 };
 
 #if defined(__cplusplus)
@@ -155,6 +155,19 @@ typedef struct zdwm_api_t {
     const char *normal,
     const char *focused
   );
+
+  /**
+   * @brief 设置窗口标题刷新的最小间隔
+   * @details 标题频繁变化的窗口（终端进度输出、浏览器标签页动画等）在
+   * 间隔内只读取一次标题，间隔结束时总会读取最终值；0 表示不限制
+   *
+   * @param builder     配置构建上下文
+   * @param interval_ms 同一窗口两次读取标题的最小间隔，单位毫秒
+   */
+  void (*set_title_refresh_interval)(
+    zdwm_config_builder_t *builder,
+    uint32_t interval_ms
+  );
 } zdwm_api_t;
 
 /**
@@ -0,0 +1,343 @@
+#define _GNU_SOURCE /* pipe2 */
+
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "backend/replay/internal.h"
+#include "backend/replay/replay.h"
+#include "base/log.h"
+#include "base/macros.h"
+#include "base/memory.h"
+#include "core/backend.h"
+#include "core/event.h"
+#include "core/plan.h"
+#include "core/types.h"
+#include "core/window.h"
+
+backend_t *replay_backend_create_from_text(const char *text, size_t size) {
+  backend_t *backend = p_new(backend_t, 1);
+  backend->fd        = -1;
+  if (!replay_trace_parse(&backend->trace, text, size)) {
+    backend_destroy(backend);
+    return nullptr;
+  }
+
+  /* 写端立即关闭：fd 一直可读并报告挂断，事件交完后事件循环随之退出 */
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) != 0) {
+    warn("pipe2 failed");
+    backend_destroy(backend);
+    return nullptr;
+  }
+  close(fds[1]);
+  backend->fd = fds[0];
+  return backend;
+}
+
+static char *replay_read_file(const char *path, size_t *size) {
+  FILE *file = fopen(path, "rb");
+  if (!file) return nullptr;
+
+  size_t capacity = 0;
+  char *text      = nullptr;
+  *size           = 0;
+  for (;;) {
+    if (*size == capacity) {
+      capacity = p_alloc_nr(capacity);
+      p_realloc(&text, capacity);
+    }
+    size_t n  = fread(text + *size, 1, capacity - *size, file);
+    *size    += n;
+    if (n == 0) break;
+  }
+
+  bool failed = ferror(file);
+  fclose(file);
+  if (failed) p_delete(&text);
+  return text;
+}
+
+/* path 为 nullptr 时使用环境变量 ZDWM_TRACE，如同 X11 backend 使用 DISPLAY */
+backend_t *backend_create(const char *path) {
+  if (!path) path = getenv("ZDWM_TRACE");
+  if (!path) {
+    warn("no trace file given");
+    return nullptr;
+  }
+
+  size_t size = 0;
+  char *text  = replay_read_file(path, &size);
+  if (!text) {
+    warn("cannot read trace %s", path);
+    return nullptr;
+  }
+
+  backend_t *backend = replay_backend_create_from_text(text, size);
+  p_delete(&text);
+  return backend;
+}
+
+void backend_destroy(backend_t *backend) {
+  if (!backend) return;
+
+  if (backend->fd >= 0) close(backend->fd);
+  replay_trace_cleanup(&backend->trace);
+  p_delete(&backend);
+}
+
+backend_detect_t *backend_detect(backend_t *backend) {
+  auto trace               = &backend->trace;
+  backend_detect_t *detect = p_new(backend_detect_t, 1);
+  if (!trace->output_count) {
+    output_info_t *output = p_new(output_info_t, 1);
+    output->name          = p_strdup("replay");
+    output->geometry      = (rect_t){.width = 1920, .height = 1080};
+    detect->outputs       = output;
+    detect->output_count  = 1;
+    return detect;
+  }
+
+  detect->outputs      = p_new(output_info_t, trace->output_count);
+  detect->output_count = trace->output_count;
+  for (size_t i = 0; i < trace->output_count; ++i) {
+    detect->outputs[i].name     = p_strdup(trace->outputs[i].name);
+    detect->outputs[i].geometry = trace->outputs[i].geometry;
+  }
+  return detect;
+}
+
+void backend_detect_destroy(backend_detect_t *detect) {
+  if (!detect) return;
+
+  for (size_t i = 0; i < detect->output_count; i++) {
+    p_delete(&detect->outputs[i].name);
+  }
+  p_delete(&detect->outputs);
+  p_delete(&detect);
+}
+
+/* 结构体已整体复制，这里把归 trace 所有的字符串换成调用方自己的副本 */
+static void replay_metadata_dup(window_metadata_t *metadata) {
+  metadata->title         = p_strdup_nullable(metadata->title);
+  metadata->app_id        = p_strdup_nullable(metadata->app_id);
+  metadata->role          = p_strdup_nullable(metadata->role);
+  metadata->class_name    = p_strdup_nullable(metadata->class_name);
+  metadata->instance_name = p_strdup_nullable(metadata->instance_name);
+}
+
+static void replay_take_event(backend_t *backend, event_t *event) {
+  *event = backend->trace.events[backend->next++];
+
+  switch (event->type) {
+  case ZDWM_EVENT_WINDOW_MAP_REQUEST: {
+    auto e   = &event->as.window_map_request;
+    auto src = &e->props;
+    replay_metadata_dup(&e->metadata);
+    e->props.types  = p_copy(src->types, src->type_count);
+    e->props.states = p_copy(src->states, src->state_count);
+  } break;
+  case ZDWM_EVENT_WINDOW_METADATA_CHANGED:
+    replay_metadata_dup(&event->as.window_metadata_change.metadata);
+    break;
+  default:
+    break;
+  }
+}
+
+bool backend_next_event(backend_t *backend, event_t *event) {
+  if (!backend || !event) return false;
+
+  auto trace = &backend->trace;
+  while (backend->sync < trace->sync_count &&
+         trace->syncs[backend->sync] == backend->next) {
+    backend->sync++;
+  }
+  if (backend->next == trace->count) return false;
+
+  replay_take_event(backend, event);
+  return true;
+}
+
+bool backend_poll_event(backend_t *backend, event_t *event) {
+  if (!backend || !event) return false;
+
+  /* 每个批次边界返回一次 false，下一次调用从下一批开始 */
+  auto trace = &backend->trace;
+  if (backend->sync < trace->sync_count &&
+      trace->syncs[backend->sync] == backend->next) {
+    backend->sync++;
+    return false;
+  }
+  if (backend->next == trace->count) return false;
+
+  replay_take_event(backend, event);
+  return true;
+}
+
+int backend_get_fd(const backend_t *backend) {
+  if (!backend) return -1;
+  return backend->fd;
+}
+
+int backend_poll_timeout(const backend_t *backend) { return -1; }
+
+static void replay_record_windows(
+  FILE *out,
+  const char *name,
+  const window_id_t *windows,
+  size_t count
+) {
+  fputs(name, out);
+  for (size_t i = 0; i < count; ++i) fprintf(out, " 0x%x", windows[i]);
+  fputc('\n', out);
+}
+
+static void replay_record_configure(FILE *out, const configure_data_t *data) {
+  static const struct {
+    uint32_t mask;
+    const char *format;
+  } fields[] = {
+    {ZDWM_CONFIGURE_FIELD_X, " x=%" PRId64},
+    {ZDWM_CONFIGURE_FIELD_Y, " y=%" PRId64},
+    {ZDWM_CONFIGURE_FIELD_WIDTH, " width=%" PRId64},
+    {ZDWM_CONFIGURE_FIELD_HEIGHT, " height=%" PRId64},
+    {ZDWM_CONFIGURE_FIELD_BORDER_WIDTH, " border=%" PRId64},
+    {ZDWM_CONFIGURE_FIELD_SIBLING, " sibling=0x%" PRIx64},
+    {ZDWM_CONFIGURE_FIELD_STACK_MODE, " stack_mode=%" PRId64},
+  };
+  const int64_t values[] = {
+    data->x,
+    data->y,
+    data->width,
+    data->height,
+    data->border_width,
+    data->sibling,
+    data->stack_mode,
+  };
+
+  fprintf(out, "configure 0x%x", data->window);
+  for (size_t i = 0; i < countof(fields); ++i) {
+    if (data->changed_fields & fields[i].mask) {
+      fprintf(out, fields[i].format, values[i]);
+    }
+  }
+  fputc('\n', out);
+}
+
+static void replay_record_effect(FILE *out, const effect_t *e) {
+  switch (e->type) {
+  case ZDWM_EFFECT_MAP_WINDOW:
+    fprintf(out, "map 0x%x\n", e->as.map.window);
+    break;
+  case ZDWM_EFFECT_UNMAP_WINDOW:
+    fprintf(out, "unmap 0x%x\n", e->as.unmap.window);
+    break;
+  case ZDWM_EFFECT_FOCUS_WINDOW:
+    fprintf(out, "focus 0x%x\n", e->as.focus.window);
+    break;
+  case ZDWM_EFFECT_KILL_WINDOW:
+    fprintf(out, "kill 0x%x\n", e->as.kill.window);
+    break;
+  case ZDWM_EFFECT_WITHDRAW_WINDOW:
+    fprintf(out, "withdraw 0x%x\n", e->as.withdraw.window);
+    break;
+  case ZDWM_EFFECT_MINIMIZE_WINDOW:
+    fprintf(
+      out,
+      "minimize 0x%x %d\n",
+      e->as.minimize.window,
+      e->as.minimize.value
+    );
+    break;
+  case ZDWM_EFFECT_MAXIMIZE_WINDOW:
+    fprintf(
+      out,
+      "maximize 0x%x %d\n",
+      e->as.maximize.window,
+      e->as.maximize.value
+    );
+    break;
+  case ZDWM_EFFECT_FULLSCREEN_WINDOW:
+    fprintf(
+      out,
+      "fullscreen 0x%x %d\n",
+      e->as.fullscreen.window,
+      e->as.fullscreen.value
+    );
+    break;
+  case ZDWM_EFFECT_CONFIGURE_WINDOW:
+    replay_record_configure(out, &e->as.configure);
+    break;
+  case ZDWM_EFFECT_CHANGE_BORDER_COLOR:
+    fprintf(
+      out,
+      "border 0x%x 0x%08x\n",
+      e->as.change_border_color.window,
+      e->as.change_border_color.color->argb
+    );
+    break;
+  case ZDWM_EFFECT_CHANGE_WINDOW_LIST: {
+    auto list = &e->as.change_window_list;
+    replay_record_windows(out, "window_list", list->windows, list->count);
+  } break;
+  case ZDWM_EFFECT_RESTACK_WINDOWS: {
+    auto restack = &e->as.restack_windows;
+    fputs("restack", out);
+    for (size_t i = 0; i < restack->count; ++i) {
+      auto item = &restack->items[i];
+      fprintf(out, " 0x%x:0x%x", item->window, item->sibling);
+    }
+    fputc('\n', out);
+  } break;
+  case ZDWM_EFFECT_BIND_KEY: {
+    auto bind_key = &e->as.bind_key;
+    fputs("bind_key", out);
+    for (size_t i = 0; i < bind_key->count; ++i) {
+      auto key = &bind_key->keys[i];
+      fprintf(out, " 0x%x:0x%x", key->modifiers, key->keysym);
+    }
+    fputc('\n', out);
+  } break;
+  case ZDWM_EFFECT_WATCH_WINDOW:
+    fprintf(out, "watch 0x%x\n", e->as.watch.window);
+    break;
+  }
+}
+
+bool backend_apply_effect(
+  backend_t *backend,
+  const effect_t *effects,
+  size_t effect_count
+) {
+  auto out = backend->record;
+  if (!out) return true;
+
+  fprintf(out, "apply %zu\n", effect_count);
+  for (size_t i = 0; i < effect_count; ++i) {
+    replay_record_effect(out, &effects[i]);
+  }
+  return true;
+}
+
+void backend_set_title_refresh_interval(
+  backend_t *backend,
+  uint32_t interval_ms
+) {}
+
+/* 不发出任何请求，各项计数恒为 0 */
+void backend_get_stats(const backend_t *backend, backend_stats_t *stats) {
+  *stats = (backend_stats_t){0};
+}
+
+void replay_backend_record(backend_t *backend, FILE *out) {
+  backend->record = out;
+}
+
+size_t replay_backend_event_count(const backend_t *backend) {
+  return backend->next;
+}
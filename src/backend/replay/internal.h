@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "core/backend.h"
+#include "core/event.h"
+#include "core/types.h"
+
+/*
+ * 解析后的 trace。events 中的字符串与数组归 trace 所有，交给调用方时
+ * 复制一份。syncs 为批次边界前的事件数，严格递增。
+ */
+typedef struct replay_trace_t {
+  event_t *events;
+  size_t count;
+  size_t capacity;
+
+  size_t *syncs;
+  size_t sync_count;
+  size_t sync_capacity;
+
+  output_info_t *outputs;
+  size_t output_count;
+  size_t output_capacity;
+} replay_trace_t;
+
+struct backend_t {
+  replay_trace_t trace;
+  size_t next; /* 下一个要交出的事件 */
+  size_t sync; /* 下一个尚未经过的批次边界 */
+
+  /* 写端已关闭的管道读端，供事件循环等待 */
+  int fd;
+
+  FILE *record;
+};
+
+/* 失败时报告行号并返回 false，已解析的内容由 replay_trace_cleanup() 释放 */
+bool replay_trace_parse(replay_trace_t *trace, const char *text, size_t size);
+void replay_trace_cleanup(replay_trace_t *trace);
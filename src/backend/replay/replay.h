@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "core/backend.h"
+
+/**
+ * @file replay.h
+ * @brief 不需要 X 服务器的 backend：从 trace 回放事件，记录收到的副作用。
+ *
+ * 与 X11 backend 实现同一组 core/backend.h 接口，链接时二选一。
+ * backend_create() 的参数是 trace 文件的路径。
+ *
+ * trace 是文本，每行一条，以 `#` 开头的行为注释，数值可以写成十六进制：
+ *
+ *   output <name> <x> <y> <width> <height>
+ *       backend_detect() 报告的 output，没有时为一个 1920x1080 的 output
+ *   map <window> <x> <y> <width> <height> [选项...]
+ *       选项为 transient=<window>、class=、instance=、title=、role=、
+ *       app_id=、type=<窗口类型>、state=above|fullscreen|modal|sticky，
+ *       以及 override_redirect、urgent、fixed_size、fullscreen、maximized、
+ *       minimized、skip_taskbar
+ *   remove <window> [destroy]
+ *   enter <window>
+ *   key <modifiers> <keysym> [keycode]
+ *   configure <window> [x=] [y=] [width=] [height=] [border=]
+ *   title <window> <标题，直到行尾>
+ *   activate <window> [application|pager]
+ *   state <window> <fullscreen|maximized|minimized|skip_taskbar|urgent|
+ *         fixed_size> <add|remove|toggle>
+ *   sync
+ *       批次边界：backend_poll_event() 在此返回一次 false，之前的事件
+ *       作为一批处理
+ *
+ * 全部事件交出后连接视为断开，backend_get_fd() 返回的 fd 报告挂断。
+ */
+
+/** @brief 从内存中的 trace 文本创建，格式错误时返回 nullptr */
+backend_t *replay_backend_create_from_text(const char *text, size_t size);
+
+/**
+ * @brief 把之后收到的副作用逐条写入 out
+ * @details
+ * 每次 backend_apply_effect() 先写一行 `apply <副作用数>`，之后每个副作用
+ * 一行，格式固定，同一 trace 的两次回放可以直接比较。out 为 nullptr 时
+ * 不记录。out 由调用方持有。
+ */
+void replay_backend_record(backend_t *backend, FILE *out);
+
+/** @brief 已经交出的事件数 */
+size_t replay_backend_event_count(const backend_t *backend);
@@ -0,0 +1,433 @@
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend/replay/internal.h"
+#include "base/array.h"
+#include "base/log.h"
+#include "base/macros.h"
+#include "base/memory.h"
+#include "core/event.h"
+#include "core/types.h"
+#include "core/window.h"
+
+typedef struct trace_line_t {
+  char *cursor;
+} trace_line_t;
+
+static const char *const window_type_names[] = {
+  [ZDWM_WINDOW_TYPE_NORMAL]        = "normal",
+  [ZDWM_WINDOW_TYPE_DESKTOP]       = "desktop",
+  [ZDWM_WINDOW_TYPE_DOCK]          = "dock",
+  [ZDWM_WINDOW_TYPE_TOOLBAR]       = "toolbar",
+  [ZDWM_WINDOW_TYPE_DIALOG]        = "dialog",
+  [ZDWM_WINDOW_TYPE_UTILITY]       = "utility",
+  [ZDWM_WINDOW_TYPE_SPLASH]        = "splash",
+  [ZDWM_WINDOW_TYPE_MENU]          = "menu",
+  [ZDWM_WINDOW_TYPE_DROPDOWN_MENU] = "dropdown_menu",
+  [ZDWM_WINDOW_TYPE_POPUP_MENU]    = "popup_menu",
+  [ZDWM_WINDOW_TYPE_TOOLTIP]       = "tooltip",
+  [ZDWM_WINDOW_TYPE_COMBO]         = "combo",
+  [ZDWM_WINDOW_TYPE_DND]           = "dnd",
+  [ZDWM_WINDOW_TYPE_NOTIFICATION]  = "notification",
+};
+
+static const char *const window_state_names[] = {
+  [ZDWM_WINDOW_STATE_ABOVE]      = "above",
+  [ZDWM_WINDOW_STATE_FULLSCREEN] = "fullscreen",
+  [ZDWM_WINDOW_STATE_MODAL]      = "modal",
+  [ZDWM_WINDOW_STATE_STICKY]     = "sticky",
+};
+
+static const char *const state_request_names[] = {
+  [ZDWM_WINDOW_STATE_REQUEST_FULLSCREEN]   = "fullscreen",
+  [ZDWM_WINDOW_STATE_REQUEST_MAXIMIZED]    = "maximized",
+  [ZDWM_WINDOW_STATE_REQUEST_MINIMIZED]    = "minimized",
+  [ZDWM_WINDOW_STATE_REQUEST_SKIP_TASKBAR] = "skip_taskbar",
+  [ZDWM_WINDOW_STATE_REQUEST_URGENT]       = "urgent",
+  [ZDWM_WINDOW_STATE_REQUEST_FIXED_SIZE]   = "fixed_size",
+};
+
+static const char *const state_action_names[] = {
+  [ZDWM_WINDOW_STATE_ACTION_ADD]    = "add",
+  [ZDWM_WINDOW_STATE_ACTION_REMOVE] = "remove",
+  [ZDWM_WINDOW_STATE_ACTION_TOGGLE] = "toggle",
+};
+
+static const char *const activation_source_names[] = {
+  [ZDWM_WINDOW_ACTIVATION_SOURCE_LEGACY]      = "legacy",
+  [ZDWM_WINDOW_ACTIVATION_SOURCE_APPLICATION] = "application",
+  [ZDWM_WINDOW_ACTIVATION_SOURCE_PAGER]       = "pager",
+};
+
+static bool trace_lookup(
+  const char *const *names,
+  size_t count,
+  const char *token,
+  uint32_t *out
+) {
+  if (!token) return false;
+  for (size_t i = 0; i < count; ++i) {
+    if (names[i] && !strcmp(names[i], token)) {
+      *out = (uint32_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+#define TRACE_LOOKUP(names, token, out) \
+  trace_lookup(names, countof(names), token, out)
+
+static void trace_skip_space(trace_line_t *line) {
+  while (*line->cursor == ' ' || *line->cursor == '\t') line->cursor++;
+}
+
+/* 取下一个以空白分隔的词，行已结束时返回 nullptr */
+static char *trace_next_token(trace_line_t *line) {
+  trace_skip_space(line);
+  if (!*line->cursor) return nullptr;
+
+  char *token = line->cursor;
+  while (*line->cursor && *line->cursor != ' ' && *line->cursor != '\t') {
+    line->cursor++;
+  }
+  if (*line->cursor) *line->cursor++ = '\0';
+  return token;
+}
+
+static bool trace_parse_u32(const char *token, uint32_t *out) {
+  if (!token || !*token || *token == '-') return false;
+
+  char *end = nullptr;
+  errno     = 0;
+  auto v    = strtoul(token, &end, 0);
+  if (errno || *end || v > UINT32_MAX) return false;
+  *out = (uint32_t)v;
+  return true;
+}
+
+static bool trace_parse_i32(const char *token, int32_t *out) {
+  if (!token || !*token) return false;
+
+  char *end = nullptr;
+  errno     = 0;
+  auto v    = strtol(token, &end, 0);
+  if (errno || *end || v < INT32_MIN || v > INT32_MAX) return false;
+  *out = (int32_t)v;
+  return true;
+}
+
+static bool trace_parse_window(trace_line_t *line, window_id_t *out) {
+  auto token = trace_next_token(line);
+  return trace_parse_u32(token, out) && !window_id_invalid(*out);
+}
+
+static bool trace_parse_rect(trace_line_t *line, rect_t *out) {
+  return trace_parse_i32(trace_next_token(line), &out->x) &&
+         trace_parse_i32(trace_next_token(line), &out->y) &&
+         trace_parse_i32(trace_next_token(line), &out->width) &&
+         trace_parse_i32(trace_next_token(line), &out->height);
+}
+
+static bool trace_map_flag(window_map_request_event_t *e, const char *name) {
+#define MAP_FLAG(FIELD) {#FIELD, offsetof(window_map_request_event_t, FIELD)}
+
+  static const struct {
+    const char *name;
+    size_t offset;
+  } flags[] = {
+    MAP_FLAG(override_redirect),
+    MAP_FLAG(skip_taskbar),
+    MAP_FLAG(urgent),
+    MAP_FLAG(fixed_size),
+    MAP_FLAG(fullscreen),
+    MAP_FLAG(maximized),
+    MAP_FLAG(minimized),
+  };
+
+#undef MAP_FLAG
+
+  for (size_t i = 0; i < countof(flags); ++i) {
+    if (strcmp(flags[i].name, name)) continue;
+    *(bool *)((char *)e + flags[i].offset) = true;
+    return true;
+  }
+  return false;
+}
+
+static bool trace_map_option(
+  window_map_request_event_t *e,
+  const char *key,
+  const char *value
+) {
+  auto metadata = &e->metadata;
+  auto props    = &e->props;
+
+  char **text = nullptr;
+  if (!strcmp(key, "title")) text = &metadata->title;
+  if (!strcmp(key, "app_id")) text = &metadata->app_id;
+  if (!strcmp(key, "role")) text = &metadata->role;
+  if (!strcmp(key, "class")) text = &metadata->class_name;
+  if (!strcmp(key, "instance")) text = &metadata->instance_name;
+  if (text) {
+    p_delete(text);
+    *text = p_strdup(value);
+    return true;
+  }
+
+  if (!strcmp(key, "transient")) {
+    return trace_parse_u32(value, &e->transient_for);
+  }
+
+  uint32_t index = 0;
+  if (!strcmp(key, "type")) {
+    if (!TRACE_LOOKUP(window_type_names, value, &index)) return false;
+    p_realloc(&props->types, props->type_count + 1);
+    props->types[props->type_count++] = (window_type_t)index;
+    return true;
+  }
+  if (!strcmp(key, "state")) {
+    if (!TRACE_LOOKUP(window_state_names, value, &index)) return false;
+    p_realloc(&props->states, props->state_count + 1);
+    props->states[props->state_count++] = (window_state_t)index;
+    return true;
+  }
+  return false;
+}
+
+static bool trace_parse_map(trace_line_t *line, event_t *event) {
+  event->type      = ZDWM_EVENT_WINDOW_MAP_REQUEST;
+  auto e           = &event->as.window_map_request;
+  e->transient_for = ZDWM_WINDOW_ID_INVALID;
+  if (!trace_parse_window(line, &e->window)) return false;
+  if (!trace_parse_rect(line, &e->rect)) return false;
+
+  for (char *token; (token = trace_next_token(line));) {
+    char *value = strchr(token, '=');
+    if (!value) {
+      if (!trace_map_flag(e, token)) return false;
+      continue;
+    }
+    *value++ = '\0';
+    if (!trace_map_option(e, token, value)) return false;
+  }
+  return true;
+}
+
+static bool trace_parse_remove(trace_line_t *line, event_t *event) {
+  event->type = ZDWM_EVENT_WINDOW_REMOVE;
+  auto e      = &event->as.window_remove;
+  e->reason   = ZDWM_WINDOW_REMOVE_WITHDRAWN;
+  if (!trace_parse_window(line, &e->window)) return false;
+
+  auto reason = trace_next_token(line);
+  if (!reason) return true;
+  if (strcmp(reason, "destroy")) return false;
+  e->reason = ZDWM_WINDOW_REMOVE_DESTROY;
+  return true;
+}
+
+static bool trace_parse_enter(trace_line_t *line, event_t *event) {
+  event->type = ZDWM_EVENT_POINTER_ENTER;
+  return trace_parse_window(line, &event->as.pointer_enter.window);
+}
+
+static bool trace_parse_key(trace_line_t *line, event_t *event) {
+  event->type = ZDWM_EVENT_KEY_PRESS;
+  auto e      = &event->as.key_press;
+  if (!trace_parse_u32(trace_next_token(line), &e->modifiers)) return false;
+  if (!trace_parse_u32(trace_next_token(line), &e->keysym)) return false;
+
+  auto keycode = trace_next_token(line);
+  return !keycode || trace_parse_u32(keycode, &e->keycode);
+}
+
+static bool trace_parse_configure(trace_line_t *line, event_t *event) {
+#define CONFIGURE_FIELD(NAME, MASK, FIELD) \
+  {NAME, MASK, offsetof(configure_data_t, FIELD)}
+
+  static const struct {
+    const char *name;
+    uint32_t mask;
+    size_t offset;
+  } fields[] = {
+    CONFIGURE_FIELD("x", ZDWM_CONFIGURE_FIELD_X, x),
+    CONFIGURE_FIELD("y", ZDWM_CONFIGURE_FIELD_Y, y),
+    CONFIGURE_FIELD("width", ZDWM_CONFIGURE_FIELD_WIDTH, width),
+    CONFIGURE_FIELD("height", ZDWM_CONFIGURE_FIELD_HEIGHT, height),
+    CONFIGURE_FIELD("border", ZDWM_CONFIGURE_FIELD_BORDER_WIDTH, border_width),
+  };
+
+#undef CONFIGURE_FIELD
+
+  event->type = ZDWM_EVENT_CONFIGURE_REQUEST;
+  auto e      = &event->as.configure_request;
+  if (!trace_parse_window(line, &e->window)) return false;
+
+  for (char *token; (token = trace_next_token(line));) {
+    char *value = strchr(token, '=');
+    if (!value) return false;
+    *value++ = '\0';
+
+    size_t i = 0;
+    while (i < countof(fields) && strcmp(fields[i].name, token)) ++i;
+    if (i == countof(fields)) return false;
+
+    /* border_width 为 uint32_t，与其余字段同宽，按 int32_t 读入 */
+    auto slot = (int32_t *)((char *)e + fields[i].offset);
+    if (!trace_parse_i32(value, slot)) return false;
+    e->changed_fields |= fields[i].mask;
+  }
+  return true;
+}
+
+static bool trace_parse_title(trace_line_t *line, event_t *event) {
+  event->type = ZDWM_EVENT_WINDOW_METADATA_CHANGED;
+  auto e      = &event->as.window_metadata_change;
+  if (!trace_parse_window(line, &e->window)) return false;
+
+  trace_skip_space(line);
+  e->changed_fields  = ZDWM_WINDOW_METADATA_CHANGE_TITLE;
+  e->metadata.title  = p_strdup(line->cursor);
+  line->cursor      += strlen(line->cursor);
+  return true;
+}
+
+static bool trace_parse_activate(trace_line_t *line, event_t *event) {
+  event->type = ZDWM_EVENT_WINDOW_ACTIVATE_REQUEST;
+  auto e      = &event->as.window_activate_request;
+  e->source   = ZDWM_WINDOW_ACTIVATION_SOURCE_APPLICATION;
+  if (!trace_parse_window(line, &e->window)) return false;
+
+  auto source    = trace_next_token(line);
+  uint32_t index = 0;
+  if (!source) return true;
+  if (!TRACE_LOOKUP(activation_source_names, source, &index)) return false;
+  e->source = (window_activation_source_t)index;
+  return true;
+}
+
+static bool trace_parse_state(trace_line_t *line, event_t *event) {
+  event->type     = ZDWM_EVENT_WINDOW_STATE_REQUEST;
+  auto e          = &event->as.window_state_request;
+  uint32_t type   = 0;
+  uint32_t action = 0;
+  if (!trace_parse_window(line, &e->window)) return false;
+  if (!TRACE_LOOKUP(state_request_names, trace_next_token(line), &type) ||
+      !TRACE_LOOKUP(state_action_names, trace_next_token(line), &action)) {
+    return false;
+  }
+  e->type   = (window_state_request_type_t)type;
+  e->action = (window_state_request_action_t)action;
+  return true;
+}
+
+static bool trace_parse_output(replay_trace_t *trace, trace_line_t *line) {
+  auto name       = trace_next_token(line);
+  rect_t geometry = {0};
+  if (!name || !trace_parse_rect(line, &geometry)) return false;
+  if (geometry.width <= 0 || geometry.height <= 0) return false;
+
+  output_info_t *output = array_push(
+    trace->outputs,
+    trace->output_count,
+    trace->output_capacity
+  );
+  output->name     = p_strdup(name);
+  output->geometry = geometry;
+  return true;
+}
+
+static void trace_push_sync(replay_trace_t *trace) {
+  /* 开头与连续的 sync 不产生空批次 */
+  if (!trace->count) return;
+  size_t last = trace->sync_count;
+  if (last && trace->syncs[last - 1] == trace->count) return;
+
+  size_t *sync =
+    array_push(trace->syncs, trace->sync_count, trace->sync_capacity);
+  *sync = trace->count;
+}
+
+static bool trace_parse_line(replay_trace_t *trace, trace_line_t *line) {
+  static const struct {
+    const char *name;
+    bool (*fn)(trace_line_t *line, event_t *event);
+  } commands[] = {
+    {"map", trace_parse_map},
+    {"remove", trace_parse_remove},
+    {"enter", trace_parse_enter},
+    {"key", trace_parse_key},
+    {"configure", trace_parse_configure},
+    {"title", trace_parse_title},
+    {"activate", trace_parse_activate},
+    {"state", trace_parse_state},
+  };
+
+  trace_skip_space(line);
+  if (*line->cursor == '#') return true;
+
+  auto name = trace_next_token(line);
+  if (!name) return true;
+
+  if (!strcmp(name, "sync")) {
+    trace_push_sync(trace);
+    return !trace_next_token(line);
+  }
+  if (!strcmp(name, "output")) {
+    return trace_parse_output(trace, line) && !trace_next_token(line);
+  }
+
+  for (size_t i = 0; i < countof(commands); ++i) {
+    if (strcmp(commands[i].name, name)) continue;
+
+    event_t event = {0};
+    if (!commands[i].fn(line, &event) || trace_next_token(line)) {
+      event_cleanup(&event);
+      return false;
+    }
+    event_t *slot = array_push(trace->events, trace->count, trace->capacity);
+    *slot         = event;
+    return true;
+  }
+  return false;
+}
+
+bool replay_trace_parse(replay_trace_t *trace, const char *text, size_t size) {
+  const char *end = text + size;
+  size_t number   = 0;
+  while (text < end) {
+    const char *eol = memchr(text, '\n', (size_t)(end - text));
+    if (!eol) eol = end;
+
+    size_t length = (size_t)(eol - text);
+    if (length && text[length - 1] == '\r') --length;
+
+    char *buffer      = p_strndup(text, length);
+    trace_line_t line = {.cursor = buffer};
+    ++number;
+    bool ok           = trace_parse_line(trace, &line);
+    p_delete(&buffer);
+    if (!ok) {
+      warn("trace line %zu: invalid entry", number);
+      return false;
+    }
+
+    text = eol + 1;
+  }
+  return true;
+}
+
+void replay_trace_cleanup(replay_trace_t *trace) {
+  for (size_t i = 0; i < trace->count; ++i) event_cleanup(&trace->events[i]);
+  p_delete(&trace->events);
+  p_delete(&trace->syncs);
+  for (size_t i = 0; i < trace->output_count; ++i) {
+    p_delete(&trace->outputs[i].name);
+  }
+  p_delete(&trace->outputs);
+  p_clear(trace, 1);
+}
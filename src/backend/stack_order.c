@@ -0,0 +1,130 @@
+#include "backend/stack_order.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "base/array.h"
+#include "base/id_map.h"
+#include "base/memory.h"
+#include "base/window_list.h"
+#include "core/types.h"
+
+static bool stack_order_find(
+  const window_list_t *order,
+  window_id_t window,
+  size_t *index_out
+) {
+  for (size_t i = 0; i < order->count; ++i) {
+    if (order->windows[i] != window) continue;
+    if (index_out) *index_out = i;
+    return true;
+  }
+  return false;
+}
+
+bool stack_order_apply(window_list_t *order, const restack_item_t *move) {
+  if (move->window == move->sibling) return true;
+
+  bool bottom = window_id_invalid(move->sibling);
+  if (!bottom && !stack_order_find(order, move->sibling, nullptr)) {
+    return false;
+  }
+
+  size_t index = 0;
+  if (stack_order_find(order, move->window, &index)) {
+    array_erase(order->windows, order->count, index);
+  }
+
+  size_t at = 0;
+  if (!bottom) {
+    stack_order_find(order, move->sibling, &at);
+    ++at;
+  }
+
+  window_list_push(order, move->window);
+  window_id_t *slot = &order->windows[at];
+  memmove(slot + 1, slot, (order->count - 1 - at) * sizeof(*slot));
+  *slot = move->window;
+  return true;
+}
+
+bool stack_order_remove(window_list_t *order, window_id_t window) {
+  size_t index = 0;
+  if (!stack_order_find(order, window, &index)) return false;
+
+  array_erase(order->windows, order->count, index);
+  return true;
+}
+
+void stack_order_copy(window_list_t *dst, const window_list_t *src) {
+  array_reserve(dst->windows, dst->capacity, src->count);
+  if (src->count) {
+    memcpy(dst->windows, src->windows, src->count * sizeof(*src->windows));
+  }
+  dst->count = src->count;
+}
+
+size_t stack_order_diff(
+  const window_list_t *from,
+  const window_list_t *to,
+  restack_item_t *moves_out
+) {
+  if (!to->count) return 0;
+
+  id_map_t positions = {0};
+  for (size_t i = 0; i < from->count; ++i) {
+    id_map_set(&positions, from->windows[i], (uint32_t)i);
+  }
+
+  /*
+   * 按 to 的顺序取各窗口在 from 中的位置，求其最长递增子序列。
+   * tails[k] 为已找到的长度为 k + 1 的子序列中结尾位置最小的一个，
+   * prev[i] 为以 i 结尾的子序列中 i 的前一项，均为 to 中的下标。
+   */
+  uint32_t *position = p_new(uint32_t, to->count);
+  size_t *tails      = p_new(size_t, to->count);
+  size_t *prev       = p_new(size_t, to->count);
+  bool *keep         = p_new(bool, to->count);
+  size_t length      = 0;
+  for (size_t i = 0; i < to->count; ++i) {
+    if (!id_map_get(&positions, to->windows[i], &position[i])) continue;
+
+    size_t lo = 0;
+    size_t hi = length;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (position[tails[mid]] < position[i]) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    prev[i]   = lo ? tails[lo - 1] : SIZE_MAX;
+    tails[lo] = i;
+    if (lo == length) ++length;
+  }
+  for (size_t i = length ? tails[length - 1] : SIZE_MAX; i != SIZE_MAX;
+       i        = prev[i]) {
+    keep[i] = true;
+  }
+
+  size_t move_count = 0;
+  window_id_t below = ZDWM_WINDOW_ID_INVALID;
+  for (size_t i = 0; i < to->count; ++i) {
+    if (!keep[i]) {
+      moves_out[move_count++] = (restack_item_t){
+        .window  = to->windows[i],
+        .sibling = below,
+      };
+    }
+    below = to->windows[i];
+  }
+
+  p_delete(&keep);
+  p_delete(&prev);
+  p_delete(&tails);
+  p_delete(&position);
+  id_map_cleanup(&positions);
+  return move_count;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "base/window_list.h"
+#include "core/types.h"
+
+/**
+ * @file stack_order.h
+ * @brief backend 记录的窗口堆叠顺序。
+ *
+ * 顺序保存在 window_list_t 中，windows[0] 在最底部。restack 副作用中的移动
+ * 先作用在顺序的副本上得到目标顺序，再由 stack_order_diff() 算出把已提交的
+ * 顺序调整为目标顺序所需的最少移动，只把这些移动发给服务器。
+ */
+
+/**
+ * @brief 在顺序上执行一步移动：window 放到 sibling 正上方
+ *
+ * sibling 为无效 id 时放到最底部。window 不在顺序中时插入。
+ *
+ * @return sibling 有效但不在顺序中时返回 false，顺序保持不变
+ */
+bool stack_order_apply(window_list_t *order, const restack_item_t *move);
+/** @brief 删除 window，window 存在时返回 true */
+bool stack_order_remove(window_list_t *order, window_id_t window);
+void stack_order_copy(window_list_t *dst, const window_list_t *src);
+
+/**
+ * @brief 计算把 from 调整为 to 的最少移动
+ * @details
+ * 两者共有的窗口中，在 from 里相对顺序与 to 一致的最长子序列（最长递增
+ * 子序列）保持不动；其余窗口以及 from 中没有的窗口自底向顶依次放到 to 中
+ * 紧邻其下的窗口之上，最底部的窗口放到最底部（sibling 为无效 id）。
+ *
+ * 只有 to 中的窗口会被移动，只在 from 中的窗口被忽略。
+ *
+ * @param moves_out 按应用顺序写入移动，容量至少为 to->count
+ * @return 写入的移动数
+ */
+size_t stack_order_diff(
+  const window_list_t *from,
+  const window_list_t *to,
+  restack_item_t *moves_out
+);
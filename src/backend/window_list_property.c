@@ -0,0 +1,59 @@
+#include "backend/window_list_property.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "base/array.h"
+#include "base/memory.h"
+#include "base/window_list.h"
+#include "core/types.h"
+
+void window_list_property_set(
+  window_list_property_t *property,
+  const window_id_t *windows,
+  size_t count
+) {
+  auto pending = &property->pending;
+  array_reserve(pending->windows, pending->capacity, count);
+  if (count) memcpy(pending->windows, windows, count * sizeof(*windows));
+  pending->count  = count;
+  property->dirty = true;
+}
+
+bool window_list_property_flush(
+  window_list_property_t *property,
+  window_list_write_t *write_out
+) {
+  if (!property->dirty) return false;
+  property->dirty = false;
+
+  auto published = &property->published;
+  auto pending   = &property->pending;
+  size_t common  = 0;
+  while (common < published->count && common < pending->count &&
+         published->windows[common] == pending->windows[common]) {
+    ++common;
+  }
+
+  bool append   = property->initialized && common == published->count;
+  size_t offset = append ? common : 0;
+  if (append && common == pending->count) return false;
+
+  window_list_t tmp     = *published;
+  *published            = *pending;
+  *pending              = tmp;
+  property->initialized = true;
+
+  *write_out = (window_list_write_t){
+    .append  = append,
+    .windows = published->windows + offset,
+    .count   = published->count - offset,
+  };
+  return true;
+}
+
+void window_list_property_cleanup(window_list_property_t *property) {
+  p_delete(&property->published.windows);
+  p_delete(&property->pending.windows);
+  p_clear(property, 1);
+}
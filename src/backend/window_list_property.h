@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "base/window_list.h"
+#include "core/types.h"
+
+/**
+ * @file window_list_property.h
+ * @brief 根窗口上的窗口列表属性，如 _NET_CLIENT_LIST。
+ *
+ * 一次应用中可能多次要求新的列表，只保留最后一次；应用结束时与已写入的
+ * 内容比较，得出一次写入：已写入的列表是新列表的前缀时（只新增了窗口）
+ * 只追加新增部分，删除或重排了窗口时整体替换，内容不变时不写入。
+ */
+
+typedef struct window_list_property_t {
+  window_list_t published; /* 已写入属性的内容 */
+  window_list_t pending;   /* 本次应用中最后一次要求的内容 */
+  bool dirty;              /* 本次应用中收到过新的内容 */
+  /* 写入过至少一次；此前属性中可能是上一个实例留下的内容，不能追加 */
+  bool initialized;
+} window_list_property_t;
+
+typedef struct window_list_write_t {
+  bool append; /* false 时整体替换 */
+  const window_id_t *windows;
+  size_t count;
+} window_list_write_t;
+
+/** @brief 记录要求的新列表，覆盖本次应用中之前的要求 */
+void window_list_property_set(
+  window_list_property_t *property,
+  const window_id_t *windows,
+  size_t count
+);
+
+/**
+ * @brief 取出需要的写入，并把新列表视为已写入
+ *
+ * @param write_out windows 指向 property 内部，下一次 set 之前有效
+ * @return 不需要写入时返回 false
+ */
+bool window_list_property_flush(
+  window_list_property_t *property,
+  window_list_write_t *write_out
+);
+
+void window_list_property_cleanup(window_list_property_t *property);
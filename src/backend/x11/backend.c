@@ -16,8 +16,11 @@
 #include <xcb/xproto.h>
 
 #include "backend/output_utils.h"
+#include "backend/stack_order.h"
+#include "backend/window_list_property.h"
 #include "backend/x11/window.h"
 #include "base/array.h"
+#include "base/id_map.h"
 #include "base/log.h"
 #include "base/macros.h"
 #include "base/memory.h"
@@ -175,12 +178,25 @@ backend_t *backend_create(const char *display_name) {
 void backend_destroy(backend_t *backend) {
   if (!backend) return;
 
+  backend_events_cleanup(backend);
+
   p_delete(&backend->config_list.cfgs);
+  id_map_cleanup(&backend->config_list.index);
   p_clear(&backend->config_list, 1);
+  p_delete(&backend->geometries.items);
+  id_map_cleanup(&backend->geometries.index);
+  p_clear(&backend->geometries, 1);
+  p_delete(&backend->stack.windows);
+  p_delete(&backend->stack_target.windows);
+  p_delete(&backend->restack_moves);
+  id_map_cleanup(&backend->protocols);
+  window_list_property_cleanup(&backend->client_list);
+  window_list_property_cleanup(&backend->client_list_stacking);
 
   window_list_cleanup(&backend->unmap);
   window_list_cleanup(&backend->map);
   window_list_cleanup(&backend->kill);
+  window_list_cleanup(&backend->watch);
 
   xcb_key_symbols_free(backend->key_symbols);
   backend->key_symbols = nullptr;
@@ -390,78 +406,228 @@ static void backend_focus_window(backend_t *backend, xcb_window_t window) {
   } else {
     uint8_t mode    = XCB_PROP_MODE_REPLACE;
     xcb_atom_t type = XCB_ATOM_WINDOW;
-    xcb_set_input_focus(conn, XCB_INPUT_FOCUS_PARENT, window, time);
+    auto cookie =
+      xcb_set_input_focus(conn, XCB_INPUT_FOCUS_PARENT, window, time);
     xcb_change_property(conn, mode, root, property, type, 32, 1, &window);
+    auto effect = ZDWM_EFFECT_FOCUS_WINDOW;
+    backend_track_request(backend, cookie.sequence, effect, window);
     window_takefocus(backend, window);
   }
 }
 
-static inline void backend_change_window_list(
+static void backend_publish_window_list(
   backend_t *backend,
-  bool stack_list,
-  const effect_window_list_t *list
+  window_list_property_t *property,
+  xcb_atom_t atom
 ) {
+  window_list_write_t write;
+  if (!window_list_property_flush(property, &write)) return;
+
   xcb_change_property(
     backend->conn,
-    XCB_PROP_MODE_REPLACE,
+    write.append ? XCB_PROP_MODE_APPEND : XCB_PROP_MODE_REPLACE,
     backend->screen->root,
-    stack_list ? backend->atoms._NET_CLIENT_LIST_STACKING
-               : backend->atoms._NET_CLIENT_LIST,
+    atom,
     XCB_ATOM_WINDOW,
     32,
-    list->count,
-    list->windows
+    write.count,
+    write.windows
   );
-}
-
-static void
-backend_restack_windows(backend_t *backend, const effect_window_list_t *list) {
-  if (list->count == 0) return;
-
-  xcb_connection_t *conn      = backend->conn;
-  xcb_window_t sibling_window = backend->window_no_focus;
-  for (size_t i = 0; i < list->count; ++i) {
-    uint16_t mask = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
-    xcb_configure_window_value_list_t params = {
-      .sibling    = sibling_window,
-      .stack_mode = XCB_STACK_MODE_ABOVE
-    };
-    sibling_window = list->windows[i];
-    xcb_configure_window_aux(conn, sibling_window, mask, &params);
-  }
+  backend->stats.window_list_bytes += write.count * sizeof(uint32_t);
 }
 
 static void window_configure_list_reset(window_configure_list_t *configs) {
   p_clear(configs->cfgs, configs->count);
   configs->count = 0;
+  id_map_reset(&configs->index);
+}
+
+static constexpr uint32_t WINDOW_GEOMETRY_MASK =
+  XCB_CONFIG_WINDOW_X | XCB_CONFIG_WINDOW_Y | XCB_CONFIG_WINDOW_WIDTH |
+  XCB_CONFIG_WINDOW_HEIGHT | XCB_CONFIG_WINDOW_BORDER_WIDTH;
+
+static window_geometry_t *
+window_geometry_cache_get(window_geometry_cache_t *cache, xcb_window_t window) {
+  uint32_t index = 0;
+  if (id_map_get(&cache->index, window, &index)) return &cache->items[index];
+
+  window_geometry_t *entry =
+    array_push(cache->items, cache->count, cache->capacity);
+  *entry = (window_geometry_t){.window = window};
+  id_map_set(&cache->index, window, (uint32_t)(cache->count - 1));
+  return entry;
+}
+
+void window_geometry_cache_seed(
+  backend_t *backend,
+  xcb_window_t window,
+  const xcb_get_geometry_reply_t *reply
+) {
+  if (!reply) return;
+
+  auto entry   = window_geometry_cache_get(&backend->geometries, window);
+  entry->mask  = WINDOW_GEOMETRY_MASK;
+  entry->value = (xcb_configure_window_value_list_t){
+    .x            = reply->x,
+    .y            = reply->y,
+    .width        = reply->width,
+    .height       = reply->height,
+    .border_width = reply->border_width,
+  };
+}
+
+void window_geometry_cache_forget(backend_t *backend, xcb_window_t window) {
+  auto cache     = &backend->geometries;
+  uint32_t index = 0;
+  if (!id_map_get(&cache->index, window, &index)) return;
+
+  id_map_remove(&cache->index, window);
+  auto last = &cache->items[--cache->count];
+  if (index != cache->count) {
+    cache->items[index] = *last;
+    id_map_set(&cache->index, last->window, index);
+  }
+  p_clear(last, 1);
+}
+
+/*
+ * 去掉与已提交几何相同的字段后发出 ConfigureWindow，并记下发出的值。
+ * sibling 与 stack_mode 不缓存：其他窗口的堆叠变化同样会影响它们的效果。
+ */
+static void
+backend_commit_configure(backend_t *backend, const window_configure_t *cfg) {
+  auto entry    = window_geometry_cache_get(&backend->geometries, cfg->window);
+  uint32_t mask = cfg->mask;
+
+#define FIELD_COMMIT(MASK, FIELD)                                \
+  if (mask & (MASK)) {                                           \
+    auto value = cfg->value.FIELD;                               \
+    if ((entry->mask & (MASK)) && entry->value.FIELD == value) { \
+      mask &= ~(uint32_t)(MASK);                                 \
+    } else {                                                     \
+      entry->mask        |= (MASK);                              \
+      entry->value.FIELD  = value;                               \
+    }                                                            \
+  }
+
+  FIELD_COMMIT(XCB_CONFIG_WINDOW_X, x);
+  FIELD_COMMIT(XCB_CONFIG_WINDOW_Y, y);
+  FIELD_COMMIT(XCB_CONFIG_WINDOW_WIDTH, width);
+  FIELD_COMMIT(XCB_CONFIG_WINDOW_HEIGHT, height);
+  FIELD_COMMIT(XCB_CONFIG_WINDOW_BORDER_WIDTH, border_width);
+
+#undef FIELD_COMMIT
+
+  if (!mask) {
+    backend->stats.configure_requests_skipped++;
+    return;
+  }
+  auto conn   = backend->conn;
+  auto window = cfg->window;
+  auto cookie = xcb_configure_window_aux(conn, window, mask, &cfg->value);
+  auto effect = ZDWM_EFFECT_CONFIGURE_WINDOW;
+  if (mask & XCB_CONFIG_WINDOW_STACK_MODE) effect = ZDWM_EFFECT_RESTACK_WINDOWS;
+  backend_track_request(backend, cookie.sequence, effect, window);
+  backend->stats.configure_requests++;
 }
 
 static void backend_apply_window_configure_list(backend_t *backend) {
-  xcb_connection_t *conn           = backend->conn;
   window_configure_list_t *configs = &backend->config_list;
   for (size_t i = 0; i < configs->count; ++i) {
     window_configure_t *cfg = &configs->cfgs[i];
     if (!cfg->mask) continue;
 
-    xcb_configure_window_aux(conn, cfg->window, cfg->mask, &cfg->value);
+    backend_commit_configure(backend, cfg);
   }
 }
 
 static window_configure_t *
 find_or_push_configure(window_configure_list_t *configs, xcb_window_t window) {
-  window_configure_t *cfg = nullptr;
-  for (size_t i = 0; i < configs->count; ++i) {
-    cfg = &configs->cfgs[i];
-    if (cfg->window == window) return cfg;
+  uint32_t index = 0;
+  if (id_map_get(&configs->index, window, &index)) {
+    return &configs->cfgs[index];
   }
 
-  cfg = array_push(configs->cfgs, configs->count, configs->capacity);
+  window_configure_t *cfg =
+    array_push(configs->cfgs, configs->count, configs->capacity);
   p_clear(cfg, 1);
   cfg->window = window;
   cfg->mask   = 0;
+  id_map_set(&configs->index, window, (uint32_t)(configs->count - 1));
   return cfg;
 }
 
+/*
+ * restack 的移动先作用在目标顺序上，应用时由 backend_commit_restack()
+ * 与已提交的顺序比较，只发出最少的移动。
+ */
+static void
+backend_restack_windows(backend_t *backend, const effect_restack_t *restack) {
+  auto target = &backend->stack_target;
+  if (!backend->restack_pending) {
+    stack_order_copy(target, &backend->stack);
+    backend->restack_pending   = true;
+    backend->restack_requested = 0;
+  }
+
+  for (size_t i = 0; i < restack->count; ++i) {
+    const restack_item_t *item = &restack->items[i];
+    if (stack_order_apply(target, item)) continue;
+
+    /*
+     * sibling 没有经 restack 放置过，位置未知：假定它在最底部，并把 window
+     * 当作未放置过的窗口，保证 window 会被直接放到 sibling 之上。
+     */
+    restack_item_t bottom = {.window = item->sibling};
+    stack_order_apply(&backend->stack, &bottom);
+    stack_order_apply(target, &bottom);
+    stack_order_remove(&backend->stack, item->window);
+    stack_order_apply(target, item);
+  }
+  backend->restack_requested += restack->count;
+}
+
+static void backend_commit_restack(backend_t *backend) {
+  if (!backend->restack_pending) return;
+  backend->restack_pending = false;
+
+  auto target = &backend->stack_target;
+  /* 每个窗口至多移动一次 */
+  array_reserve(
+    backend->restack_moves,
+    backend->restack_moves_capacity,
+    target->count
+  );
+  auto moves   = backend->restack_moves;
+  size_t count = stack_order_diff(&backend->stack, target, moves);
+
+  /*
+   * 移动必须按顺序发出，窗口本批的几何变化随它的移动一起发出，
+   * 之后 backend_apply_window_configure_list() 跳过该窗口
+   */
+  auto configs  = &backend->config_list;
+  uint32_t mask = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+  for (size_t i = 0; i < count; ++i) {
+    /* window_no_focus 先于所有受管窗口创建，作为栈底的参照 */
+    xcb_window_t sibling = moves[i].sibling;
+    if (window_id_invalid(sibling)) sibling = backend->window_no_focus;
+
+    auto cfg               = find_or_push_configure(configs, moves[i].window);
+    cfg->mask             |= mask;
+    cfg->value.sibling     = sibling;
+    cfg->value.stack_mode  = XCB_STACK_MODE_ABOVE;
+    backend_commit_configure(backend, cfg);
+    cfg->mask = 0;
+  }
+
+  stack_order_copy(&backend->stack, target);
+  backend->stats.restack_requests += count;
+  if (backend->restack_requested > count) {
+    backend->stats.restack_requests_skipped +=
+      backend->restack_requested - count;
+  }
+}
+
 static void merge_window_configure_params(
   backend_t *backend,
   const configure_data_t *data
@@ -553,48 +719,60 @@ static void backend_merge_effects(
       xcb_change_window_attributes_value_list_t value = {
         .border_pixel = e->as.change_border_color.color->argb
       };
-      xcb_change_window_attributes_aux(
+      auto window = e->as.change_border_color.window;
+      auto cookie = xcb_change_window_attributes_aux(
         backend->conn,
-        e->as.change_border_color.window,
+        window,
         XCB_CW_BORDER_PIXEL,
         &value
       );
+      backend_track_request(backend, cookie.sequence, e->type, window);
+    } break;
+    case ZDWM_EFFECT_CHANGE_WINDOW_LIST: {
+      auto list     = &e->as.change_window_list;
+      auto property = &backend->client_list;
+      window_list_property_set(property, list->windows, list->count);
     } break;
-    case ZDWM_EFFECT_CHANGE_WINDOW_LIST:
-      backend_change_window_list(backend, false, &e->as.change_window_list);
-      break;
     case ZDWM_EFFECT_RESTACK_WINDOWS:
       backend_restack_windows(backend, &e->as.restack_windows);
-      backend_change_window_list(backend, true, &e->as.restack_windows);
       break;
     case ZDWM_EFFECT_BIND_KEY:
       backend_bind_key(backend, &e->as.bind_key);
       break;
+    case ZDWM_EFFECT_WATCH_WINDOW:
+      window_list_push(&backend->watch, e->as.watch.window);
+      break;
     }
   }
 }
 
 static void backend_batch_apply_effects(backend_t *backend) {
   xcb_connection_t *conn = backend->conn;
-  if (backend->unmap.count) {
-    xcb_grab_server(conn);
-    window_clean_event_mask(conn, backend->screen->root);
-
-    window_list_t *unmap = &backend->unmap;
-    for (size_t i = 0; i < unmap->count; ++i) {
-      xcb_window_t window = unmap->windows[i];
-      window_clean_event_mask(conn, window);
-      xcb_unmap_window(conn, window);
-    }
+  backend_commit_restack(backend);
+
+  /* 自身引起的 UnmapNotify 按序号丢弃，不会被当作窗口撤回 */
+  for (size_t i = 0; i < backend->unmap.count; ++i) {
+    xcb_window_t window = backend->unmap.windows[i];
+    auto cookie         = xcb_unmap_window(conn, window);
+    auto effect         = ZDWM_EFFECT_UNMAP_WINDOW;
+    backend_ignore_unmap(backend, window, cookie.sequence);
+    backend_track_request(backend, cookie.sequence, effect, window);
+  }
 
-    root_set_event_mask(backend);
-    xcb_ungrab_server(conn);
+  /* 窗口已不存在时请求出错，backend_handle_error() 据此报告窗口移除 */
+  for (size_t i = 0; i < backend->watch.count; ++i) {
+    xcb_window_t window = backend->watch.windows[i];
+    auto cookie         = window_set_event_mask(conn, window);
+    auto effect         = ZDWM_EFFECT_WATCH_WINDOW;
+    backend_track_request(backend, cookie.sequence, effect, window);
   }
 
   for (size_t i = 0; i < backend->map.count; ++i) {
     xcb_window_t window = backend->map.windows[i];
     window_set_event_mask(conn, window);
-    xcb_map_window(conn, window);
+    auto cookie = xcb_map_window(conn, window);
+    auto effect = ZDWM_EFFECT_MAP_WINDOW;
+    backend_track_request(backend, cookie.sequence, effect, window);
   }
 
   for (size_t i = 0; i < backend->kill.count; ++i) {
@@ -603,6 +781,23 @@ static void backend_batch_apply_effects(backend_t *backend) {
 
   backend_apply_window_configure_list(backend);
 
+  auto atoms       = &backend->atoms;
+  auto client_list = &backend->client_list;
+  backend_publish_window_list(backend, client_list, atoms->_NET_CLIENT_LIST);
+
+  /*
+   * 堆叠顺序即 backend->stack，自底向顶，与属性的顺序一致。窗口销毁时
+   * 事件处理也会修改它，因此每批都与已写入的内容比较一次
+   */
+  auto stack    = &backend->stack;
+  auto stacking = &backend->client_list_stacking;
+  window_list_property_set(stacking, stack->windows, stack->count);
+  backend_publish_window_list(
+    backend,
+    stacking,
+    atoms->_NET_CLIENT_LIST_STACKING
+  );
+
   if (backend->update_focus) {
     backend_focus_window(backend, backend->focus_window);
   }
@@ -618,10 +813,34 @@ bool backend_apply_effect(
   window_list_reset(&backend->unmap);
   window_list_reset(&backend->map);
   window_list_reset(&backend->kill);
+  window_list_reset(&backend->watch);
 
+  /*
+   * 前后各一个 NoOperation 标出本次应用的请求序号范围，窗口移动、映射等
+   * 引起的 EnterNotify 与 ConfigureNotify 按此丢弃
+   */
+  uint32_t start = xcb_no_operation(backend->conn).sequence;
   backend_merge_effects(backend, effects, effect_count);
   backend_batch_apply_effects(backend);
+  uint32_t end = xcb_no_operation(backend->conn).sequence;
+  backend_ignore_sequences(backend, start, end);
 
   xcb_flush(backend->conn);
   return true;
 }
+
+void backend_set_title_refresh_interval(
+  backend_t *backend,
+  uint32_t interval_ms
+) {
+  backend->titles.interval_ns = (uint64_t)interval_ms * 1000000u;
+}
+
+void backend_get_stats(const backend_t *backend, backend_stats_t *stats) {
+  *stats = backend->stats;
+}
+
+int backend_get_fd(const backend_t *backend) {
+  if (!backend || !backend->conn) return -1;
+  return xcb_get_file_descriptor(backend->conn);
+}
@@ -1,14 +1,21 @@
 #include "core/event.h"
 
+#include <poll.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_event.h>
 #include <xcb/xcb_icccm.h>
 #include <xcb/xcb_keysyms.h>
 #include <xcb/xproto.h>
 
+#include "backend/stack_order.h"
 #include "backend/x11/window.h"
+#include "base/array.h"
+#include "base/event_loop.h"
+#include "base/id_map.h"
+#include "base/log.h"
 #include "base/macros.h"
 #include "base/memory.h"
 #include "core/backend.h"
@@ -91,41 +98,39 @@ static bool urgent_from_states(
   return false;
 }
 
-static bool handle_map_request(
+static bool map_request_from_replies(
   backend_t *backend,
-  event_t *event,
-  const xcb_map_request_event_t *xcb_event
+  window_map_request_event_t *ev,
+  void *const *replies
 ) {
-  xcb_window_t window = xcb_event->window;
-
-  event->type = ZDWM_EVENT_WINDOW_MAP_REQUEST;
-
-  window_map_request_event_t *ev = &event->as.window_map_request;
-  ev->window                     = (window_id_t)window;
-  ev->transient_for              = window_get_transient_for(backend, window);
+  ev->transient_for =
+    window_transient_for_from_reply(replies[WINDOW_PROP_TRANSIENT_FOR]);
 
-  xcb_get_window_attributes_reply_t *wa =
-    window_get_attributes(backend, window);
+  xcb_get_window_attributes_reply_t *wa = replies[WINDOW_PROP_ATTRIBUTES];
   if (!wa) return false;
   ev->override_redirect = (bool)wa->override_redirect;
-  p_delete(&wa);
 
   xcb_icccm_wm_hints_t wm_hints = {0};
-  if (window_get_wm_hints(backend, window, &wm_hints)) {
+  if (window_wm_hints_from_reply(replies[WINDOW_PROP_WM_HINTS], &wm_hints)) {
     ev->urgent    = (bool)xcb_icccm_wm_hints_get_urgency(&wm_hints);
     ev->minimized = minimized_from_hints(&wm_hints);
   }
 
-  if (!window_get_fixed_size(backend, window, &ev->fixed_size)) return false;
-  if (!window_get_geometry(backend, window, &ev->rect)) return false;
+  if (!window_fixed_size_from_reply(
+        replies[WINDOW_PROP_NORMAL_HINTS],
+        &ev->fixed_size
+      )) {
+    return false;
+  }
+  if (!window_geometry_from_reply(replies[WINDOW_PROP_GEOMETRY], &ev->rect)) {
+    return false;
+  }
 
   const atoms_t *atoms    = &backend->atoms;
   xcb_atom_t *state_atoms = nullptr;
   uint32_t state_count    = 0;
-  if (!window_get_atom_array(
-        backend,
-        window,
-        atoms->_NET_WM_STATE,
+  if (!window_atom_array_from_reply(
+        replies[WINDOW_PROP_NET_WM_STATE],
         &state_atoms,
         &state_count
       )) {
@@ -150,16 +155,24 @@ static bool handle_map_request(
   p_delete(&state_atoms);
 
   window_layer_props_t *props = &ev->props;
-  if (!window_get_types(backend, window, &props->types, &props->type_count)) {
-    p_delete(&props->states);
+  if (!window_types_from_reply(
+        backend,
+        replies[WINDOW_PROP_WINDOW_TYPE],
+        &props->types,
+        &props->type_count
+      )) {
     return false;
   }
 
-  ev->metadata.role  = window_get_role(backend, window);
-  ev->metadata.title = window_get_title(backend, window);
-  window_get_class(
+  ev->metadata.role =
+    window_text_from_reply(backend, replies[WINDOW_PROP_ROLE]);
+  ev->metadata.title = window_title_from_reply(
     backend,
-    window,
+    replies[WINDOW_PROP_NET_WM_NAME],
+    replies[WINDOW_PROP_WM_NAME]
+  );
+  window_class_from_reply(
+    replies[WINDOW_PROP_WM_CLASS],
     &ev->metadata.class_name,
     &ev->metadata.instance_name
   );
@@ -167,11 +180,241 @@ static bool handle_map_request(
   return true;
 }
 
+/* 取出 window 最早的接管记录；记录按 MapRequest 到达顺序排列 */
+static bool backend_take_adoption(
+  backend_t *backend,
+  xcb_window_t window,
+  window_props_fetch_t *fetch
+) {
+  auto adoptions = &backend->adoptions;
+  for (size_t i = 0; i < adoptions->count; ++i) {
+    if (adoptions->items[i].window != window) continue;
+
+    *fetch = adoptions->items[i].fetch;
+    array_erase(adoptions->items, adoptions->count, i);
+    return true;
+  }
+  return false;
+}
+
+static bool handle_map_request(
+  backend_t *backend,
+  event_t *event,
+  const xcb_map_request_event_t *xcb_event
+) {
+  xcb_window_t window = xcb_event->window;
+
+  /* 属性请求在 MapRequest 入队时已经发出，这里通常不会再阻塞 */
+  window_props_fetch_t fetch;
+  if (!backend_take_adoption(backend, window, &fetch)) {
+    window_props_fetch_start(backend, window, &fetch);
+  }
+  window_props_fetch_wait(backend, &fetch);
+
+  event->type = ZDWM_EVENT_WINDOW_MAP_REQUEST;
+
+  window_map_request_event_t *ev = &event->as.window_map_request;
+  ev->window                     = (window_id_t)window;
+
+  /* 失败时已填入的内容由调用方 event_reset() 释放 */
+  bool ok = map_request_from_replies(backend, ev, fetch.replies);
+  if (ok) {
+    auto geometry  = fetch.replies[WINDOW_PROP_GEOMETRY];
+    auto protocols = fetch.replies[WINDOW_PROP_WM_PROTOCOLS];
+    window_geometry_cache_seed(backend, window, geometry);
+    window_protocols_seed(backend, window, protocols);
+  }
+  window_props_fetch_cleanup(backend, &fetch);
+  return ok;
+}
+
+/*
+ * 标题刷新去抖
+ *
+ * 同一窗口两次读取标题至少间隔 titles.interval_ns。间隔已过时收到标题变化
+ * 立即读取；间隔内的变化只把窗口标记为过期，间隔结束时由
+ * backend_refresh_due_title() 读取一次最终值。读取后一个间隔内没有再变化
+ * 的窗口会被移出列表，列表里因此只有最近改过标题的窗口。
+ *
+ * 列表用 id_map 按窗口查找，并按读取时间串成链表。各窗口的间隔相同，
+ * 最早到期的一项总在链表头部，到期检查与超时计算不必遍历列表。
+ */
+
+static constexpr uint32_t TITLE_REFRESH_NONE = UINT32_MAX;
+
+static void
+title_refresh_unlink(title_refresh_list_t *titles, uint32_t index) {
+  auto entry = &titles->items[index];
+  if (entry->prev == TITLE_REFRESH_NONE) {
+    titles->head = entry->next;
+  } else {
+    titles->items[entry->prev].next = entry->next;
+  }
+  if (entry->next == TITLE_REFRESH_NONE) {
+    titles->tail = entry->prev;
+  } else {
+    titles->items[entry->next].prev = entry->prev;
+  }
+}
+
+/* 放到链表尾部；index 已在 items 中但不在链表中 */
+static void
+title_refresh_append(title_refresh_list_t *titles, uint32_t index) {
+  bool only   = titles->count == 1;
+  auto entry  = &titles->items[index];
+  entry->prev = only ? TITLE_REFRESH_NONE : titles->tail;
+  entry->next = TITLE_REFRESH_NONE;
+  if (only) {
+    titles->head = index;
+  } else {
+    titles->items[titles->tail].next = index;
+  }
+  titles->tail = index;
+}
+
+/* 记下一次读取：清除过期标记并移到链表尾部 */
+static void title_refresh_touch(
+  title_refresh_list_t *titles,
+  uint32_t index,
+  uint64_t now
+) {
+  auto entry           = &titles->items[index];
+  entry->fetched_at_ns = now;
+  if (entry->stale) titles->stale_count--;
+  entry->stale = false;
+  title_refresh_unlink(titles, index);
+  title_refresh_append(titles, index);
+}
+
+static void
+title_refresh_erase(title_refresh_list_t *titles, uint32_t index) {
+  auto entry = &titles->items[index];
+  if (entry->stale) titles->stale_count--;
+  title_refresh_unlink(titles, index);
+  id_map_remove(&titles->index, entry->window);
+
+  /* 末项移到空出的位置，同时修正它的前后项与下标 */
+  auto last = &titles->items[--titles->count];
+  if (index != titles->count) {
+    *entry = *last;
+    if (entry->prev == TITLE_REFRESH_NONE) {
+      titles->head = index;
+    } else {
+      titles->items[entry->prev].next = index;
+    }
+    if (entry->next == TITLE_REFRESH_NONE) {
+      titles->tail = index;
+    } else {
+      titles->items[entry->next].prev = index;
+    }
+    id_map_set(&titles->index, entry->window, index);
+  }
+  p_clear(last, 1);
+}
+
+static void title_refresh_remove(backend_t *backend, xcb_window_t window) {
+  auto titles    = &backend->titles;
+  uint32_t index = 0;
+  if (id_map_get(&titles->index, window, &index)) {
+    title_refresh_erase(titles, index);
+  }
+}
+
+/* 标题变化时调用，返回 true 表示应当立即读取 */
+static bool title_refresh_changed(backend_t *backend, xcb_window_t window) {
+  auto titles = &backend->titles;
+  if (!titles->interval_ns) return true;
+
+  uint64_t now   = event_loop_now_ns();
+  uint32_t index = 0;
+  if (!id_map_get(&titles->index, window, &index)) {
+    title_refresh_t *entry =
+      array_push(titles->items, titles->count, titles->capacity);
+    *entry = (title_refresh_t){.window = window, .fetched_at_ns = now};
+    index  = (uint32_t)(titles->count - 1);
+    id_map_set(&titles->index, window, index);
+    title_refresh_append(titles, index);
+    return true;
+  }
+
+  auto entry = &titles->items[index];
+  if (now - entry->fetched_at_ns >= titles->interval_ns) {
+    title_refresh_touch(titles, index, now);
+    return true;
+  }
+
+  if (entry->stale) {
+    backend->stats.title_fetches_skipped++;
+  } else {
+    titles->stale_count++;
+  }
+  entry->stale = true;
+  return false;
+}
+
+static void title_changed_event(
+  backend_t *backend,
+  event_t *event,
+  xcb_window_t window
+) {
+  event->type = ZDWM_EVENT_WINDOW_METADATA_CHANGED;
+
+  auto data            = &event->as.window_metadata_change;
+  data->window         = window;
+  data->metadata.title = window_get_title(backend, window);
+  data->changed_fields = ZDWM_WINDOW_METADATA_CHANGE_TITLE;
+  backend->stats.title_fetches++;
+}
+
+/* 读取一个到期的过期标题并产出事件，顺带移除已无需跟踪的窗口 */
+static bool backend_refresh_due_title(backend_t *backend, event_t *event) {
+  auto titles = &backend->titles;
+  if (!titles->count) return false;
+
+  uint64_t now = event_loop_now_ns();
+  while (titles->count) {
+    uint32_t index = titles->head;
+    auto entry     = &titles->items[index];
+    if (now - entry->fetched_at_ns < titles->interval_ns) return false;
+    if (!entry->stale) {
+      title_refresh_erase(titles, index);
+      continue;
+    }
+
+    auto window = entry->window;
+    title_refresh_touch(titles, index, now);
+    event_reset(event);
+    title_changed_event(backend, event, window);
+    return true;
+  }
+  return false;
+}
+
+/*
+ * 距链表头部一项到期的毫秒数；没有过期标题时返回 -1。头部一项可能
+ * 未过期，到期时由 backend_refresh_due_title() 移除，之后再按新的头部计算
+ */
+static int backend_title_refresh_timeout(const backend_t *backend) {
+  auto titles = &backend->titles;
+  if (!titles->stale_count) return -1;
+
+  auto entry        = &titles->items[titles->head];
+  uint64_t deadline = entry->fetched_at_ns + titles->interval_ns;
+  uint64_t now      = event_loop_now_ns();
+  if (deadline <= now) return 0;
+  return (int)((deadline - now + 999999u) / 1000000u);
+}
+
 static bool handle_unmap_notify(
   backend_t *backend,
   event_t *event,
   const xcb_unmap_notify_event_t *xcb_event
 ) {
+  title_refresh_remove(backend, xcb_event->window);
+  window_geometry_cache_forget(backend, xcb_event->window);
+  stack_order_remove(&backend->stack, xcb_event->window);
+  window_protocols_forget(backend, xcb_event->window);
+
   event->type                    = ZDWM_EVENT_WINDOW_REMOVE;
   event->as.window_remove.window = xcb_event->window;
   if (XCB_EVENT_SENT(xcb_event)) {
@@ -188,6 +431,11 @@ static bool handle_destroy_notify(
   event_t *event,
   const xcb_destroy_notify_event_t *xcb_event
 ) {
+  title_refresh_remove(backend, xcb_event->window);
+  window_geometry_cache_forget(backend, xcb_event->window);
+  stack_order_remove(&backend->stack, xcb_event->window);
+  window_protocols_forget(backend, xcb_event->window);
+
   event->type                    = ZDWM_EVENT_WINDOW_REMOVE;
   event->as.window_remove.window = xcb_event->window;
   event->as.window_remove.reason = ZDWM_WINDOW_REMOVE_DESTROY;
@@ -282,14 +530,16 @@ static bool handle_property_notify(
   const xcb_property_notify_event_t *xcb_event
 ) {
   auto window_id = xcb_event->window;
+  if (xcb_event->atom == backend->atoms.WM_PROTOCOLS) {
+    window_protocols_forget(backend, window_id);
+    return false;
+  }
+
   if (xcb_event->atom == backend->atoms.WM_NAME ||
       xcb_event->atom == backend->atoms._NET_WM_NAME) {
-    event->type = ZDWM_EVENT_WINDOW_METADATA_CHANGED;
+    if (!title_refresh_changed(backend, window_id)) return false;
 
-    auto data            = &event->as.window_metadata_change;
-    data->window         = window_id;
-    data->metadata.title = window_get_title(backend, window_id);
-    data->changed_fields = ZDWM_WINDOW_METADATA_CHANGE_TITLE;
+    title_changed_event(backend, event, window_id);
     return true;
   }
 
@@ -438,43 +688,567 @@ static bool handle_client_message(
   return false;
 }
 
-bool backend_next_event(backend_t *backend, event_t *event) {
-  if (!backend || !backend->conn || !event) return false;
-
-  for (;;) {
-    xcb_generic_event_t *raw_event = xcb_wait_for_event(backend->conn);
-    if (!raw_event) return false;
-
-    uint8_t response_type = XCB_EVENT_RESPONSE_TYPE(raw_event);
-    bool handled          = false;
+/* 翻译一个原始事件并释放它；产出可路由事件时返回 true */
+static bool backend_translate_event(
+  backend_t *backend,
+  event_t *event,
+  xcb_generic_event_t *raw_event
+) {
+  uint8_t response_type = XCB_EVENT_RESPONSE_TYPE(raw_event);
+  bool handled          = false;
 
-    auto label = xcb_event_get_label(response_type);
-    printf("xcb event type: %s[%u]\n", label, response_type);
+  auto label = xcb_event_get_label(response_type);
+  printf("xcb event type: %s[%u]\n", label, response_type);
 
-    switch (response_type) {
+  switch (response_type) {
 #define EVENT(type, handler)                              \
   case type:                                              \
     event_reset(event);                                   \
     handled = handler(backend, event, (void *)raw_event); \
     break
 
-      EVENT(XCB_MAP_REQUEST, handle_map_request);
-      EVENT(XCB_UNMAP_NOTIFY, handle_unmap_notify);
-      EVENT(XCB_DESTROY_NOTIFY, handle_destroy_notify);
-      EVENT(XCB_CONFIGURE_REQUEST, handle_configure_request);
-      EVENT(XCB_KEY_PRESS, handle_key_press);
-      EVENT(XCB_ENTER_NOTIFY, handle_enter_notify);
-      EVENT(XCB_PROPERTY_NOTIFY, handle_property_notify);
-      EVENT(XCB_CLIENT_MESSAGE, handle_client_message);
+    EVENT(XCB_MAP_REQUEST, handle_map_request);
+    EVENT(XCB_UNMAP_NOTIFY, handle_unmap_notify);
+    EVENT(XCB_DESTROY_NOTIFY, handle_destroy_notify);
+    EVENT(XCB_CONFIGURE_REQUEST, handle_configure_request);
+    EVENT(XCB_KEY_PRESS, handle_key_press);
+    EVENT(XCB_ENTER_NOTIFY, handle_enter_notify);
+    EVENT(XCB_PROPERTY_NOTIFY, handle_property_notify);
+    EVENT(XCB_CLIENT_MESSAGE, handle_client_message);
 
 #undef EVENT
 
-    default:
+  default:
+    break;
+  }
+
+  p_delete(&raw_event);
+  if (!handled) event_reset(event);
+  return handled;
+}
+
+/*
+ * 事件合并
+ *
+ * 翻译之前先把连接中已排队的原始事件读入 pending_events，入队时与队列中
+ * 同一窗口的早先事件合并：
+ *   - PropertyNotify：同一窗口同一属性只保留最后一个，属性值只读取一次；
+ *   - ConfigureRequest：同一窗口的请求合并为一个，同一字段以较新的为准；
+ *   - EnterNotify：同一窗口只保留最后一个。
+ * 合并结果位于较新事件的位置。向前查找时遇到同一窗口的其他事件即停止
+ * （PropertyNotify 与 EnterNotify 之间互不影响，可以跨过），因此不会跨越
+ * map/unmap/destroy 等改变窗口生命周期的事件。
+ */
+
+static xcb_window_t raw_event_window(const xcb_generic_event_t *raw_event) {
+  switch (XCB_EVENT_RESPONSE_TYPE(raw_event)) {
+  case XCB_MAP_REQUEST:
+    return ((const xcb_map_request_event_t *)raw_event)->window;
+  case XCB_UNMAP_NOTIFY:
+    return ((const xcb_unmap_notify_event_t *)raw_event)->window;
+  case XCB_DESTROY_NOTIFY:
+    return ((const xcb_destroy_notify_event_t *)raw_event)->window;
+  case XCB_CONFIGURE_REQUEST:
+    return ((const xcb_configure_request_event_t *)raw_event)->window;
+  case XCB_ENTER_NOTIFY:
+    return ((const xcb_enter_notify_event_t *)raw_event)->event;
+  case XCB_PROPERTY_NOTIFY:
+    return ((const xcb_property_notify_event_t *)raw_event)->window;
+  case XCB_CLIENT_MESSAGE:
+    return ((const xcb_client_message_event_t *)raw_event)->window;
+  default:
+    return XCB_NONE;
+  }
+}
+
+static bool raw_event_passive(const xcb_generic_event_t *raw_event) {
+  auto response_type = XCB_EVENT_RESPONSE_TYPE(raw_event);
+  return response_type == XCB_PROPERTY_NOTIFY ||
+         response_type == XCB_ENTER_NOTIFY;
+}
+
+static void configure_request_merge(
+  const xcb_configure_request_event_t *older,
+  xcb_configure_request_event_t *newer
+) {
+  uint16_t inherit = older->value_mask & ~newer->value_mask;
+
+  /*
+   * sibling 与 stack_mode 作为一对继承：新请求只设置 stack_mode 时表示
+   * 相对全部兄弟窗口，不能与旧请求的 sibling 拼成双方都没有要求的位置
+   */
+  uint16_t stacking = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+  if (newer->value_mask & stacking) {
+    inherit &= ~stacking;
+    if (!(newer->value_mask & XCB_CONFIG_WINDOW_SIBLING)) {
+      newer->sibling = XCB_NONE;
+    }
+  }
+
+#define INHERIT_FIELD(XCB_MASK, FIELD) \
+  if (inherit & XCB_CONFIG_WINDOW_##XCB_MASK) newer->FIELD = older->FIELD
+
+  INHERIT_FIELD(X, x);
+  INHERIT_FIELD(Y, y);
+  INHERIT_FIELD(WIDTH, width);
+  INHERIT_FIELD(HEIGHT, height);
+  INHERIT_FIELD(BORDER_WIDTH, border_width);
+  INHERIT_FIELD(SIBLING, sibling);
+  INHERIT_FIELD(STACK_MODE, stack_mode);
+
+#undef INHERIT_FIELD
+
+  newer->value_mask |= inherit;
+}
+
+/* older 可被 newer 取代时把 older 的内容并入 newer 并返回 true */
+static bool raw_event_merge(
+  const xcb_generic_event_t *older,
+  xcb_generic_event_t *newer
+) {
+  auto response_type = XCB_EVENT_RESPONSE_TYPE(newer);
+  if (XCB_EVENT_RESPONSE_TYPE(older) != response_type) return false;
+
+  switch (response_type) {
+  case XCB_PROPERTY_NOTIFY:
+    return ((const xcb_property_notify_event_t *)older)->atom ==
+           ((const xcb_property_notify_event_t *)newer)->atom;
+  case XCB_CONFIGURE_REQUEST:
+    configure_request_merge((const void *)older, (void *)newer);
+    return true;
+  case XCB_ENTER_NOTIFY:
+    return true;
+  default:
+    return false;
+  }
+}
+
+static void
+event_queue_push(event_queue_t *queue, xcb_generic_event_t *raw_event) {
+  auto window = raw_event_window(raw_event);
+
+  for (size_t i = queue->count; window != XCB_NONE && i-- > queue->head;) {
+    auto older = queue->events[i];
+    if (!older || raw_event_window(older) != window) continue;
+
+    if (raw_event_merge(older, raw_event)) {
+      p_delete(&queue->events[i]);
       break;
     }
+    if (!raw_event_passive(older) || !raw_event_passive(raw_event)) break;
+  }
+
+  xcb_generic_event_t **slot =
+    array_push(queue->events, queue->count, queue->capacity);
+  *slot = raw_event;
+}
+
+/* 取出 index 处的事件，并跳过队首已经取空的槽位 */
+static xcb_generic_event_t *
+event_queue_take(event_queue_t *queue, size_t index) {
+  auto raw_event       = queue->events[index];
+  queue->events[index] = nullptr;
+
+  while (queue->head < queue->count && !queue->events[queue->head]) {
+    queue->head++;
+  }
+  if (queue->head == queue->count) {
+    queue->head  = 0;
+    queue->count = 0;
+  }
+  return raw_event;
+}
+
+/*
+ * 自身请求引起的事件
+ *
+ * 事件的 full_sequence 是服务器生成它时本连接已处理到的请求序号：
+ *   - 自己的 UnmapWindow 引起的 UnmapNotify 与该请求序号相同，按窗口与
+ *     序号精确匹配，不会误伤客户端自己发起的撤回；
+ *   - 一次应用副作用的请求前后各有一个 NoOperation，这些请求引起的
+ *     EnterNotify 与 ConfigureNotify 序号严格落在两者之间，指针移动等
+ *     之后产生的事件序号至少为结尾的 NoOperation。
+ * 事件按序号递增到达，已经落后的记录在下一个事件入队时丢弃。
+ * 客户端用 SendEvent 发来的事件总是保留。
+ */
+
+static bool sequence_before(uint32_t a, uint32_t b) {
+  return (int32_t)(a - b) < 0;
+}
+
+void backend_ignore_unmap(
+  backend_t *backend,
+  xcb_window_t window,
+  uint32_t sequence
+) {
+  auto ignored           = &backend->ignored;
+  ignored_unmap_t *entry = array_push(
+    ignored->unmaps,
+    ignored->unmap_count,
+    ignored->unmap_capacity
+  );
+  *entry = (ignored_unmap_t){.window = window, .sequence = sequence};
+}
+
+void backend_ignore_sequences(
+  backend_t *backend,
+  uint32_t start,
+  uint32_t end
+) {
+  auto ignored = &backend->ignored;
+  if (end - start < 2) return;
+
+  sequence_range_t *range = array_push(
+    ignored->ranges,
+    ignored->range_count,
+    ignored->range_capacity
+  );
+  *range = (sequence_range_t){.start = start, .end = end};
+}
+
+static void ignored_events_prune(ignored_events_t *ignored, uint32_t sequence) {
+  size_t kept = 0;
+  for (size_t i = 0; i < ignored->unmap_count; ++i) {
+    auto entry = ignored->unmaps[i];
+    if (!sequence_before(entry.sequence, sequence)) {
+      ignored->unmaps[kept++] = entry;
+    }
+  }
+  ignored->unmap_count = kept;
+
+  kept = 0;
+  for (size_t i = 0; i < ignored->range_count; ++i) {
+    auto range = ignored->ranges[i];
+    if (sequence_before(sequence, range.end)) ignored->ranges[kept++] = range;
+  }
+  ignored->range_count = kept;
+}
+
+static bool backend_event_ignored(
+  backend_t *backend,
+  const xcb_generic_event_t *raw_event
+) {
+  auto ignored      = &backend->ignored;
+  uint32_t sequence = raw_event->full_sequence;
+  ignored_events_prune(ignored, sequence);
+  if (XCB_EVENT_SENT(raw_event)) return false;
+
+  switch (XCB_EVENT_RESPONSE_TYPE(raw_event)) {
+  case XCB_UNMAP_NOTIFY: {
+    auto window = ((const xcb_unmap_notify_event_t *)raw_event)->window;
+    for (size_t i = 0; i < ignored->unmap_count; ++i) {
+      auto entry = &ignored->unmaps[i];
+      if (entry->window == window && entry->sequence == sequence) return true;
+    }
+    return false;
+  }
+  case XCB_ENTER_NOTIFY:
+  case XCB_CONFIGURE_NOTIFY:
+    for (size_t i = 0; i < ignored->range_count; ++i) {
+      auto range = &ignored->ranges[i];
+      if (sequence_before(range->start, sequence)) return true;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+/*
+ * 请求错误
+ *
+ * 副作用的请求不带 checked 发出，出错时错误与事件一起按序号进入事件队列，
+ * 不需要 xcb_request_check 那样的往返。关心结果的请求由
+ * backend_track_request() 记下序号与引起它的副作用，错误到达时据此找回；
+ * 序号早于当前事件或错误的记录已不会再出错，随之丢弃。
+ */
+
+static const char *effect_type_label(effect_type_t type) {
+  static const char *const labels[] = {
+    [ZDWM_EFFECT_MAP_WINDOW]          = "map",
+    [ZDWM_EFFECT_UNMAP_WINDOW]        = "unmap",
+    [ZDWM_EFFECT_FOCUS_WINDOW]        = "focus",
+    [ZDWM_EFFECT_KILL_WINDOW]         = "kill",
+    [ZDWM_EFFECT_WITHDRAW_WINDOW]     = "withdraw",
+    [ZDWM_EFFECT_MINIMIZE_WINDOW]     = "minimize",
+    [ZDWM_EFFECT_MAXIMIZE_WINDOW]     = "maximize",
+    [ZDWM_EFFECT_FULLSCREEN_WINDOW]   = "fullscreen",
+    [ZDWM_EFFECT_CONFIGURE_WINDOW]    = "configure",
+    [ZDWM_EFFECT_CHANGE_BORDER_COLOR] = "change border color",
+    [ZDWM_EFFECT_CHANGE_WINDOW_LIST]  = "change window list",
+    [ZDWM_EFFECT_RESTACK_WINDOWS]     = "restack",
+    [ZDWM_EFFECT_BIND_KEY]            = "bind key",
+    [ZDWM_EFFECT_WATCH_WINDOW]        = "watch",
+  };
+  if ((size_t)type >= countof(labels) || !labels[type]) return "unknown";
+  return labels[type];
+}
+
+void backend_track_request(
+  backend_t *backend,
+  uint32_t sequence,
+  effect_type_t effect,
+  xcb_window_t window
+) {
+  auto requests            = &backend->requests;
+  tracked_request_t *entry = array_push(
+    requests->items,
+    requests->count,
+    requests->capacity
+  );
+  *entry = (tracked_request_t){
+    .sequence = sequence,
+    .effect   = effect,
+    .window   = window,
+  };
+}
+
+static void
+tracked_requests_prune(tracked_requests_t *requests, uint32_t sequence) {
+  size_t done = 0;
+  while (done < requests->count &&
+         sequence_before(requests->items[done].sequence, sequence)) {
+    ++done;
+  }
+  if (!done) return;
+
+  requests->count -= done;
+  memmove(
+    requests->items,
+    requests->items + done,
+    requests->count * sizeof(*requests->items)
+  );
+}
+
+static void
+backend_handle_error(backend_t *backend, const xcb_generic_error_t *error) {
+  auto requests     = &backend->requests;
+  uint32_t sequence = error->full_sequence;
+  auto label        = xcb_event_get_error_label(error->error_code);
+  backend->stats.request_errors++;
+
+  if (!requests->count || requests->items[0].sequence != sequence) {
+    logger(
+      "X error %s: request %u.%u, sequence %u\n",
+      label,
+      error->major_code,
+      error->minor_code,
+      sequence
+    );
+    return;
+  }
+
+  auto request = requests->items[0];
+  logger(
+    "X error %s: %s window 0x%x\n",
+    label,
+    effect_type_label(request.effect),
+    request.window
+  );
+
+  /* 请求没有生效，以它为依据的记录不再可信，下次按未知处理 */
+  switch (request.effect) {
+  case ZDWM_EFFECT_CONFIGURE_WINDOW:
+    window_geometry_cache_forget(backend, request.window);
+    break;
+  case ZDWM_EFFECT_RESTACK_WINDOWS:
+    /* 堆叠移动与该窗口的几何变化在同一个请求中发出 */
+    stack_order_remove(&backend->stack, request.window);
+    window_geometry_cache_forget(backend, request.window);
+    break;
+  case ZDWM_EFFECT_WATCH_WINDOW: {
+    if (error->error_code != XCB_WINDOW) break;
+
+    /*
+     * 窗口在订阅之前已被销毁，不会再有 DestroyNotify，
+     * 补一个给 handle_destroy_notify() 统一清理并报告移除
+     */
+    auto raw_event           = p_new(xcb_generic_event_t, 1);
+    auto destroy             = (xcb_destroy_notify_event_t *)raw_event;
+    destroy->response_type   = XCB_DESTROY_NOTIFY;
+    destroy->event           = request.window;
+    destroy->window          = request.window;
+    raw_event->full_sequence = sequence;
+    event_queue_push(&backend->pending_events, raw_event);
+  } break;
+  default:
+    break;
+  }
+}
+
+/*
+ * 窗口接管
+ *
+ * MapRequest 入队时立即发出该窗口的全部属性请求，回复到齐后才翻译。
+ * 等待回复期间队列中的其他事件照常分发，多个窗口的往返因此互相重叠。
+ * 为了不改变语义，以下事件要等前面的 MapRequest 分发之后才能分发：
+ *   - 同一窗口的后续事件（例如紧随其后的 UnmapNotify）；
+ *   - 其他窗口的 MapRequest，使窗口仍按映射请求的顺序被接管。
+ */
+
+static bool window_adoption_complete(const window_adoption_t *adoption) {
+  return adoption->fetch.received == WINDOW_PROP_COUNT;
+}
 
+static void
+backend_queue_event(backend_t *backend, xcb_generic_event_t *raw_event) {
+  tracked_requests_prune(&backend->requests, raw_event->full_sequence);
+  if (!XCB_EVENT_RESPONSE_TYPE(raw_event)) {
+    backend_handle_error(backend, (xcb_generic_error_t *)raw_event);
     p_delete(&raw_event);
-    if (handled) return true;
-    event_reset(event);
+    return;
+  }
+
+  if (backend_event_ignored(backend, raw_event)) {
+    p_delete(&raw_event);
+    return;
+  }
+
+  auto queue = &backend->pending_events;
+  event_queue_push(queue, raw_event);
+
+  if (XCB_EVENT_RESPONSE_TYPE(raw_event) != XCB_MAP_REQUEST) return;
+
+  auto window = ((xcb_map_request_event_t *)raw_event)->window;
+  window_adoption_t *adoption = array_push(
+    backend->adoptions.items,
+    backend->adoptions.count,
+    backend->adoptions.capacity
+  );
+  adoption->index  = queue->count - 1;
+  adoption->window = window;
+  window_props_fetch_start(backend, window, &adoption->fetch);
+  backend->adoption_unflushed = true;
+}
+
+static bool backend_event_blocked(
+  const backend_t *backend,
+  const xcb_generic_event_t *raw_event,
+  size_t index
+) {
+  auto window = raw_event_window(raw_event);
+  bool is_map = XCB_EVENT_RESPONSE_TYPE(raw_event) == XCB_MAP_REQUEST;
+
+  for (size_t i = 0; i < backend->adoptions.count; ++i) {
+    auto adoption = &backend->adoptions.items[i];
+    if (adoption->index > index) break;
+
+    /* 接管记录在其 MapRequest 分发时移除，仍在列表中即尚未分发 */
+    if (adoption->index == index) return !window_adoption_complete(adoption);
+    if (adoption->window == window || is_map) return true;
+  }
+  return false;
+}
+
+void backend_events_cleanup(backend_t *backend) {
+  auto adoptions = &backend->adoptions;
+  for (size_t i = 0; i < adoptions->count; ++i) {
+    window_props_fetch_cleanup(backend, &adoptions->items[i].fetch);
+  }
+  p_delete(&adoptions->items);
+  p_clear(adoptions, 1);
+
+  auto queue = &backend->pending_events;
+  for (size_t i = queue->head; i < queue->count; ++i) {
+    p_delete(&queue->events[i]);
+  }
+  p_delete(&queue->events);
+  p_clear(queue, 1);
+
+  p_delete(&backend->titles.items);
+  id_map_cleanup(&backend->titles.index);
+  backend->titles.count       = 0;
+  backend->titles.capacity    = 0;
+  backend->titles.stale_count = 0;
+
+  p_delete(&backend->ignored.unmaps);
+  p_delete(&backend->ignored.ranges);
+  p_clear(&backend->ignored, 1);
+
+  p_delete(&backend->requests.items);
+  p_clear(&backend->requests, 1);
+}
+
+/* 读入连接中已排队的全部事件，不阻塞 */
+static void backend_queue_events(backend_t *backend) {
+  xcb_connection_t *conn = backend->conn;
+
+  /* 队列取空后 xcb 会再非阻塞地读一次连接，等待中的回复也随之到达 */
+  xcb_generic_event_t *raw_event = nullptr;
+  while ((raw_event = xcb_poll_for_event(conn))) {
+    backend_queue_event(backend, raw_event);
+  }
+
+  if (backend->adoption_unflushed) {
+    xcb_flush(conn);
+    backend->adoption_unflushed = false;
+  }
+
+  auto adoptions = &backend->adoptions;
+  for (size_t i = 0; i < adoptions->count; ++i) {
+    window_props_fetch_poll(backend, &adoptions->items[i].fetch);
+  }
+}
+
+static bool backend_dispatch_pending(backend_t *backend, event_t *event) {
+  if (backend_refresh_due_title(backend, event)) return true;
+
+  auto queue = &backend->pending_events;
+  for (size_t i = queue->head; i < queue->count; ++i) {
+    auto raw_event = queue->events[i];
+    if (!raw_event || backend_event_blocked(backend, raw_event, i)) continue;
+
+    event_queue_take(queue, i);
+    if (backend_translate_event(backend, event, raw_event)) return true;
+  }
+  return false;
+}
+
+bool backend_next_event(backend_t *backend, event_t *event) {
+  if (!backend || !backend->conn || !event) return false;
+
+  for (;;) {
+    backend_queue_events(backend);
+    if (backend_dispatch_pending(backend, event)) return true;
+
+    /* 只剩等待回复的事件时阻塞在最早的接管上，期间到达的事件由 xcb 缓存 */
+    if (backend->adoptions.count) {
+      window_props_fetch_wait(backend, &backend->adoptions.items[0].fetch);
+      continue;
+    }
+
+    /* 有过期标题时最多等到它到期 */
+    int timeout = backend_title_refresh_timeout(backend);
+    if (timeout >= 0) {
+      struct pollfd pfd = {
+        .fd     = xcb_get_file_descriptor(backend->conn),
+        .events = POLLIN,
+      };
+      if (poll(&pfd, 1, timeout) <= 0) continue;
+
+      xcb_generic_event_t *raw_event = xcb_poll_for_event(backend->conn);
+      if (raw_event) {
+        backend_queue_event(backend, raw_event);
+      } else if (xcb_connection_has_error(backend->conn)) {
+        return false;
+      }
+      continue;
+    }
+
+    xcb_generic_event_t *raw_event = xcb_wait_for_event(backend->conn);
+    if (!raw_event) return false;
+    backend_queue_event(backend, raw_event);
   }
 }
+
+int backend_poll_timeout(const backend_t *backend) {
+  if (!backend) return -1;
+  return backend_title_refresh_timeout(backend);
+}
+
+bool backend_poll_event(backend_t *backend, event_t *event) {
+  if (!backend || !backend->conn || !event) return false;
+
+  backend_queue_events(backend);
+  return backend_dispatch_pending(backend, event);
+}
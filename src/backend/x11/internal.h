@@ -6,7 +6,10 @@
 #include <xcb/xcb_keysyms.h>
 #include <xcb/xproto.h>
 
+#include "backend/window_list_property.h"
+#include "base/id_map.h"
 #include "base/window_list.h"
+#include "core/backend.h"
 
 #define ATOM_LIST(X)                   \
   X(COMPOUND_TEXT)                     \
@@ -71,8 +74,150 @@ typedef struct window_configure_list_t {
   window_configure_t *cfgs;
   size_t count;
   size_t capacity;
+  id_map_t index; /* window -> cfgs[] 下标 */
 } window_configure_list_t;
 
+/*
+ * 已提交到服务器的窗口几何（x、y、宽、高、边框宽度）。mask 为已知的字段，
+ * 来自接管时读取的几何或之后发出的 ConfigureWindow。受管窗口的几何只能
+ * 由窗口管理器改变，与缓存相同的字段无需再发。
+ */
+typedef struct window_geometry_t {
+  xcb_window_t window;
+  uint32_t mask;
+  xcb_configure_window_value_list_t value;
+} window_geometry_t;
+
+typedef struct window_geometry_cache_t {
+  window_geometry_t *items;
+  size_t count;
+  size_t capacity;
+  id_map_t index; /* window -> items[] 下标 */
+} window_geometry_cache_t;
+
+/* 窗口在 WM_PROTOCOLS 中声明支持的协议 */
+typedef enum window_protocol_t {
+  WINDOW_PROTOCOL_TAKE_FOCUS    = 1u << 0,
+  WINDOW_PROTOCOL_DELETE_WINDOW = 1u << 1,
+} window_protocol_t;
+
+/* 接管窗口时需要读取的属性，顺序即请求发出的顺序 */
+typedef enum window_prop_t {
+  WINDOW_PROP_TRANSIENT_FOR,
+  WINDOW_PROP_ATTRIBUTES,
+  WINDOW_PROP_WM_HINTS,
+  WINDOW_PROP_NORMAL_HINTS,
+  WINDOW_PROP_GEOMETRY,
+  WINDOW_PROP_NET_WM_STATE,
+  WINDOW_PROP_WINDOW_TYPE,
+  WINDOW_PROP_ROLE,
+  WINDOW_PROP_NET_WM_NAME,
+  WINDOW_PROP_WM_NAME,
+  WINDOW_PROP_WM_CLASS,
+  WINDOW_PROP_WM_PROTOCOLS,
+  WINDOW_PROP_COUNT,
+} window_prop_t;
+
+/**
+ * @brief 接管窗口时的属性读取
+ * @details
+ * window_props_fetch_start() 一次发出全部请求，之后用
+ * window_props_fetch_poll() 不阻塞地收取已到达的回复，或用
+ * window_props_fetch_wait() 阻塞到全部到达。回复按请求序号依次到达，
+ * replies[0, received) 即已收到的部分；出错的请求对应的回复为 nullptr。
+ *
+ * 全部请求在第一个回复返回前已经发出，多个窗口的读取也可以互相重叠，
+ * 读取全部属性只有一次往返的延迟。
+ */
+typedef struct window_props_fetch_t {
+  unsigned int sequences[WINDOW_PROP_COUNT];
+  void *replies[WINDOW_PROP_COUNT];
+  size_t received;
+} window_props_fetch_t;
+
+/* 正在接管的窗口：MapRequest 已入队，属性请求已发出 */
+typedef struct window_adoption_t {
+  size_t index; /* MapRequest 在 pending_events 中的下标 */
+  xcb_window_t window;
+  window_props_fetch_t fetch;
+} window_adoption_t;
+
+typedef struct window_adoption_list_t {
+  window_adoption_t *items;
+  size_t count;
+  size_t capacity;
+} window_adoption_list_t;
+
+/* 最近读取过标题的窗口，用于标题刷新去抖 */
+typedef struct title_refresh_t {
+  xcb_window_t window;
+  uint64_t fetched_at_ns; /* 上次读取标题的时间 */
+  uint32_t prev;          /* 按读取时间串成的链表，前一项读取得更早 */
+  uint32_t next;
+  bool stale; /* 之后标题又变了，尚未读取 */
+} title_refresh_t;
+
+typedef struct title_refresh_list_t {
+  title_refresh_t *items;
+  size_t count;
+  size_t capacity;
+  id_map_t index;       /* window -> items 下标 */
+  uint32_t head;        /* 最早读取的一项，count 为 0 时无意义 */
+  uint32_t tail;        /* 最近读取的一项 */
+  size_t stale_count;   /* stale 为 true 的项数 */
+  uint64_t interval_ns; /* 0 表示不去抖 */
+} title_refresh_list_t;
+
+/*
+ * 已从连接读出、尚未翻译的原始事件。events[head, count) 为待处理部分，
+ * 被后续事件合并掉或已被提前取出的槽位置为 nullptr。
+ */
+typedef struct event_queue_t {
+  xcb_generic_event_t **events;
+  size_t head;
+  size_t count;
+  size_t capacity;
+} event_queue_t;
+
+/*
+ * 自身请求引起、需要在入队前丢弃的事件，见 event.c。
+ * unmaps 按窗口与序号精确匹配；ranges 中的 (start, end) 为开区间。
+ */
+typedef struct ignored_unmap_t {
+  xcb_window_t window;
+  uint32_t sequence;
+} ignored_unmap_t;
+
+typedef struct sequence_range_t {
+  uint32_t start;
+  uint32_t end;
+} sequence_range_t;
+
+typedef struct ignored_events_t {
+  ignored_unmap_t *unmaps;
+  size_t unmap_count;
+  size_t unmap_capacity;
+  sequence_range_t *ranges;
+  size_t range_count;
+  size_t range_capacity;
+} ignored_events_t;
+
+/*
+ * 需要追踪错误的请求，按发出顺序排列，见 event.c。
+ * effect 与 window 为引起该请求的副作用及其作用的窗口。
+ */
+typedef struct tracked_request_t {
+  uint32_t sequence;
+  effect_type_t effect;
+  xcb_window_t window;
+} tracked_request_t;
+
+typedef struct tracked_requests_t {
+  tracked_request_t *items;
+  size_t count;
+  size_t capacity;
+} tracked_requests_t;
+
 struct backend_t {
   xcb_key_symbols_t *key_symbols;
   xcb_connection_t *conn;
@@ -89,8 +234,64 @@ struct backend_t {
   xcb_window_t focus_window;
   bool update_focus;
 
+  event_queue_t pending_events;
+  /* 按 index 升序，即 MapRequest 的到达顺序 */
+  window_adoption_list_t adoptions;
+  bool adoption_unflushed;
+  title_refresh_list_t titles;
+  /*
+   * window -> window_protocol_t 位。接管时写入，WM_PROTOCOLS 变化时删除，
+   * 缓存中没有的窗口在用到时读取一次。
+   */
+  id_map_t protocols;
+  ignored_events_t ignored;
+  tracked_requests_t requests;
+  backend_stats_t stats;
+
   window_configure_list_t config_list;
+  window_geometry_cache_t geometries;
+  window_list_property_t client_list;
+  window_list_property_t client_list_stacking;
+
+  /* 已提交到服务器的堆叠顺序，自底向顶，只含经 restack 放置过的窗口 */
+  window_list_t stack;
+  /* 本次应用中的 restack 全部作用后的目标顺序 */
+  window_list_t stack_target;
+  bool restack_pending;
+  size_t restack_requested; /* 目标顺序由多少步移动得到 */
+  restack_item_t *restack_moves;
+  size_t restack_moves_capacity;
   window_list_t unmap;
   window_list_t map;
   window_list_t kill;
+  window_list_t watch;
 };
+
+/* 释放尚未处理的原始事件、尚未完成的窗口接管与标题刷新状态 */
+void backend_events_cleanup(backend_t *backend);
+
+/* 丢弃 sequence 号 UnmapWindow 请求引起的 window 的 UnmapNotify */
+void backend_ignore_unmap(
+  backend_t *backend,
+  xcb_window_t window,
+  uint32_t sequence
+);
+/* 丢弃序号在 (start, end) 之间的请求引起的 EnterNotify 与 ConfigureNotify */
+void backend_ignore_sequences(backend_t *backend, uint32_t start, uint32_t end);
+
+/* 记下 sequence 号请求，出错时按序号找回引起它的副作用 */
+void backend_track_request(
+  backend_t *backend,
+  uint32_t sequence,
+  effect_type_t effect,
+  xcb_window_t window
+);
+
+/* 用接管时读取的几何初始化窗口的缓存，reply 为 nullptr 时忽略 */
+void window_geometry_cache_seed(
+  backend_t *backend,
+  xcb_window_t window,
+  const xcb_get_geometry_reply_t *reply
+);
+/* 窗口不再受管或已销毁，丢弃其缓存的几何 */
+void window_geometry_cache_forget(backend_t *backend, xcb_window_t window);
@@ -5,30 +5,42 @@
 #include <xcb/xcb.h>
 #include <xcb/xcb_icccm.h>
 #include <xcb/xcb_keysyms.h>
+#include <xcb/xcbext.h>
 #include <xcb/xproto.h>
 
+#include "base/id_map.h"
 #include "base/macros.h"
 #include "base/memory.h"
 #include "core/backend.h"
 #include "core/types.h"
 #include "internal.h"
 
-static char *window_get_text_property(
+static xcb_get_property_cookie_t window_request_property(
   backend_t *backend,
   xcb_window_t window,
-  xcb_atom_t property
+  xcb_atom_t property,
+  xcb_atom_t type
 ) {
-  xcb_get_property_cookie_t cookie = xcb_get_property_unchecked(
+  return xcb_get_property_unchecked(
     backend->conn,
     false,
     window,
     property,
-    XCB_ATOM_ANY,
+    type,
     0,
     UINT32_MAX
   );
-  xcb_get_property_reply_t *reply =
-    xcb_get_property_reply(backend->conn, cookie, nullptr);
+}
+
+static xcb_get_property_reply_t *
+window_property_reply(backend_t *backend, xcb_get_property_cookie_t cookie) {
+  return xcb_get_property_reply(backend->conn, cookie, nullptr);
+}
+
+char *window_text_from_reply(
+  backend_t *backend,
+  const xcb_get_property_reply_t *reply
+) {
   if (!reply) return nullptr;
 
   int length  = xcb_get_property_value_length(reply);
@@ -42,6 +54,18 @@ static char *window_get_text_property(
     text = p_strndup(value, (size_t)length);
   }
 
+  return text;
+}
+
+static char *window_get_text_property(
+  backend_t *backend,
+  xcb_window_t window,
+  xcb_atom_t property
+) {
+  auto cookie =
+    window_request_property(backend, window, property, XCB_ATOM_ANY);
+  xcb_get_property_reply_t *reply = window_property_reply(backend, cookie);
+  char *text = window_text_from_reply(backend, reply);
   p_delete(&reply);
   return text;
 }
@@ -51,6 +75,16 @@ char *window_get_role(backend_t *backend, xcb_window_t window) {
   return window_get_text_property(backend, window, property);
 }
 
+char *window_title_from_reply(
+  backend_t *backend,
+  const xcb_get_property_reply_t *net_wm_name,
+  const xcb_get_property_reply_t *wm_name
+) {
+  char *name = window_text_from_reply(backend, net_wm_name);
+  if (!name) name = window_text_from_reply(backend, wm_name);
+  return name;
+}
+
 char *window_get_title(backend_t *backend, xcb_window_t window) {
   xcb_atom_t property = backend->atoms._NET_WM_NAME;
   char *name          = window_get_text_property(backend, window, property);
@@ -61,44 +95,41 @@ char *window_get_title(backend_t *backend, xcb_window_t window) {
   return name;
 }
 
-void window_get_class(
-  backend_t *backend,
-  xcb_window_t window,
+void window_class_from_reply(
+  xcb_get_property_reply_t *reply,
   char **class_out,
   char **instance_out
 ) {
+  /* from_reply 只是让 prop 指向 reply 内部，reply 仍由调用方释放，不能 wipe */
   xcb_icccm_get_wm_class_reply_t prop;
-  xcb_get_property_cookie_t cookie =
-    xcb_icccm_get_wm_class_unchecked(backend->conn, window);
-  if (!xcb_icccm_get_wm_class_reply(backend->conn, cookie, &prop, nullptr)) {
-    return;
-  }
+  if (!reply || !xcb_icccm_get_wm_class_from_reply(&prop, reply)) return;
 
   if (class_out) *class_out = p_strdup_nullable(prop.class_name);
   if (instance_out) *instance_out = p_strdup_nullable(prop.instance_name);
-
-  xcb_icccm_get_wm_class_reply_wipe(&prop);
 }
 
-xcb_window_t window_get_transient_for(backend_t *backend, xcb_window_t window) {
-  xcb_connection_t *conn = backend->conn;
+void window_get_class(
+  backend_t *backend,
+  xcb_window_t window,
+  char **class_out,
+  char **instance_out
+) {
   xcb_get_property_cookie_t cookie =
-    xcb_icccm_get_wm_transient_for_unchecked(conn, window);
+    xcb_icccm_get_wm_class_unchecked(backend->conn, window);
+  xcb_get_property_reply_t *reply = window_property_reply(backend, cookie);
+  window_class_from_reply(reply, class_out, instance_out);
+  p_delete(&reply);
+}
+
+xcb_window_t window_transient_for_from_reply(xcb_get_property_reply_t *reply) {
   xcb_window_t trans_for = XCB_WINDOW_NONE;
-  if (xcb_icccm_get_wm_transient_for_reply(conn, cookie, &trans_for, nullptr)) {
+  if (reply && xcb_icccm_get_wm_transient_for_from_reply(&trans_for, reply)) {
     return trans_for;
   }
 
   return XCB_WINDOW_NONE;
 }
 
-xcb_get_window_attributes_reply_t *
-window_get_attributes(backend_t *backend, xcb_window_t window) {
-  xcb_get_window_attributes_cookie_t cookie =
-    xcb_get_window_attributes(backend->conn, window);
-  return xcb_get_window_attributes_reply(backend->conn, cookie, nullptr);
-}
-
 static window_type_t
 atom_to_window_type(const atoms_t *atoms, xcb_atom_t atom) {
   if (atom == atoms->_NET_WM_WINDOW_TYPE_DESKTOP)
@@ -124,21 +155,15 @@ atom_to_window_type(const atoms_t *atoms, xcb_atom_t atom) {
   return ZDWM_WINDOW_TYPE_NORMAL;
 }
 
-bool window_get_types(
+bool window_types_from_reply(
   backend_t *backend,
-  xcb_window_t window,
+  const xcb_get_property_reply_t *reply,
   window_type_t **types,
   size_t *count
 ) {
   uint32_t atom_count = 0;
   xcb_atom_t *atoms   = nullptr;
-  if (!window_get_atom_array(
-        backend,
-        window,
-        backend->atoms._NET_WM_WINDOW_TYPE,
-        &atoms,
-        &atom_count
-      )) {
+  if (!window_atom_array_from_reply(reply, &atoms, &atom_count)) {
     return false;
   }
   if (!atoms) {
@@ -157,12 +182,9 @@ bool window_get_types(
   return true;
 }
 
-bool window_get_fixed_size(backend_t *backend, xcb_window_t window, bool *out) {
+bool window_fixed_size_from_reply(xcb_get_property_reply_t *reply, bool *out) {
   xcb_size_hints_t hints = {0};
-  xcb_connection_t *conn = backend->conn;
-  xcb_get_property_cookie_t cookie =
-    xcb_icccm_get_wm_normal_hints_unchecked(conn, window);
-  if (!xcb_icccm_get_wm_normal_hints_reply(conn, cookie, &hints, nullptr)) {
+  if (!reply || !xcb_icccm_get_wm_size_hints_from_reply(&hints, reply)) {
     return false;
   }
 
@@ -176,39 +198,33 @@ bool window_get_fixed_size(backend_t *backend, xcb_window_t window, bool *out) {
   return true;
 }
 
-bool window_get_geometry(backend_t *backend, xcb_window_t window, rect_t *out) {
-  xcb_get_geometry_cookie_t cookie = xcb_get_geometry(backend->conn, window);
-  xcb_get_geometry_reply_t *reply =
-    xcb_get_geometry_reply(backend->conn, cookie, nullptr);
+bool window_get_fixed_size(backend_t *backend, xcb_window_t window, bool *out) {
+  xcb_get_property_cookie_t cookie =
+    xcb_icccm_get_wm_normal_hints_unchecked(backend->conn, window);
+  xcb_get_property_reply_t *reply = window_property_reply(backend, cookie);
+  bool ok = window_fixed_size_from_reply(reply, out);
+  p_delete(&reply);
+  return ok;
+}
+
+bool window_geometry_from_reply(
+  const xcb_get_geometry_reply_t *reply,
+  rect_t *out
+) {
   if (!reply) return false;
 
   out->x      = reply->x;
   out->y      = reply->y;
   out->width  = reply->width;
   out->height = reply->height;
-
-  p_delete(&reply);
   return true;
 }
 
-bool window_get_atom_array(
-  backend_t *backend,
-  xcb_window_t window,
-  xcb_atom_t property,
+bool window_atom_array_from_reply(
+  const xcb_get_property_reply_t *reply,
   xcb_atom_t **out_atoms,
   uint32_t *out_len
 ) {
-  xcb_get_property_cookie_t cookie = xcb_get_property_unchecked(
-    backend->conn,
-    false,
-    window,
-    property,
-    XCB_ATOM_ATOM,
-    0,
-    UINT32_MAX
-  );
-  xcb_get_property_reply_t *reply =
-    xcb_get_property_reply(backend->conn, cookie, nullptr);
   if (!reply) return false;
 
   if (reply->type == XCB_ATOM_ATOM && reply->format == 32 && reply->value_len) {
@@ -219,8 +235,35 @@ bool window_get_atom_array(
     *out_len   = 0;
     *out_atoms = nullptr;
   }
+  return true;
+}
+
+uint32_t window_protocols_from_reply(
+  const atoms_t *atoms,
+  const xcb_get_property_reply_t *reply
+) {
+  if (!reply || reply->type != XCB_ATOM_ATOM || reply->format != 32) return 0;
+
+  const xcb_atom_t *protocols = xcb_get_property_value(reply);
+  uint32_t result             = 0;
+  for (uint32_t i = 0; i < reply->value_len; ++i) {
+    if (protocols[i] == atoms->WM_TAKE_FOCUS) {
+      result |= WINDOW_PROTOCOL_TAKE_FOCUS;
+    } else if (protocols[i] == atoms->WM_DELETE_WINDOW) {
+      result |= WINDOW_PROTOCOL_DELETE_WINDOW;
+    }
+  }
+  return result;
+}
 
-  p_delete(&reply);
+bool window_wm_hints_from_reply(
+  xcb_get_property_reply_t *reply,
+  xcb_icccm_wm_hints_t *out
+) {
+  if (!reply || !xcb_icccm_get_wm_hints_from_reply(out, reply)) {
+    p_clear(out, 1);
+    return false;
+  }
   return true;
 }
 
@@ -231,13 +274,98 @@ bool window_get_wm_hints(
 ) {
   xcb_get_property_cookie_t cookie =
     xcb_icccm_get_wm_hints_unchecked(backend->conn, window);
-  if (!xcb_icccm_get_wm_hints_reply(backend->conn, cookie, out, nullptr)) {
-    p_clear(out, 1);
-    return false;
+  xcb_get_property_reply_t *reply = window_property_reply(backend, cookie);
+  bool ok = window_wm_hints_from_reply(reply, out);
+  p_delete(&reply);
+  return ok;
+}
+
+void window_props_fetch_start(
+  backend_t *backend,
+  xcb_window_t window,
+  window_props_fetch_t *fetch
+) {
+  xcb_connection_t *conn = backend->conn;
+  const atoms_t *atoms   = &backend->atoms;
+  auto seq               = fetch->sequences;
+
+  p_clear(fetch, 1);
+
+  seq[WINDOW_PROP_TRANSIENT_FOR] =
+    xcb_icccm_get_wm_transient_for_unchecked(conn, window).sequence;
+  seq[WINDOW_PROP_ATTRIBUTES] =
+    xcb_get_window_attributes(conn, window).sequence;
+  seq[WINDOW_PROP_WM_HINTS] =
+    xcb_icccm_get_wm_hints_unchecked(conn, window).sequence;
+  seq[WINDOW_PROP_NORMAL_HINTS] =
+    xcb_icccm_get_wm_normal_hints_unchecked(conn, window).sequence;
+  seq[WINDOW_PROP_GEOMETRY] = xcb_get_geometry(conn, window).sequence;
+
+#define REQUEST_PROPERTY(PROP, ATOM, TYPE) \
+  seq[WINDOW_PROP_##PROP] =                \
+    window_request_property(backend, window, ATOM, TYPE).sequence
+
+  REQUEST_PROPERTY(NET_WM_STATE, atoms->_NET_WM_STATE, XCB_ATOM_ATOM);
+  REQUEST_PROPERTY(WINDOW_TYPE, atoms->_NET_WM_WINDOW_TYPE, XCB_ATOM_ATOM);
+  REQUEST_PROPERTY(ROLE, atoms->WM_WINDOW_ROLE, XCB_ATOM_ANY);
+  REQUEST_PROPERTY(NET_WM_NAME, atoms->_NET_WM_NAME, XCB_ATOM_ANY);
+  REQUEST_PROPERTY(WM_NAME, atoms->WM_NAME, XCB_ATOM_ANY);
+
+#undef REQUEST_PROPERTY
+
+  seq[WINDOW_PROP_WM_CLASS] =
+    xcb_icccm_get_wm_class_unchecked(conn, window).sequence;
+  seq[WINDOW_PROP_WM_PROTOCOLS] =
+    xcb_icccm_get_wm_protocols_unchecked(conn, window, atoms->WM_PROTOCOLS)
+      .sequence;
+}
+
+bool window_props_fetch_poll(backend_t *backend, window_props_fetch_t *fetch) {
+  while (fetch->received < WINDOW_PROP_COUNT) {
+    void *reply                = nullptr;
+    xcb_generic_error_t *error = nullptr;
+    if (!xcb_poll_for_reply(
+          backend->conn,
+          fetch->sequences[fetch->received],
+          &reply,
+          &error
+        )) {
+      return false;
+    }
+
+    p_delete(&error);
+    fetch->replies[fetch->received++] = reply;
   }
   return true;
 }
 
+void window_props_fetch_wait(backend_t *backend, window_props_fetch_t *fetch) {
+  while (fetch->received < WINDOW_PROP_COUNT) {
+    xcb_generic_error_t *error = nullptr;
+    void *reply                = xcb_wait_for_reply(
+      backend->conn,
+      fetch->sequences[fetch->received],
+      &error
+    );
+
+    p_delete(&error);
+    fetch->replies[fetch->received++] = reply;
+  }
+}
+
+void window_props_fetch_cleanup(
+  backend_t *backend,
+  window_props_fetch_t *fetch
+) {
+  for (size_t i = 0; i < fetch->received; ++i) {
+    p_delete(&fetch->replies[i]);
+  }
+  for (size_t i = fetch->received; i < WINDOW_PROP_COUNT; ++i) {
+    xcb_discard_reply(backend->conn, fetch->sequences[i]);
+  }
+  fetch->received = WINDOW_PROP_COUNT;
+}
+
 window_state_t atom_to_window_state(const atoms_t *atoms, xcb_atom_t atom) {
   if (atom == atoms->_NET_WM_STATE_FULLSCREEN)
     return ZDWM_WINDOW_STATE_FULLSCREEN;
@@ -247,59 +375,78 @@ window_state_t atom_to_window_state(const atoms_t *atoms, xcb_atom_t atom) {
   return (window_state_t)-1;
 }
 
-static bool
-window_send_event(backend_t *backend, xcb_window_t window, xcb_atom_t atom) {
-  bool exist = false;
+void window_protocols_seed(
+  backend_t *backend,
+  xcb_window_t window,
+  const xcb_get_property_reply_t *reply
+) {
+  if (!reply) return;
+
+  uint32_t protocols = window_protocols_from_reply(&backend->atoms, reply);
+  id_map_set(&backend->protocols, window, protocols);
+}
+
+void window_protocols_forget(backend_t *backend, xcb_window_t window) {
+  id_map_remove(&backend->protocols, window);
+}
+
+static uint32_t window_protocols(backend_t *backend, xcb_window_t window) {
+  uint32_t protocols = 0;
+  if (id_map_get(&backend->protocols, window, &protocols)) return protocols;
 
   xcb_connection_t *conn = backend->conn;
   auto WM_PROTOCOLS      = backend->atoms.WM_PROTOCOLS;
 
   xcb_get_property_cookie_t cookie =
     xcb_icccm_get_wm_protocols_unchecked(conn, window, WM_PROTOCOLS);
-  xcb_icccm_get_wm_protocols_reply_t reply = {0};
-  if (xcb_icccm_get_wm_protocols_reply(conn, cookie, &reply, nullptr)) {
-    for (uint32_t i = 0; !exist && i < reply.atoms_len; ++i) {
-      exist = reply.atoms[i] == atom;
-    }
-    xcb_icccm_get_wm_protocols_reply_wipe(&reply);
-  }
-
-  if (exist) {
-    xcb_client_message_event_t ev = {
-      .response_type = XCB_CLIENT_MESSAGE,
-      .format        = 32,
-      .window        = window,
-      .type          = WM_PROTOCOLS,
-      .data.data32   = {atom, XCB_CURRENT_TIME},
-    };
-    xcb_send_event(conn, false, window, XCB_EVENT_MASK_NO_EVENT, (char *)&ev);
-  }
+  xcb_get_property_reply_t *reply =
+    xcb_get_property_reply(conn, cookie, nullptr);
+  window_protocols_seed(backend, window, reply);
+  protocols = window_protocols_from_reply(&backend->atoms, reply);
+  p_delete(&reply);
+  return protocols;
+}
 
-  return exist;
+static bool window_send_event(
+  backend_t *backend,
+  xcb_window_t window,
+  window_protocol_t protocol,
+  xcb_atom_t atom
+) {
+  if (!(window_protocols(backend, window) & protocol)) return false;
+
+  xcb_client_message_event_t ev = {
+    .response_type = XCB_CLIENT_MESSAGE,
+    .format        = 32,
+    .window        = window,
+    .type          = backend->atoms.WM_PROTOCOLS,
+    .data.data32   = {atom, XCB_CURRENT_TIME},
+  };
+  xcb_send_event(
+    backend->conn,
+    false,
+    window,
+    XCB_EVENT_MASK_NO_EVENT,
+    (char *)&ev
+  );
+  return true;
 }
 
 void window_takefocus(backend_t *backend, xcb_window_t window) {
-  window_send_event(backend, window, backend->atoms.WM_TAKE_FOCUS);
+  auto atom = backend->atoms.WM_TAKE_FOCUS;
+  window_send_event(backend, window, WINDOW_PROTOCOL_TAKE_FOCUS, atom);
 }
 
 void window_kill(backend_t *backend, xcb_window_t window) {
-  if (window_send_event(backend, window, backend->atoms.WM_DELETE_WINDOW)) {
+  auto atom     = backend->atoms.WM_DELETE_WINDOW;
+  auto protocol = WINDOW_PROTOCOL_DELETE_WINDOW;
+  if (window_send_event(backend, window, protocol, atom)) {
     xcb_kill_client(backend->conn, window);
   }
 }
 
-void root_set_event_mask(backend_t *backend) {
-  xcb_connection_t *conn                               = backend->conn;
-  xcb_window_t root                                    = backend->screen->root;
-  xcb_cw_t change_mask                                 = XCB_CW_EVENT_MASK;
-  xcb_change_window_attributes_value_list_t value_list = {
-    .event_mask =
-      XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT | XCB_EVENT_MASK_KEY_PRESS,
-  };
-  xcb_change_window_attributes_aux(conn, root, change_mask, &value_list);
-}
-
-void window_set_event_mask(xcb_connection_t *conn, xcb_window_t window) {
+xcb_void_cookie_t
+window_set_event_mask(xcb_connection_t *conn, xcb_window_t window) {
   xcb_cw_t change_mask                                 = XCB_CW_EVENT_MASK;
   xcb_change_window_attributes_value_list_t value_list = {
     .event_mask = XCB_EVENT_MASK_ENTER_WINDOW | XCB_EVENT_MASK_FOCUS_CHANGE |
@@ -307,15 +454,12 @@ void window_set_event_mask(xcb_connection_t *conn, xcb_window_t window) {
                   XCB_EVENT_MASK_STRUCTURE_NOTIFY |
                   XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY,
   };
-  xcb_change_window_attributes_aux(conn, window, change_mask, &value_list);
-}
-
-void window_clean_event_mask(xcb_connection_t *conn, xcb_window_t window) {
-  xcb_cw_t change_mask                                 = XCB_CW_EVENT_MASK;
-  xcb_change_window_attributes_value_list_t value_list = {
-    .event_mask = XCB_EVENT_MASK_NO_EVENT,
-  };
-  xcb_change_window_attributes_aux(conn, window, change_mask, &value_list);
+  return xcb_change_window_attributes_aux(
+    conn,
+    window,
+    change_mask,
+    &value_list
+  );
 }
 
 void window_set_icccm_wm_state(
@@ -44,29 +44,71 @@ void window_get_class(
   char **class_out,
   char **instance_out
 );
-xcb_window_t window_get_transient_for(backend_t *backend, xcb_window_t window);
-xcb_get_window_attributes_reply_t *
-window_get_attributes(backend_t *backend, xcb_window_t window);
-bool window_get_types(
+bool window_get_fixed_size(backend_t *backend, xcb_window_t window, bool *out);
+bool window_get_wm_hints(
   backend_t *backend,
   xcb_window_t window,
-  window_type_t **types,
-  size_t *count
+  xcb_icccm_wm_hints_t *out
 );
-bool window_get_fixed_size(backend_t *backend, xcb_window_t window, bool *out);
-bool window_get_geometry(backend_t *backend, xcb_window_t window, rect_t *out);
-bool window_get_atom_array(
+
+/* 发出请求但不 flush，由调用方在合适的时机 xcb_flush() */
+void window_props_fetch_start(
   backend_t *backend,
   xcb_window_t window,
-  xcb_atom_t property,
+  window_props_fetch_t *fetch
+);
+/** @brief 收取已到达的回复，不读取连接也不阻塞；全部到达时返回 true */
+bool window_props_fetch_poll(backend_t *backend, window_props_fetch_t *fetch);
+void window_props_fetch_wait(backend_t *backend, window_props_fetch_t *fetch);
+/** @brief 释放已收到的回复并丢弃尚未到达的回复 */
+void window_props_fetch_cleanup(
+  backend_t *backend,
+  window_props_fetch_t *fetch
+);
+
+/*
+ * 以下 window_*_from_reply 与同名 window_get_* 语义一致，只是从已收到的
+ * 回复中解析；reply 可为 nullptr（请求出错），不转移其所有权。
+ */
+char *window_text_from_reply(
+  backend_t *backend,
+  const xcb_get_property_reply_t *reply
+);
+char *window_title_from_reply(
+  backend_t *backend,
+  const xcb_get_property_reply_t *net_wm_name,
+  const xcb_get_property_reply_t *wm_name
+);
+void window_class_from_reply(
+  xcb_get_property_reply_t *reply,
+  char **class_out,
+  char **instance_out
+);
+xcb_window_t window_transient_for_from_reply(xcb_get_property_reply_t *reply);
+bool window_types_from_reply(
+  backend_t *backend,
+  const xcb_get_property_reply_t *reply,
+  window_type_t **types,
+  size_t *count
+);
+bool window_fixed_size_from_reply(xcb_get_property_reply_t *reply, bool *out);
+bool window_geometry_from_reply(
+  const xcb_get_geometry_reply_t *reply,
+  rect_t *out
+);
+bool window_atom_array_from_reply(
+  const xcb_get_property_reply_t *reply,
   xcb_atom_t **out_atoms,
   uint32_t *out_len
 );
-bool window_get_wm_hints(
-  backend_t *backend,
-  xcb_window_t window,
+bool window_wm_hints_from_reply(
+  xcb_get_property_reply_t *reply,
   xcb_icccm_wm_hints_t *out
 );
+uint32_t window_protocols_from_reply(
+  const atoms_t *atoms,
+  const xcb_get_property_reply_t *reply
+);
 window_state_t atom_to_window_state(const atoms_t *atoms, xcb_atom_t atom);
 
 #define window_set_name_static(conn, win, name) \
@@ -79,12 +121,26 @@ window_state_t atom_to_window_state(const atoms_t *atoms, xcb_atom_t atom);
 #define _window_set_class_instance_static(conn, win, instance_class) \
   xcb_icccm_set_wm_class(conn, win, sizeof(instance_class), instance_class)
 
+/**
+ * @brief 缓存窗口支持的协议
+ * @details
+ * window_takefocus() 与 window_kill() 只查缓存，缓存中没有该窗口时才阻塞
+ * 读取一次 WM_PROTOCOLS。reply 为 nullptr（请求出错）时不缓存。
+ */
+void window_protocols_seed(
+  backend_t *backend,
+  xcb_window_t window,
+  const xcb_get_property_reply_t *reply
+);
+/** @brief WM_PROTOCOLS 变化或窗口不再受管时丢弃缓存 */
+void window_protocols_forget(backend_t *backend, xcb_window_t window);
+
 void window_takefocus(backend_t *backend, xcb_window_t window);
 void window_kill(backend_t *backend, xcb_window_t window);
 
-void root_set_event_mask(backend_t *backend);
-void window_set_event_mask(xcb_connection_t *conn, xcb_window_t window);
-void window_clean_event_mask(xcb_connection_t *conn, xcb_window_t window);
+/** @brief 订阅窗口事件，返回的序号用于把窗口已不存在的错误对应回窗口 */
+xcb_void_cookie_t
+window_set_event_mask(xcb_connection_t *conn, xcb_window_t window);
 void window_set_icccm_wm_state(
   xcb_connection_t *conn,
   xcb_window_t window,
@@ -0,0 +1,449 @@
+#include "base/event_loop.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "base/log.h"
+#include "base/memory.h"
+
+uint64_t event_loop_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static bool epoll_ctl_io(event_loop_t *loop, int op, event_loop_io_t *io) {
+  struct epoll_event event = {.events = io->events, .data.ptr = io};
+  if (epoll_ctl(loop->epoll_fd, op, io->fd, &event) < 0) {
+    warn("epoll_ctl(%d, fd %d) failed: %s", op, io->fd, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+bool event_loop_add_io(event_loop_t *loop, event_loop_io_t *io) {
+  return epoll_ctl_io(loop, EPOLL_CTL_ADD, io);
+}
+
+bool event_loop_modify_io(event_loop_t *loop, event_loop_io_t *io) {
+  return epoll_ctl_io(loop, EPOLL_CTL_MOD, io);
+}
+
+void event_loop_remove_io(event_loop_t *loop, event_loop_io_t *io) {
+  epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, io->fd, nullptr);
+
+  /* 同一轮中排在后面的事件不能再回调到已经删除的 io */
+  for (int i = 0; i < loop->ready_count; ++i) {
+    if (loop->ready[i].data.ptr == io) loop->ready[i].data.ptr = nullptr;
+  }
+}
+
+/*
+ * 分层时间轮（Varghese & Lauck）。定时器按到期 tick 与当前 tick 的距离
+ * 放入对应层：第 n 层的槽位由到期 tick 的第 6n 位起的 6 位决定，当前 tick
+ * 走到第 n 层某个槽位覆盖的区间起点时，该槽位的定时器被重新放置到更低的层，
+ * 最终在第 0 层按 tick 精确触发。启动与停止只是链表的插入与摘除。
+ *
+ * 每层另有一个非空槽位的位图，用来跳过空槽：推进时直接跳到下一个需要处理
+ * 的 tick，设置 timerfd 时只检查每层第一个非空槽位。
+ */
+
+static constexpr uint64_t EVENT_LOOP_TICK_NS    = 1000000u;
+static constexpr unsigned EVENT_LOOP_WHEEL_BITS = 6;
+static constexpr uint64_t EVENT_LOOP_WHEEL_MASK = EVENT_LOOP_WHEEL_SLOTS - 1;
+
+static inline unsigned wheel_shift(int level) {
+  return (unsigned)level * EVENT_LOOP_WHEEL_BITS;
+}
+
+static inline uint64_t rotr64(uint64_t bits, unsigned n) {
+  n &= 63u;
+  return n ? (bits >> n) | (bits << (64u - n)) : bits;
+}
+
+static void wheel_link(event_loop_t *loop, event_loop_timer_t *timer) {
+  uint64_t expires = timer->expires_tick;
+  uint64_t delta   = expires - loop->current_tick;
+
+  int level = 0;
+  while (level < EVENT_LOOP_WHEEL_LEVELS - 1 &&
+         delta >> wheel_shift(level + 1)) {
+    ++level;
+  }
+  /* 超出最高层范围的定时器先放在最远的槽位，转到时再按真实到期时间放置 */
+  uint64_t span = 1ull << wheel_shift(EVENT_LOOP_WHEEL_LEVELS);
+  if (delta >= span) expires = loop->current_tick + span - 1;
+
+  unsigned slot = (expires >> wheel_shift(level)) & EVENT_LOOP_WHEEL_MASK;
+  auto head     = &loop->wheel[level][slot];
+
+  timer->level = (uint8_t)level;
+  timer->slot  = (uint8_t)slot;
+  timer->prev  = nullptr;
+  timer->next  = *head;
+  if (*head) (*head)->prev = timer;
+  *head = timer;
+  loop->wheel_bits[level] |= 1ull << slot;
+}
+
+static void wheel_unlink(event_loop_t *loop, event_loop_timer_t *timer) {
+  if (timer->next) timer->next->prev = timer->prev;
+  if (timer->prev) {
+    timer->prev->next = timer->next;
+  } else {
+    loop->wheel[timer->level][timer->slot] = timer->next;
+    if (!timer->next) loop->wheel_bits[timer->level] &= ~(1ull << timer->slot);
+  }
+  timer->prev = nullptr;
+  timer->next = nullptr;
+}
+
+/* 第 level 层在当前 tick 之后的第一个非空槽位，没有时返回 -1 */
+static int wheel_first_slot(const event_loop_t *loop, int level) {
+  uint64_t bits = loop->wheel_bits[level];
+  if (!bits) return -1;
+
+  unsigned start = ((loop->current_tick >> wheel_shift(level)) + 1) &
+                   EVENT_LOOP_WHEEL_MASK;
+  unsigned offset = (unsigned)__builtin_ctzll(rotr64(bits, start));
+  return (int)((start + offset) & EVENT_LOOP_WHEEL_MASK);
+}
+
+/* 下一个需要处理的 tick：第 0 层为触发，其他层为重新放置 */
+static uint64_t wheel_next_tick(const event_loop_t *loop) {
+  uint64_t next = UINT64_MAX;
+  for (int level = 0; level < EVENT_LOOP_WHEEL_LEVELS; ++level) {
+    int slot = wheel_first_slot(loop, level);
+    if (slot < 0) continue;
+
+    uint64_t block  = loop->current_tick >> wheel_shift(level);
+    uint64_t offset = ((uint64_t)slot - block - 1) & EVENT_LOOP_WHEEL_MASK;
+    uint64_t tick   = (block + 1 + offset) << wheel_shift(level);
+    if (tick < next) next = tick;
+  }
+  return next;
+}
+
+/* 最早的到期 tick；每层第一个非空槽位里的定时器都早于该层其他槽位 */
+static uint64_t wheel_next_expiry(const event_loop_t *loop) {
+  uint64_t next = UINT64_MAX;
+  for (int level = 0; level < EVENT_LOOP_WHEEL_LEVELS; ++level) {
+    int slot = wheel_first_slot(loop, level);
+    if (slot < 0) continue;
+
+    for (auto timer = loop->wheel[level][slot]; timer; timer = timer->next) {
+      if (timer->expires_tick < next) next = timer->expires_tick;
+    }
+  }
+  return next;
+}
+
+/* 把 level 层当前槽位的定时器重新放到更低的层 */
+static void wheel_cascade(event_loop_t *loop, int level) {
+  unsigned slot =
+    (loop->current_tick >> wheel_shift(level)) & EVENT_LOOP_WHEEL_MASK;
+
+  event_loop_timer_t *timer = loop->wheel[level][slot];
+  loop->wheel[level][slot]  = nullptr;
+  loop->wheel_bits[level]  &= ~(1ull << slot);
+
+  while (timer) {
+    event_loop_timer_t *next = timer->next;
+    wheel_link(loop, timer);
+    timer = next;
+  }
+}
+
+static uint64_t deadline_tick(uint64_t deadline_ns) {
+  return (deadline_ns + EVENT_LOOP_TICK_NS - 1) / EVENT_LOOP_TICK_NS;
+}
+
+static void event_loop_timer_schedule(
+  event_loop_t *loop,
+  event_loop_timer_t *timer
+) {
+  /* 当前 tick 已经处理过，最早只能排到下一个 tick */
+  uint64_t expires    = deadline_tick(timer->deadline_ns);
+  timer->expires_tick = expires > loop->current_tick ? expires
+                                                     : loop->current_tick + 1;
+  wheel_link(loop, timer);
+}
+
+/* 按最早的到期时间设置 timerfd，没有定时器时停止 */
+static void event_loop_timer_arm(event_loop_t *loop) {
+  /* 执行定时器期间的启动与停止，统一在执行完后设置 */
+  if (loop->running_timers) return;
+
+  uint64_t tick = loop->timer_count ? wheel_next_expiry(loop) : 0;
+  if (tick == loop->armed_tick) return;
+
+  /* it_value 全 0 表示停止 */
+  struct itimerspec spec = {0};
+  if (tick) {
+    uint64_t deadline     = tick * EVENT_LOOP_TICK_NS;
+    spec.it_value.tv_sec  = (time_t)(deadline / 1000000000u);
+    spec.it_value.tv_nsec = (long)(deadline % 1000000000u);
+  }
+  if (timerfd_settime(loop->timer_io.fd, TFD_TIMER_ABSTIME, &spec, nullptr)) {
+    warn("timerfd_settime failed: %s", strerror(errno));
+    return;
+  }
+  loop->armed_tick = tick;
+}
+
+void event_loop_timer_start(
+  event_loop_t *loop,
+  event_loop_timer_t *timer,
+  uint64_t delay_ns,
+  uint64_t interval_ns
+) {
+  uint64_t now = event_loop_now_ns();
+  if (timer->active) {
+    wheel_unlink(loop, timer);
+  } else {
+    /* 时间轮为空时可以直接把当前 tick 拨到现在，新定时器落在精确的层上 */
+    if (!loop->timer_count && !loop->running_timers) {
+      loop->current_tick = now / EVENT_LOOP_TICK_NS;
+    }
+    loop->timer_count++;
+    timer->active = true;
+  }
+
+  timer->deadline_ns = now + delay_ns;
+  timer->interval_ns = interval_ns;
+  event_loop_timer_schedule(loop, timer);
+  event_loop_timer_arm(loop);
+}
+
+void event_loop_timer_stop(event_loop_t *loop, event_loop_timer_t *timer) {
+  if (!timer->active) return;
+
+  wheel_unlink(loop, timer);
+  loop->timer_count--;
+  timer->active = false;
+  event_loop_timer_arm(loop);
+}
+
+/* 执行第 0 层当前槽位的定时器，它们都恰好在当前 tick 到期 */
+static void event_loop_timer_run_due(event_loop_t *loop, uint64_t now) {
+  unsigned slot = loop->current_tick & EVENT_LOOP_WHEEL_MASK;
+
+  /* 回调可能停止同一槽位的其他定时器，每次都从槽位头部重新取 */
+  event_loop_timer_t *timer = nullptr;
+  while ((timer = loop->wheel[0][slot])) {
+    wheel_unlink(loop, timer);
+    if (timer->interval_ns) {
+      timer->deadline_ns += timer->interval_ns;
+      if (timer->deadline_ns <= now) {
+        timer->deadline_ns = now + timer->interval_ns;
+      }
+      event_loop_timer_schedule(loop, timer);
+    } else {
+      loop->timer_count--;
+      timer->active = false;
+    }
+    timer->fn(timer);
+  }
+}
+
+static void event_loop_timer_ready(event_loop_io_t *io, uint32_t events) {
+  event_loop_t *loop = io->userdata;
+
+  uint64_t expirations = 0;
+  if (read(io->fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+    warn("timerfd read failed: %s", strerror(errno));
+  }
+  /* 读出后 timerfd 不再处于设置状态，需要重新设置 */
+  loop->armed_tick = 0;
+
+  uint64_t now    = event_loop_now_ns();
+  uint64_t target = now / EVENT_LOOP_TICK_NS;
+
+  loop->running_timers = true;
+  while (loop->current_tick < target) {
+    /* 中间没有需要处理的槽位，直接跳过 */
+    uint64_t next = wheel_next_tick(loop);
+    if (next > target) {
+      loop->current_tick = target;
+      break;
+    }
+
+    loop->current_tick = next;
+    for (int level = EVENT_LOOP_WHEEL_LEVELS - 1; level > 0; --level) {
+      uint64_t mask = (1ull << wheel_shift(level)) - 1;
+      if (!(next & mask)) wheel_cascade(loop, level);
+    }
+    event_loop_timer_run_due(loop, now);
+  }
+  loop->running_timers = false;
+
+  event_loop_timer_arm(loop);
+}
+
+static void event_loop_signal_ready(event_loop_io_t *io, uint32_t events) {
+  event_loop_t *loop = io->userdata;
+
+  struct signalfd_siginfo info;
+  while (read(io->fd, &info, sizeof(info)) == sizeof(info)) {
+    int signo = (int)info.ssi_signo;
+    if (signo <= 0 || signo >= NSIG) continue;
+
+    auto handler = &loop->signals[signo];
+    if (handler->fn) handler->fn(loop, signo, handler->userdata);
+  }
+}
+
+bool event_loop_add_signal(
+  event_loop_t *loop,
+  int signo,
+  event_loop_signal_fn fn,
+  void *userdata
+) {
+  if (signo <= 0 || signo >= NSIG || !fn) return false;
+
+  sigset_t mask = loop->signal_mask;
+  sigaddset(&mask, signo);
+
+  bool first = loop->signal_io.fd < 0;
+  int fd     = signalfd(loop->signal_io.fd, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (fd < 0) {
+    warn("signalfd failed: %s", strerror(errno));
+    return false;
+  }
+  if (first) {
+    loop->signal_io.fd = fd;
+    if (!event_loop_add_io(loop, &loop->signal_io)) {
+      close(fd);
+      loop->signal_io.fd = -1;
+      return false;
+    }
+  }
+
+  sigset_t single;
+  sigemptyset(&single);
+  sigaddset(&single, signo);
+  sigset_t old;
+  sigprocmask(SIG_BLOCK, &single, &old);
+  if (first) loop->saved_signal_mask = old;
+
+  loop->signal_mask    = mask;
+  loop->signals[signo] = (event_loop_signal_t){fn, userdata};
+  return true;
+}
+
+void event_loop_remove_signal(event_loop_t *loop, int signo) {
+  if (signo <= 0 || signo >= NSIG || !loop->signals[signo].fn) return;
+
+  sigdelset(&loop->signal_mask, signo);
+  loop->signals[signo] = (event_loop_signal_t){0};
+  signalfd(loop->signal_io.fd, &loop->signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  /* 注册前本来就被屏蔽的信号保持屏蔽 */
+  if (!sigismember(&loop->saved_signal_mask, signo)) {
+    sigset_t single;
+    sigemptyset(&single);
+    sigaddset(&single, signo);
+    sigprocmask(SIG_UNBLOCK, &single, nullptr);
+  }
+}
+
+bool event_loop_init(event_loop_t *loop) {
+  p_clear(loop, 1);
+  loop->timer_io.fd  = -1;
+  loop->signal_io.fd = -1;
+  loop->current_tick = event_loop_now_ns() / EVENT_LOOP_TICK_NS;
+  sigemptyset(&loop->signal_mask);
+
+  loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epoll_fd < 0) {
+    warn("epoll_create1 failed: %s", strerror(errno));
+    return false;
+  }
+
+  loop->timer_io = (event_loop_io_t){
+    .fd       = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC),
+    .events   = EPOLLIN,
+    .fn       = event_loop_timer_ready,
+    .userdata = loop,
+  };
+  loop->signal_io = (event_loop_io_t){
+    .fd       = -1,
+    .events   = EPOLLIN,
+    .fn       = event_loop_signal_ready,
+    .userdata = loop,
+  };
+  if (loop->timer_io.fd < 0 || !event_loop_add_io(loop, &loop->timer_io)) {
+    warn("timerfd setup failed: %s", strerror(errno));
+    event_loop_cleanup(loop);
+    return false;
+  }
+
+  return true;
+}
+
+void event_loop_cleanup(event_loop_t *loop) {
+  if (loop->signal_io.fd >= 0) {
+    close(loop->signal_io.fd);
+    loop->signal_io.fd = -1;
+    sigprocmask(SIG_SETMASK, &loop->saved_signal_mask, nullptr);
+  }
+  if (loop->timer_io.fd >= 0) close(loop->timer_io.fd);
+  if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+  loop->timer_io.fd = -1;
+  loop->epoll_fd    = -1;
+
+  for (int level = 0; level < EVENT_LOOP_WHEEL_LEVELS; ++level) {
+    for (int slot = 0; slot < EVENT_LOOP_WHEEL_SLOTS; ++slot) {
+      for (auto timer = loop->wheel[level][slot]; timer;) {
+        auto next     = timer->next;
+        timer->active = false;
+        timer->prev   = nullptr;
+        timer->next   = nullptr;
+        timer         = next;
+      }
+      loop->wheel[level][slot] = nullptr;
+    }
+    loop->wheel_bits[level] = 0;
+  }
+  loop->timer_count = 0;
+  loop->armed_tick  = 0;
+  loop->ready_count = 0;
+  sigemptyset(&loop->signal_mask);
+  p_clear(loop->signals, NSIG);
+}
+
+bool event_loop_dispatch(event_loop_t *loop, int timeout_ms) {
+  int count =
+    epoll_wait(loop->epoll_fd, loop->ready, EVENT_LOOP_MAX_EVENTS, timeout_ms);
+  if (count < 0) {
+    if (errno == EINTR) return true;
+    warn("epoll_wait failed: %s", strerror(errno));
+    return false;
+  }
+
+  loop->ready_count = count;
+  for (int i = 0; i < loop->ready_count; ++i) {
+    event_loop_io_t *io = loop->ready[i].data.ptr;
+    if (io) io->fn(io, loop->ready[i].events);
+  }
+  loop->ready_count = 0;
+  return true;
+}
+
+bool event_loop_run(event_loop_t *loop) {
+  loop->running = true;
+  while (loop->running) {
+    if (!event_loop_dispatch(loop, -1)) return false;
+  }
+  return true;
+}
+
+void event_loop_stop(event_loop_t *loop) { loop->running = false; }
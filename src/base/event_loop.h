@@ -0,0 +1,149 @@
+#pragma once
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+
+/**
+ * @file event_loop.h
+ * @brief 基于 epoll 的单线程事件循环。
+ *
+ * 一个 epoll 实例同时等待注册的 fd、一个 timerfd 与一个 signalfd：
+ * - fd 由调用方持有的 event_loop_io_t 描述，epoll 直接回传其指针；
+ * - 定时器挂在分层时间轮上，共用一个 timerfd，始终按最早的到期时间设置；
+ * - 注册过的信号被屏蔽并改由 signalfd 读取，回调在循环中同步执行，
+ *   不受异步信号安全的限制。
+ *
+ * 回调中可以增删任意 fd、定时器与信号（包括正在执行的这一个）。
+ */
+
+typedef struct event_loop_t event_loop_t;
+typedef struct event_loop_io_t event_loop_io_t;
+typedef struct event_loop_timer_t event_loop_timer_t;
+
+/** @param events 就绪的 epoll 事件位（EPOLLIN、EPOLLHUP 等） */
+typedef void (*event_loop_io_fn)(event_loop_io_t *io, uint32_t events);
+typedef void (*event_loop_timer_fn)(event_loop_timer_t *timer);
+typedef void (*event_loop_signal_fn)(
+  event_loop_t *loop,
+  int signo,
+  void *userdata
+);
+
+/* 由调用方分配，注册期间地址必须保持不变 */
+struct event_loop_io_t {
+  int fd;
+  uint32_t events;
+  event_loop_io_fn fn;
+  void *userdata;
+};
+
+/* 由调用方分配，启动期间地址必须保持不变 */
+struct event_loop_timer_t {
+  event_loop_timer_fn fn;
+  void *userdata;
+
+  uint64_t deadline_ns; /* CLOCK_MONOTONIC */
+  uint64_t interval_ns; /* 0 表示一次性定时器 */
+  bool active;
+
+  /* 以下由时间轮维护 */
+  uint64_t expires_tick;
+  uint8_t level;
+  uint8_t slot;
+  event_loop_timer_t *prev;
+  event_loop_timer_t *next;
+};
+
+typedef struct event_loop_signal_t {
+  event_loop_signal_fn fn;
+  void *userdata;
+} event_loop_signal_t;
+
+static constexpr int EVENT_LOOP_MAX_EVENTS = 32;
+
+/*
+ * 时间轮：tick 为 1ms，每层 64 个槽，第 n 层每个槽覆盖 64^n 个 tick，
+ * 四层共覆盖约 4.6 小时，更远的定时器先放在最高层，转到时再重新放置。
+ */
+static constexpr int EVENT_LOOP_WHEEL_LEVELS = 4;
+static constexpr int EVENT_LOOP_WHEEL_SLOTS  = 64;
+
+struct event_loop_t {
+  int epoll_fd;
+  event_loop_io_t timer_io;  /* timerfd，所有定时器共用 */
+  event_loop_io_t signal_io; /* signalfd，未注册信号时 fd 为 -1 */
+
+  bool running;
+
+  /* 本轮 epoll_wait 返回、尚未分派的事件；删除 io 时会清掉其中对应的项 */
+  struct epoll_event ready[EVENT_LOOP_MAX_EVENTS];
+  int ready_count;
+
+  event_loop_timer_t *wheel[EVENT_LOOP_WHEEL_LEVELS][EVENT_LOOP_WHEEL_SLOTS];
+  uint64_t wheel_bits[EVENT_LOOP_WHEEL_LEVELS]; /* 非空槽位的位图 */
+  uint64_t current_tick; /* 已经处理到的 tick */
+  size_t timer_count;
+  uint64_t armed_tick; /* timerfd 当前的到期 tick，0 表示未设置 */
+  bool running_timers;
+
+  sigset_t signal_mask;
+  sigset_t saved_signal_mask; /* 注册第一个信号之前的线程屏蔽字 */
+  event_loop_signal_t signals[NSIG];
+};
+
+bool event_loop_init(event_loop_t *loop);
+/** @brief 关闭全部 fd 并恢复信号屏蔽字，注册的 io 与定时器不会被回调 */
+void event_loop_cleanup(event_loop_t *loop);
+
+/** @brief 当前 CLOCK_MONOTONIC 时间，定时器的到期时间以此为准 */
+uint64_t event_loop_now_ns(void);
+
+/**
+ * @brief 注册 fd，io->events 为关注的 epoll 事件位
+ *
+ * epoll 为水平触发：只要 fd 仍然就绪，每次分派都会再次回调。
+ */
+bool event_loop_add_io(event_loop_t *loop, event_loop_io_t *io);
+bool event_loop_modify_io(event_loop_t *loop, event_loop_io_t *io);
+void event_loop_remove_io(event_loop_t *loop, event_loop_io_t *io);
+
+/**
+ * @brief 启动定时器，delay_ns 后首次到期
+ *
+ * 定时器已启动时按新的参数重新计时。interval_ns 不为 0 时周期触发，
+ * 错过的周期不会补发。到期时间向上取整到 1ms，启动与停止都是 O(1)。
+ */
+void event_loop_timer_start(
+  event_loop_t *loop,
+  event_loop_timer_t *timer,
+  uint64_t delay_ns,
+  uint64_t interval_ns
+);
+void event_loop_timer_stop(event_loop_t *loop, event_loop_timer_t *timer);
+
+/**
+ * @brief 屏蔽 signo 并改由循环分派
+ *
+ * 每个信号只能有一个回调，重复注册会替换原回调。屏蔽字会被 fork 出的子进程
+ * 继承，exec 之前需要自行恢复。
+ */
+bool event_loop_add_signal(
+  event_loop_t *loop,
+  int signo,
+  event_loop_signal_fn fn,
+  void *userdata
+);
+void event_loop_remove_signal(event_loop_t *loop, int signo);
+
+/**
+ * @brief 等待并分派一轮就绪的事件
+ *
+ * @param timeout_ms 最长等待的毫秒数，-1 表示一直等待
+ * @return epoll 出错时返回 false；被信号打断不算出错
+ */
+bool event_loop_dispatch(event_loop_t *loop, int timeout_ms);
+/** @brief 反复分派直到 event_loop_stop() 被调用或出错 */
+bool event_loop_run(event_loop_t *loop);
+void event_loop_stop(event_loop_t *loop);
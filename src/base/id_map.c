@@ -0,0 +1,125 @@
+#include "base/id_map.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/memory.h"
+
+static constexpr size_t ID_MAP_INIT_CAPACITY = 16;
+
+/*
+ * X 窗口 id 由客户端资源基址加一个小的递增值组成，低位分布集中。
+ * 用 murmur3 的 32 位 finalizer 打散后再取低位作为槽位。
+ */
+static inline uint32_t id_hash(uint32_t key) {
+  key ^= key >> 16;
+  key *= 0x85ebca6bu;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35u;
+  key ^= key >> 16;
+  return key;
+}
+
+static inline size_t id_map_slot(size_t capacity, uint32_t key) {
+  return (size_t)id_hash(key) & (capacity - 1);
+}
+
+static void id_map_insert_entry(id_map_t *map, uint32_t key, uint32_t value) {
+  size_t mask = map->capacity - 1;
+  size_t slot = id_map_slot(map->capacity, key);
+  while (map->entries[slot].key) {
+    if (map->entries[slot].key == key) {
+      map->entries[slot].value = value;
+      return;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  map->entries[slot].key   = key;
+  map->entries[slot].value = value;
+  map->count++;
+}
+
+static void id_map_grow(id_map_t *map) {
+  id_map_entry_t *old_entries = map->entries;
+  size_t old_capacity         = map->capacity;
+
+  map->capacity = old_capacity ? old_capacity * 2 : ID_MAP_INIT_CAPACITY;
+  map->entries  = p_new(id_map_entry_t, map->capacity);
+  map->count    = 0;
+
+  for (size_t i = 0; i < old_capacity; ++i) {
+    if (!old_entries[i].key) continue;
+    id_map_insert_entry(map, old_entries[i].key, old_entries[i].value);
+  }
+
+  p_delete(&old_entries);
+}
+
+void id_map_cleanup(id_map_t *map) {
+  p_delete(&map->entries);
+  map->count    = 0;
+  map->capacity = 0;
+}
+
+void id_map_reset(id_map_t *map) {
+  if (map->entries) p_clear(map->entries, map->capacity);
+  map->count = 0;
+}
+
+bool id_map_get(const id_map_t *map, uint32_t key, uint32_t *value_out) {
+  if (!key || !map->count) return false;
+
+  size_t mask = map->capacity - 1;
+  size_t slot = id_map_slot(map->capacity, key);
+  while (map->entries[slot].key) {
+    if (map->entries[slot].key == key) {
+      if (value_out) *value_out = map->entries[slot].value;
+      return true;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  return false;
+}
+
+void id_map_set(id_map_t *map, uint32_t key, uint32_t value) {
+  if (!key) return;
+
+  /* 负载因子保持在 1/2 以下，探测链足够短 */
+  if ((map->count + 1) * 2 > map->capacity) id_map_grow(map);
+
+  id_map_insert_entry(map, key, value);
+}
+
+bool id_map_remove(id_map_t *map, uint32_t key) {
+  if (!key || !map->count) return false;
+
+  size_t mask = map->capacity - 1;
+  size_t slot = id_map_slot(map->capacity, key);
+  while (map->entries[slot].key != key) {
+    if (!map->entries[slot].key) return false;
+    slot = (slot + 1) & mask;
+  }
+
+  /*
+   * backward shift：把后续同一探测链上的条目前移填补空洞，
+   * 使查找仍可在遇到空槽时终止。
+   */
+  size_t hole = slot;
+  size_t next = (hole + 1) & mask;
+  while (map->entries[next].key) {
+    size_t home = id_map_slot(map->capacity, map->entries[next].key);
+    /* home 不在 (hole, next] 区间内时，条目可以移动到 hole */
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      map->entries[hole] = map->entries[next];
+      hole               = next;
+    }
+    next = (next + 1) & mask;
+  }
+
+  map->entries[hole].key   = 0;
+  map->entries[hole].value = 0;
+  map->count--;
+  return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file id_map.h
+ * @brief uint32 id 到 uint32 值的开放寻址哈希表。
+ *
+ * 线性探测，容量始终为 2 的幂，负载因子不超过 1/2；删除时使用向后平移
+ * （backward shift），不留墓碑。
+ *
+ * key 为 0 表示空槽位，因此 0 不能作为 key 使用（与 ZDWM_WINDOW_ID_INVALID
+ * 一致）。
+ */
+
+typedef struct id_map_entry_t {
+  uint32_t key;
+  uint32_t value;
+} id_map_entry_t;
+
+typedef struct id_map_t {
+  id_map_entry_t *entries;
+  size_t count;
+  size_t capacity;
+} id_map_t;
+
+void id_map_cleanup(id_map_t *map);
+/** @brief 清空所有条目但保留已分配的容量。 */
+void id_map_reset(id_map_t *map);
+
+/**
+ * @brief 查找 key 对应的值
+ *
+ * @param value_out 查找成功时写入对应值，可为 nullptr
+ * @return key 存在时返回 true，否则返回 false
+ */
+bool id_map_get(const id_map_t *map, uint32_t key, uint32_t *value_out);
+
+/** @brief 插入或覆盖 key 对应的值，key 不能为 0 */
+void id_map_set(id_map_t *map, uint32_t key, uint32_t value);
+
+/** @brief 删除 key，key 存在时返回 true */
+bool id_map_remove(id_map_t *map, uint32_t key);
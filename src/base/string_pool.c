@@ -0,0 +1,149 @@
+#include "base/string_pool.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "base/memory.h"
+
+static constexpr size_t STRING_POOL_INIT_CAPACITY = 16;
+
+struct string_pool_entry_t {
+  uint32_t hash;
+  uint32_t refcount;
+  size_t len;
+  char str[];
+};
+
+/* FNV-1a */
+static uint32_t string_hash(const char *str, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= (uint8_t)str[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static inline string_pool_entry_t *string_pool_entry_of(const char *str) {
+  return (string_pool_entry_t *)(str - offsetof(string_pool_entry_t, str));
+}
+
+static inline size_t string_pool_home(size_t capacity, uint32_t hash) {
+  return (size_t)hash & (capacity - 1);
+}
+
+/* 返回 str 所在槽位，不存在时返回其探测链末尾的空槽位 */
+static size_t string_pool_probe(
+  const string_pool_t *pool,
+  const char *str,
+  size_t len,
+  uint32_t hash
+) {
+  size_t mask = pool->capacity - 1;
+  size_t slot = string_pool_home(pool->capacity, hash);
+  while (pool->slots[slot]) {
+    const string_pool_entry_t *entry = pool->slots[slot];
+    if (entry->hash == hash && entry->len == len &&
+        memcmp(entry->str, str, len) == 0) {
+      return slot;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  return slot;
+}
+
+static void string_pool_grow(string_pool_t *pool) {
+  string_pool_entry_t **old_slots = pool->slots;
+  size_t old_capacity             = pool->capacity;
+
+  pool->capacity = old_capacity ? old_capacity * 2 : STRING_POOL_INIT_CAPACITY;
+  pool->slots    = p_new(string_pool_entry_t *, pool->capacity);
+
+  size_t mask = pool->capacity - 1;
+  for (size_t i = 0; i < old_capacity; ++i) {
+    string_pool_entry_t *entry = old_slots[i];
+    if (!entry) continue;
+
+    size_t slot = string_pool_home(pool->capacity, entry->hash);
+    while (pool->slots[slot]) slot = (slot + 1) & mask;
+    pool->slots[slot] = entry;
+  }
+
+  p_delete(&old_slots);
+}
+
+void string_pool_cleanup(string_pool_t *pool) {
+  for (size_t i = 0; i < pool->capacity; ++i) {
+    p_delete(&pool->slots[i]);
+  }
+  p_delete(&pool->slots);
+  pool->count    = 0;
+  pool->capacity = 0;
+}
+
+const char *string_pool_intern(string_pool_t *pool, const char *str) {
+  if (!str) return nullptr;
+
+  /* 负载因子保持在 1/2 以下，探测链足够短 */
+  if ((pool->count + 1) * 2 > pool->capacity) string_pool_grow(pool);
+
+  size_t len    = strlen(str);
+  uint32_t hash = string_hash(str, len);
+  size_t slot   = string_pool_probe(pool, str, len, hash);
+
+  string_pool_entry_t *entry = pool->slots[slot];
+  if (entry) {
+    entry->refcount++;
+    return entry->str;
+  }
+
+  entry           = xmalloc((ssize_t)(sizeof(*entry) + len + 1));
+  entry->hash     = hash;
+  entry->refcount = 1;
+  entry->len      = len;
+  memcpy(entry->str, str, len + 1);
+
+  pool->slots[slot] = entry;
+  pool->count++;
+  return entry->str;
+}
+
+const char *string_pool_find(const string_pool_t *pool, const char *str) {
+  if (!str || !pool->count) return nullptr;
+
+  size_t len  = strlen(str);
+  size_t slot = string_pool_probe(pool, str, len, string_hash(str, len));
+  return pool->slots[slot] ? pool->slots[slot]->str : nullptr;
+}
+
+void string_pool_release(string_pool_t *pool, const char *str) {
+  if (!str) return;
+
+  string_pool_entry_t *entry = string_pool_entry_of(str);
+  if (--entry->refcount) return;
+
+  size_t mask = pool->capacity - 1;
+  size_t hole = string_pool_home(pool->capacity, entry->hash);
+  while (pool->slots[hole] != entry) hole = (hole + 1) & mask;
+
+  /* backward shift，与 id_map_remove 相同 */
+  size_t next = (hole + 1) & mask;
+  while (pool->slots[next]) {
+    size_t home = string_pool_home(pool->capacity, pool->slots[next]->hash);
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      pool->slots[hole] = pool->slots[next];
+      hole              = next;
+    }
+    next = (next + 1) & mask;
+  }
+
+  pool->slots[hole] = nullptr;
+  pool->count--;
+  p_delete(&entry);
+}
+
+uint32_t string_pool_refcount(const char *str) {
+  return str ? string_pool_entry_of(str)->refcount : 0;
+}
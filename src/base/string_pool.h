@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @file string_pool.h
+ * @brief 带引用计数的字符串驻留池。
+ *
+ * 内容相同的字符串只保存一份，驻留后的指针在引用计数归零前保持不变，
+ * 因此同一个池中的两个驻留字符串可以直接比较指针判断是否相等。
+ *
+ * 哈希表为线性探测，容量始终为 2 的幂，负载因子不超过 1/2；删除时使用
+ * 向后平移（backward shift），不留墓碑。
+ */
+
+typedef struct string_pool_entry_t string_pool_entry_t;
+
+typedef struct string_pool_t {
+  string_pool_entry_t **slots;
+  size_t count;
+  size_t capacity;
+} string_pool_t;
+
+/** @brief 释放池中所有字符串，不论其引用计数。 */
+void string_pool_cleanup(string_pool_t *pool);
+
+/**
+ * @brief 驻留字符串并增加其引用计数
+ *
+ * @return 驻留后的字符串；str 为 nullptr 时返回 nullptr
+ */
+const char *string_pool_intern(string_pool_t *pool, const char *str);
+
+/**
+ * @brief 查找已驻留的字符串，不改变引用计数
+ *
+ * @return 池中与 str 内容相同的驻留字符串，不存在时返回 nullptr
+ */
+const char *string_pool_find(const string_pool_t *pool, const char *str);
+
+/**
+ * @brief 减少驻留字符串的引用计数，归零时从池中删除
+ *
+ * @param str 必须是 string_pool_intern 返回的指针，可为 nullptr
+ */
+void string_pool_release(string_pool_t *pool, const char *str);
+
+/** @brief 驻留字符串当前的引用计数；str 为 nullptr 时返回 0 */
+uint32_t string_pool_refcount(const char *str);
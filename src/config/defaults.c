@@ -12,6 +12,16 @@ static void spawn(const zdwm_action_ctx_t *ctx, const zdwm_action_arg_t *arg) {
   ctx->spawn(arg->str);
 }
 
+static void
+focus_previous(const zdwm_action_ctx_t *ctx, const zdwm_action_arg_t *arg) {
+  ctx->focus_previous(ctx);
+}
+
+static void
+focus_next_mru(const zdwm_action_ctx_t *ctx, const zdwm_action_arg_t *arg) {
+  ctx->focus_next_mru(ctx);
+}
+
 bool config_defaults_build(
   const zdwm_api_t *api,
   zdwm_config_builder_t *builder,
@@ -75,6 +85,8 @@ bool config_defaults_build(
   api->bind(builder, mode, key, fn, (zdwm_action_arg_t)arg)
 
   BIND(default_mode, "Mod4+r", spawn, {.str = launcher});
+  BIND(default_mode, "Mod4+Tab", focus_previous, {});
+  BIND(default_mode, "Mod4+Shift+Tab", focus_next_mru, {});
 
 #undef BIND
 
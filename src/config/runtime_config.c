@@ -27,9 +27,12 @@ struct zdwm_config_builder_t {
   size_t workspace_capacity;
   size_t output_count;
   border_config_t border;
+  uint32_t title_refresh_interval_ms;
   binding_table_t *binding_table;
 };
 
+static constexpr uint32_t TITLE_REFRESH_INTERVAL_MS = 100;
+
 void runtime_config_cleanup(runtime_init_desc_t *desc) {
   if (!desc) return;
 
@@ -196,6 +199,13 @@ static void runtime_config_set_border_config(
   color_parse(focused, &builder->border.focused_color);
 }
 
+static void runtime_config_set_title_refresh_interval(
+  zdwm_config_builder_t *builder,
+  uint32_t interval_ms
+) {
+  builder->title_refresh_interval_ms = interval_ms;
+}
+
 static bool config_builder_finish(
   zdwm_config_builder_t *builder,
   runtime_init_desc_t *out
@@ -206,15 +216,16 @@ static bool config_builder_finish(
 
   if (!layout_registry_move(&builder->layouts, &out->layouts)) return false;
   if (!rules_move(&builder->rules, &out->rules)) return false;
-  out->border                 = builder->border;
-  out->binding_table          = builder->binding_table;
-  out->workspaces             = builder->workspaces;
-  out->workspace_count        = builder->workspace_count;
-  builder->binding_table      = nullptr;
-  builder->workspaces         = nullptr;
-  builder->workspace_count    = 0;
-  builder->workspace_capacity = 0;
-  builder->output_count       = 0;
+  out->border                    = builder->border;
+  out->title_refresh_interval_ms = builder->title_refresh_interval_ms;
+  out->binding_table             = builder->binding_table;
+  out->workspaces                = builder->workspaces;
+  out->workspace_count           = builder->workspace_count;
+  builder->binding_table         = nullptr;
+  builder->workspaces            = nullptr;
+  builder->workspace_count       = 0;
+  builder->workspace_capacity    = 0;
+  builder->output_count          = 0;
   return true;
 }
 
@@ -225,9 +236,10 @@ static bool runtime_config_build(
   runtime_init_desc_t *out
 ) {
   if (!setup || !out) return false;
-  zdwm_config_builder_t builder = {0};
-  builder.output_count          = output_count;
-  builder.binding_table         = binding_table_create();
+  zdwm_config_builder_t builder     = {0};
+  builder.output_count              = output_count;
+  builder.binding_table             = binding_table_create();
+  builder.title_refresh_interval_ms = TITLE_REFRESH_INTERVAL_MS;
 
   zdwm_api_t api = {
     .abi_version = ZDWM_CONFIG_ABI_VERSION,
@@ -237,14 +249,15 @@ static bool runtime_config_build(
         .fullscreen = fullscreen,
         .maximize   = maximize,
       },
-    .register_layout   = runtime_config_register_layout,
-    .define_workspace  = runtime_config_define_workspace,
-    .add_rule          = runtime_config_add_rule,
-    .add_mode          = runtime_config_add_mode,
-    .bind              = runtime_config_bind,
-    .set_default_mode  = runtime_config_set_default_mode,
-    .set_initial_mode  = runtime_config_set_initial_mode,
-    .set_border_config = runtime_config_set_border_config,
+    .register_layout            = runtime_config_register_layout,
+    .define_workspace           = runtime_config_define_workspace,
+    .add_rule                   = runtime_config_add_rule,
+    .add_mode                   = runtime_config_add_mode,
+    .bind                       = runtime_config_bind,
+    .set_default_mode           = runtime_config_set_default_mode,
+    .set_initial_mode           = runtime_config_set_initial_mode,
+    .set_border_config          = runtime_config_set_border_config,
+    .set_title_refresh_interval = runtime_config_set_title_refresh_interval,
   };
   bool ok = setup(&api, &builder, outputs, output_count) &&
             config_builder_finish(&builder, out);
@@ -1,6 +1,7 @@
 #include "core/action.h"
 
 #include <paths.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -12,6 +13,11 @@ void spawn(const char *command) {
     setsid();
 
     if (fork() == 0) {
+      /* 主循环屏蔽了退出/重启信号，屏蔽字会跨 exec 继承 */
+      sigset_t mask;
+      sigemptyset(&mask);
+      sigprocmask(SIG_SETMASK, &mask, nullptr);
+
       execl(_PATH_BSHELL, _PATH_BSHELL, "-c", command, nullptr);
       fatal("execl fail: %s", command);
     }
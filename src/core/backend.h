@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "core/event.h"
 #include "core/plan.h"
@@ -32,8 +33,55 @@ void backend_detect_destroy(backend_detect_t *detect);
  * 无需 cleanup 的状态，调用方可以直接退出循环。
  */
 bool backend_next_event(backend_t *backend, event_t *event);
+/**
+ * @brief 不阻塞地取出已经到达的下一个可路由事件
+ * @details
+ * 读取连接上已经到达的数据，不等待新的数据。事件所有权与
+ * backend_next_event() 相同；没有可路由事件时返回 false，`event` 无需
+ * cleanup。
+ */
+bool backend_poll_event(backend_t *backend, event_t *event);
+/**
+ * @brief backend 连接的文件描述符
+ * @details
+ * 供外部事件循环等待：fd 可读时反复调用 backend_poll_event() 直到返回
+ * false。backend 可能在其他调用中提前读入数据，因此每次应用副作用之后也要
+ * 再取一遍，而不能只依赖 fd 的可读状态。
+ */
+int backend_get_fd(const backend_t *backend);
+/**
+ * @brief 距 backend 需要再次被轮询的毫秒数
+ * @details
+ * backend 有内部定时任务（如到期后读取过期的窗口标题）时，即便 fd 不可读，
+ * 也应在超时后调用 backend_poll_event()；没有定时任务时返回 -1。
+ */
+int backend_poll_timeout(const backend_t *backend);
 bool backend_apply_effect(
   backend_t *backend,
   const effect_t *effects,
   size_t effect_count
 );
+
+typedef struct backend_stats_t {
+  uint64_t title_fetches;              /* 实际读取窗口标题的次数 */
+  uint64_t title_fetches_skipped;      /* 因去抖而省掉的标题读取次数 */
+  uint64_t configure_requests;         /* 实际发出的 ConfigureWindow 次数 */
+  uint64_t configure_requests_skipped; /* 与已提交几何相同而省掉的次数 */
+  uint64_t restack_requests;           /* 实际发出的堆叠调整次数 */
+  uint64_t restack_requests_skipped;   /* 按最少移动计算后省掉的次数 */
+  uint64_t window_list_bytes;          /* 写入窗口列表属性的字节数 */
+  uint64_t request_errors;             /* 收到的 X 错误数 */
+} backend_stats_t;
+
+/**
+ * @brief 设置窗口标题刷新的最小间隔
+ * @details
+ * 同一窗口两次读取标题至少间隔 interval_ms；间隔内的标题变化只记为过期，
+ * 在间隔结束时读取一次最终值，因此最后一次变化总会被报告。0 表示每次变化
+ * 都立即读取。
+ */
+void backend_set_title_refresh_interval(
+  backend_t *backend,
+  uint32_t interval_ms
+);
+void backend_get_stats(const backend_t *backend, backend_stats_t *stats);
@@ -0,0 +1,388 @@
+#include "core/checkpoint.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base/array.h"
+#include "base/log.h"
+#include "base/memory.h"
+#include "core/state.h"
+#include "core/types.h"
+#include "core/window.h"
+#include "core/wm_desc.h"
+
+static constexpr uint32_t CHECKPOINT_MAGIC     = 0x43574d5a; /* "ZMWC" */
+static constexpr uint32_t CHECKPOINT_VERSION   = 1;
+static constexpr uint32_t CHECKPOINT_NO_STRING = UINT32_MAX;
+
+typedef struct checkpoint_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;     /* 负载字节数 */
+  uint32_t checksum; /* 负载的 FNV-1a */
+} checkpoint_header_t;
+
+typedef enum checkpoint_window_flag_t {
+  CHECKPOINT_WINDOW_FULLSCREEN   = 1u << 0,
+  CHECKPOINT_WINDOW_MAXIMIZED    = 1u << 1,
+  CHECKPOINT_WINDOW_MINIMIZED    = 1u << 2,
+  CHECKPOINT_WINDOW_FLOATING     = 1u << 3,
+  CHECKPOINT_WINDOW_STICKY       = 1u << 4,
+  CHECKPOINT_WINDOW_URGENT       = 1u << 5,
+  CHECKPOINT_WINDOW_FIXED_SIZE   = 1u << 6,
+  CHECKPOINT_WINDOW_SKIP_TASKBAR = 1u << 7,
+} checkpoint_window_flag_t;
+
+typedef struct checkpoint_writer_t {
+  uint8_t *data;
+  size_t count;
+  size_t capacity;
+} checkpoint_writer_t;
+
+typedef struct checkpoint_reader_t {
+  const uint8_t *data;
+  size_t size;
+  size_t offset;
+  bool ok;
+} checkpoint_reader_t;
+
+static uint32_t checkpoint_checksum(const uint8_t *data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= data[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+static void writer_put(checkpoint_writer_t *w, const void *src, size_t size) {
+  array_reserve(w->data, w->capacity, w->count + size);
+  memcpy(w->data + w->count, src, size);
+  w->count += size;
+}
+
+static void writer_u32(checkpoint_writer_t *w, uint32_t value) {
+  writer_put(w, &value, sizeof(value));
+}
+
+static void writer_rect(checkpoint_writer_t *w, rect_t rect) {
+  writer_put(w, &rect, sizeof(rect));
+}
+
+/* 长度 + 内容 + 结尾 NUL，加载时可直接引用缓冲区中的字符串 */
+static void writer_string(checkpoint_writer_t *w, const char *str) {
+  if (!str) {
+    writer_u32(w, CHECKPOINT_NO_STRING);
+    return;
+  }
+
+  size_t len = strlen(str);
+  writer_u32(w, (uint32_t)len);
+  writer_put(w, str, len + 1);
+}
+
+static bool reader_get(checkpoint_reader_t *r, void *dst, size_t size) {
+  if (!r->ok || r->size - r->offset < size) {
+    r->ok = false;
+    memset(dst, 0, size);
+    return false;
+  }
+
+  memcpy(dst, r->data + r->offset, size);
+  r->offset += size;
+  return true;
+}
+
+static uint32_t reader_u32(checkpoint_reader_t *r) {
+  uint32_t value = 0;
+  reader_get(r, &value, sizeof(value));
+  return value;
+}
+
+static rect_t reader_rect(checkpoint_reader_t *r) {
+  rect_t rect = {0};
+  reader_get(r, &rect, sizeof(rect));
+  return rect;
+}
+
+static const char *reader_string(checkpoint_reader_t *r) {
+  uint32_t len = reader_u32(r);
+  if (!r->ok || len == CHECKPOINT_NO_STRING) return nullptr;
+
+  if (r->size - r->offset <= len || r->data[r->offset + len] != '\0') {
+    r->ok = false;
+    return nullptr;
+  }
+
+  auto str   = (const char *)r->data + r->offset;
+  r->offset += (size_t)len + 1;
+  return str;
+}
+
+static uint32_t checkpoint_window_flags(const window_t *window) {
+  uint32_t flags = 0;
+  if (window->fullscreen) flags |= CHECKPOINT_WINDOW_FULLSCREEN;
+  if (window->maximized) flags |= CHECKPOINT_WINDOW_MAXIMIZED;
+  if (window->minimized) flags |= CHECKPOINT_WINDOW_MINIMIZED;
+  if (window->floating) flags |= CHECKPOINT_WINDOW_FLOATING;
+  if (window->sticky) flags |= CHECKPOINT_WINDOW_STICKY;
+  if (window->urgent) flags |= CHECKPOINT_WINDOW_URGENT;
+  if (window->fixed_size) flags |= CHECKPOINT_WINDOW_FIXED_SIZE;
+  if (window->skip_taskbar) flags |= CHECKPOINT_WINDOW_SKIP_TASKBAR;
+  return flags;
+}
+
+/*
+ * 负载布局：
+ *   outputs    数量、当前 output 下标、每个 output 的当前 workspace 与工作区域
+ *   windows    按加入顺序的窗口记录，父窗口总在 transient 子窗口之前
+ *   workspaces 布局、焦点窗口、成员（加入顺序）、焦点历史（由旧到新）
+ *   layers     每层自顶向底的窗口 id
+ */
+static void checkpoint_encode(const state_t *state, checkpoint_writer_t *w) {
+  writer_u32(w, (uint32_t)state->output_count);
+  writer_u32(w, (uint32_t)state->workspace_count);
+  writer_u32(w, (uint32_t)state->current_output_index);
+  for (size_t i = 0; i < state->output_count; ++i) {
+    writer_u32(w, state->outputs[i].current_workspace_id);
+    writer_rect(w, state->outputs[i].workarea);
+  }
+
+  writer_u32(w, (uint32_t)state->window_count);
+  for (auto window = state_window_first(state); window;
+       window      = state_window_next(state, window)) {
+    auto attrs = state_window_attrs(state, window->id);
+    writer_u32(w, window->id);
+    writer_u32(w, window->transient_for);
+    writer_u32(w, window->layer);
+    writer_u32(w, checkpoint_window_flags(window));
+    writer_u32(w, window->border_width);
+    writer_rect(w, window->float_rect);
+    writer_rect(w, window->frame_rect);
+    writer_string(w, attrs->title);
+    writer_string(w, attrs->app_id);
+    writer_string(w, attrs->role);
+    writer_string(w, attrs->class_name);
+    writer_string(w, attrs->instance_name);
+  }
+
+  for (size_t i = 0; i < state->workspace_count; ++i) {
+    const workspace_t *workspace = &state->workspaces[i];
+    writer_u32(w, workspace->layout_id);
+    writer_u32(w, workspace->focused_window_id);
+
+    writer_u32(w, (uint32_t)workspace->window_count);
+    for (auto window = state_workspace_window_first(state, workspace->id);
+         window;
+         window = state_workspace_window_next(state, window)) {
+      writer_u32(w, window->id);
+    }
+
+    size_t count_offset = w->count;
+    uint32_t mru_count  = 0;
+    writer_u32(w, mru_count);
+    for (uint32_t index = workspace->mru_tail; index != WINDOW_SLOT_NONE;
+         index          = state->window_slots[index].mru_prev) {
+      writer_u32(w, state->windows[index].id);
+      mru_count++;
+    }
+    memcpy(w->data + count_offset, &mru_count, sizeof(mru_count));
+  }
+
+  for (size_t i = 0; i < ZDWM_WINDOW_LAYER_COUNT; ++i) {
+    const layer_stack_t *layer = &state->stacks[i];
+    writer_u32(w, (uint32_t)layer->count);
+    for (window_id_t id = layer_stack_top(layer); id;
+         id             = layer_stack_below(layer, id)) {
+      writer_u32(w, id);
+    }
+  }
+}
+
+/*
+ * 解码负载；state 为 nullptr 时只做结构校验，不修改任何状态。
+ * 校验通过后再以同一份负载恢复，恢复阶段不会再失败。
+ */
+static bool checkpoint_decode(
+  checkpoint_reader_t *r,
+  const state_t *shape,
+  state_t *state
+) {
+  uint32_t output_count    = reader_u32(r);
+  uint32_t workspace_count = reader_u32(r);
+  uint32_t current_output  = reader_u32(r);
+  if (output_count != shape->output_count ||
+      workspace_count != shape->workspace_count ||
+      current_output >= output_count) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < output_count && r->ok; ++i) {
+    workspace_id_t workspace_id = reader_u32(r);
+    rect_t workarea             = reader_rect(r);
+    if (!state) continue;
+
+    output_id_t output_id = state->outputs[i].id;
+    state_output_set_current_workspace(state, output_id, workspace_id, nullptr);
+    state_output_set_workarea(state, output_id, workarea);
+  }
+  if (state) state_set_current_output(state, state->outputs[current_output].id);
+
+  uint32_t window_count = reader_u32(r);
+  for (uint32_t i = 0; i < window_count && r->ok; ++i) {
+    window_id_t id            = reader_u32(r);
+    window_id_t transient_for = reader_u32(r);
+    uint32_t layer            = reader_u32(r);
+    uint32_t flags            = reader_u32(r);
+    uint32_t border_width     = reader_u32(r);
+    rect_t float_rect         = reader_rect(r);
+    rect_t frame_rect         = reader_rect(r);
+    /* 初始化列表中的求值顺序不确定，字符串需要逐个按顺序读取 */
+    const char *title         = reader_string(r);
+    const char *app_id        = reader_string(r);
+    const char *role          = reader_string(r);
+    const char *class_name    = reader_string(r);
+    const char *instance_name = reader_string(r);
+    if (id == ZDWM_WINDOW_ID_INVALID || layer >= ZDWM_WINDOW_LAYER_COUNT) {
+      return false;
+    }
+    if (!state || !r->ok) continue;
+
+    window_info_t info = {
+      .id            = id,
+      .transient_for = transient_for,
+      .frame_rect    = frame_rect,
+      .title         = title,
+      .app_id        = app_id,
+      .role          = role,
+      .class_name    = class_name,
+      .instance_name = instance_name,
+      .layer_type    = (window_layer_type_t)layer,
+      .fullscreen    = flags & CHECKPOINT_WINDOW_FULLSCREEN,
+      .maximized     = flags & CHECKPOINT_WINDOW_MAXIMIZED,
+      .minimized     = flags & CHECKPOINT_WINDOW_MINIMIZED,
+      .urgent        = flags & CHECKPOINT_WINDOW_URGENT,
+      .fixed_size    = flags & CHECKPOINT_WINDOW_FIXED_SIZE,
+      .skip_taskbar  = flags & CHECKPOINT_WINDOW_SKIP_TASKBAR,
+    };
+    state_window_add(state, &info);
+    state_window_set_sticky(state, id, flags & CHECKPOINT_WINDOW_STICKY);
+    state_window_set_floating(state, id, flags & CHECKPOINT_WINDOW_FLOATING);
+    state_window_set_float_rect(state, id, float_rect);
+    state_window_set_border_width(state, id, border_width);
+  }
+
+  for (workspace_id_t i = 0; i < workspace_count && r->ok; ++i) {
+    layout_id_t layout_id  = reader_u32(r);
+    window_id_t focused_id = reader_u32(r);
+    if (state) state_workspace_set_layout_by_id(state, i, layout_id);
+
+    uint32_t member_count = reader_u32(r);
+    for (uint32_t j = 0; j < member_count && r->ok; ++j) {
+      window_id_t id = reader_u32(r);
+      if (state) state_window_set_workspace(state, id, i);
+    }
+
+    /* 由旧到新重放焦点历史，最后聚焦的窗口回到历史最前 */
+    uint32_t mru_count = reader_u32(r);
+    for (uint32_t j = 0; j < mru_count && r->ok; ++j) {
+      window_id_t id = reader_u32(r);
+      if (state) state_workspace_set_focused_window(state, i, id);
+    }
+    if (state && focused_id != ZDWM_WINDOW_ID_INVALID) {
+      state_workspace_set_focused_window(state, i, focused_id);
+    }
+  }
+
+  /* 自顶向底依次沉到层底，最终得到原来的顺序 */
+  for (size_t i = 0; i < ZDWM_WINDOW_LAYER_COUNT && r->ok; ++i) {
+    uint32_t count = reader_u32(r);
+    for (uint32_t j = 0; j < count && r->ok; ++j) {
+      window_id_t id = reader_u32(r);
+      if (state) state_stack_lower(state, id, nullptr);
+    }
+  }
+
+  return r->ok && r->offset == r->size;
+}
+
+static bool checkpoint_write_all(int fd, const void *data, size_t size) {
+  auto p = (const uint8_t *)data;
+  while (size) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p    += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+static bool checkpoint_read_all(int fd, void *data, size_t size) {
+  auto p = (uint8_t *)data;
+  while (size) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    p    += n;
+    size -= (size_t)n;
+  }
+  return true;
+}
+
+bool state_checkpoint_write(const state_t *state, int fd) {
+  checkpoint_writer_t writer = {0};
+  checkpoint_encode(state, &writer);
+
+  checkpoint_header_t header = {
+    .magic    = CHECKPOINT_MAGIC,
+    .version  = CHECKPOINT_VERSION,
+    .size     = (uint32_t)writer.count,
+    .checksum = checkpoint_checksum(writer.data, writer.count),
+  };
+  bool ok = checkpoint_write_all(fd, &header, sizeof(header)) &&
+            checkpoint_write_all(fd, writer.data, writer.count);
+
+  p_delete(&writer.data);
+  return ok;
+}
+
+bool state_checkpoint_read(state_t *state, int fd) {
+  if (state->window_count) return false;
+
+  checkpoint_header_t header = {0};
+  if (!checkpoint_read_all(fd, &header, sizeof(header))) return false;
+  if (header.magic != CHECKPOINT_MAGIC ||
+      header.version != CHECKPOINT_VERSION) {
+    warn("checkpoint: unknown format %#x v%u", header.magic, header.version);
+    return false;
+  }
+
+  /* 负载长度不能超过文件剩余部分，避免按损坏的长度分配内存 */
+  struct stat st = {0};
+  off_t offset   = lseek(fd, 0, SEEK_CUR);
+  if (fstat(fd, &st) || offset < 0 || st.st_size - offset < header.size) {
+    warn("checkpoint: truncated payload of %u bytes", header.size);
+    return false;
+  }
+
+  uint8_t *data = p_new(uint8_t, header.size);
+  bool ok       = checkpoint_read_all(fd, data, header.size) &&
+            checkpoint_checksum(data, header.size) == header.checksum;
+
+  checkpoint_reader_t reader = {.data = data, .size = header.size, .ok = true};
+  ok = ok && checkpoint_decode(&reader, state, nullptr);
+  if (ok) {
+    reader.offset = 0;
+    checkpoint_decode(&reader, state, state);
+  } else {
+    warn("checkpoint: corrupted payload of %u bytes", header.size);
+  }
+
+  p_delete(&data);
+  return ok;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "core/state.h"
+
+/**
+ * @file checkpoint.h
+ * @brief state 的二进制检查点，用于重启时跨 exec 保留窗口管理状态。
+ *
+ * 检查点记录窗口（id、transient 关系、flags、几何、元数据）、workspace
+ * 成员与焦点历史、各层堆叠顺序以及 output 的当前 workspace。outputs 与
+ * workspaces 本身仍由配置构建，加载时只校验数量一致。
+ *
+ * 文件由固定头部（魔数、版本、负载长度、校验和）加负载组成，字节序与
+ * 结构布局只保证在同一个可执行文件的两次运行之间一致。
+ */
+
+/**
+ * @brief 将 state 写入 fd 当前位置
+ *
+ * @return 全部写入成功返回 true
+ */
+bool state_checkpoint_write(const state_t *state, int fd);
+
+/**
+ * @brief 从 fd 当前位置读取检查点并恢复到 state
+ *
+ * state 必须刚由 state_init() 初始化且尚无窗口。检查点会先被完整校验，
+ * 校验失败时 state 保持不变。
+ *
+ * @return 恢复成功返回 true
+ */
+bool state_checkpoint_read(state_t *state, int fd);
@@ -12,6 +12,8 @@ typedef enum command_type_t {
   ZDWM_COMMAND_CONFIGURE_WINDOW,
   ZDWM_COMMAND_CHANGE_WINDOW_STATE,
   ZDWM_COMMAND_SWITCH_WORKSPACE,
+  ZDWM_COMMAND_FOCUS_PREVIOUS, /* 当前 workspace 焦点历史中的上一个窗口 */
+  ZDWM_COMMAND_FOCUS_NEXT_MRU, /* 按焦点历史顺序轮换到下一个窗口 */
 } command_type_t;
 
 typedef struct manage_window_command_t {
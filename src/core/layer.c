@@ -1,88 +1,132 @@
 #include "core/layer.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include "base/array.h"
+#include "base/id_map.h"
 #include "base/memory.h"
 #include "core/types.h"
 
-void layer_stack_cleanup(layer_stack_t *layer) {
-  p_delete(&layer->order);
-  layer->count    = 0;
-  layer->capacity = 0;
-}
+static constexpr uint32_t LAYER_NODE_NONE = UINT32_MAX;
 
-void layer_stack_append(layer_stack_t *layer, window_id_t window) {
-  window_id_t *win_ptr =
-    array_push(layer->order, layer->count, layer->capacity);
-  *win_ptr = window;
+static void layer_stack_link_top(layer_stack_t *layer, uint32_t index) {
+  layer_node_t *node = &layer->nodes[index];
+  node->prev         = layer->top;
+  node->next         = LAYER_NODE_NONE;
+  if (layer->top != LAYER_NODE_NONE) {
+    layer->nodes[layer->top].next = index;
+  } else {
+    layer->bottom = index;
+  }
+  layer->top = index;
 }
 
-bool layer_stack_remove(layer_stack_t *layer, window_id_t window) {
-  bool found   = false;
-  size_t index = 0;
-  for (size_t i = 0; i < layer->count; ++i) {
-    if (layer->order[i] != window) continue;
-
-    found = true;
-    index = i;
-    break;
+static void layer_stack_link_bottom(layer_stack_t *layer, uint32_t index) {
+  layer_node_t *node = &layer->nodes[index];
+  node->prev         = LAYER_NODE_NONE;
+  node->next         = layer->bottom;
+  if (layer->bottom != LAYER_NODE_NONE) {
+    layer->nodes[layer->bottom].prev = index;
+  } else {
+    layer->top = index;
   }
+  layer->bottom = index;
+}
 
-  if (found) {
-    for (size_t i = index; i < layer->count - 1; ++i) {
-      layer->order[i] = layer->order[i + 1];
-    }
-    layer->count--;
+static void layer_stack_unlink(layer_stack_t *layer, uint32_t index) {
+  layer_node_t *node = &layer->nodes[index];
+  if (node->prev != LAYER_NODE_NONE) {
+    layer->nodes[node->prev].next = node->next;
+  } else {
+    layer->bottom = node->next;
   }
+  if (node->next != LAYER_NODE_NONE) {
+    layer->nodes[node->next].prev = node->prev;
+  } else {
+    layer->top = node->prev;
+  }
+}
 
-  return found;
+void layer_stack_init(layer_stack_t *layer) {
+  p_clear(layer, 1);
+  layer->free_head = LAYER_NODE_NONE;
+  layer->bottom    = LAYER_NODE_NONE;
+  layer->top       = LAYER_NODE_NONE;
 }
 
-bool layer_stack_raise(layer_stack_t *layer, window_id_t window) {
-  bool found   = false;
-  size_t index = 0;
-  for (size_t i = 0; i < layer->count; ++i) {
-    if (layer->order[i] != window) continue;
-
-    found = true;
-    index = i;
-    break;
+void layer_stack_cleanup(layer_stack_t *layer) {
+  p_delete(&layer->nodes);
+  id_map_cleanup(&layer->index);
+  layer_stack_init(layer);
+}
+
+void layer_stack_append(layer_stack_t *layer, window_id_t window) {
+  if (id_map_get(&layer->index, window, nullptr)) return;
+
+  uint32_t index = layer->free_head;
+  if (index != LAYER_NODE_NONE) {
+    layer->free_head = layer->nodes[index].next;
+  } else {
+    array_push(layer->nodes, layer->node_count, layer->capacity);
+    index = (uint32_t)(layer->node_count - 1);
   }
 
-  if (!found) return false;
+  layer->nodes[index].window = window;
+  layer_stack_link_top(layer, index);
+  id_map_set(&layer->index, window, index);
+  layer->count++;
+}
 
-  bool need_change = index != layer->count - 1;
-  if (!need_change) return false;
+bool layer_stack_remove(layer_stack_t *layer, window_id_t window) {
+  uint32_t index = 0;
+  if (!id_map_get(&layer->index, window, &index)) return false;
 
-  for (size_t i = index; i < layer->count - 1; ++i) {
-    layer->order[i] = layer->order[i + 1];
-  }
-  layer->order[layer->count - 1] = window;
+  layer_stack_unlink(layer, index);
+  id_map_remove(&layer->index, window);
+
+  layer_node_t *node = &layer->nodes[index];
+  node->window       = ZDWM_WINDOW_ID_INVALID;
+  node->prev         = LAYER_NODE_NONE;
+  node->next         = layer->free_head;
+  layer->free_head   = index;
+  layer->count--;
 
   return true;
 }
 
-bool layer_stack_lower(layer_stack_t *layer, window_id_t window) {
-  bool found   = false;
-  size_t index = 0;
-  for (size_t i = 0; i < layer->count; ++i) {
-    if (layer->order[i] != window) continue;
-
-    found = true;
-    index = i;
-    break;
-  }
+bool layer_stack_raise(layer_stack_t *layer, window_id_t window) {
+  uint32_t index = 0;
+  if (!id_map_get(&layer->index, window, &index)) return false;
+  if (index == layer->top) return false;
+
+  layer_stack_unlink(layer, index);
+  layer_stack_link_top(layer, index);
+  return true;
+}
 
-  if (!found) return false;
+bool layer_stack_lower(layer_stack_t *layer, window_id_t window) {
+  uint32_t index = 0;
+  if (!id_map_get(&layer->index, window, &index)) return false;
+  if (index == layer->bottom) return false;
 
-  bool need_change = index != 0;
-  if (!need_change) return false;
+  layer_stack_unlink(layer, index);
+  layer_stack_link_bottom(layer, index);
+  return true;
+}
 
-  for (size_t i = index; i > 0; --i) {
-    layer->order[i] = layer->order[i - 1];
+window_id_t layer_stack_below(const layer_stack_t *layer, window_id_t window) {
+  uint32_t index = 0;
+  if (!id_map_get(&layer->index, window, &index)) {
+    return ZDWM_WINDOW_ID_INVALID;
   }
-  layer->order[0] = window;
 
-  return true;
+  uint32_t prev = layer->nodes[index].prev;
+  if (prev == LAYER_NODE_NONE) return ZDWM_WINDOW_ID_INVALID;
+  return layer->nodes[prev].window;
+}
+
+window_id_t layer_stack_top(const layer_stack_t *layer) {
+  if (layer->top == LAYER_NODE_NONE) return ZDWM_WINDOW_ID_INVALID;
+  return layer->nodes[layer->top].window;
 }
@@ -1,15 +1,42 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include "base/id_map.h"
 #include "core/types.h"
 
+typedef struct layer_node_t {
+  window_id_t window;
+  uint32_t prev; /* 更低一层的节点 */
+  uint32_t next; /* 更高一层的节点；空闲节点时串起空闲链表 */
+} layer_node_t;
+
+/*
+ * 单层堆叠顺序
+ *
+ * 节点以双向链表从底（bottom）到顶（top）串联，index 记录窗口到节点的位置，
+ * 因此查找、删除、提升和下沉均为 O(1)。
+ */
 typedef struct layer_stack_t {
-  window_id_t *order;
-  size_t count;
+  layer_node_t *nodes;
+  size_t node_count; /* 已使用过的节点数，含空闲节点 */
   size_t capacity;
+  size_t count; /* 层内窗口数 */
+
+  uint32_t free_head;
+  uint32_t bottom;
+  uint32_t top;
+
+  id_map_t index; /* window id -> nodes[] 下标 */
 } layer_stack_t;
 
+/**
+ * @brief 初始化为空层栈。
+ * @param layer 目标层栈。
+ */
+void layer_stack_init(layer_stack_t *layer);
+
 /**
  * @brief 释放层栈内部资源并重置为空状态。
  * @param layer 目标层栈。
@@ -46,3 +73,17 @@ bool layer_stack_raise(layer_stack_t *layer, window_id_t window);
  * @return 仅在窗口存在且顺序发生变化时返回 true，否则返回 false。
  */
 bool layer_stack_lower(layer_stack_t *layer, window_id_t window);
+
+/**
+ * @brief 获取紧挨在指定窗口下方的窗口。
+ * @param layer 目标层栈。
+ * @param window 参照窗口 ID。
+ * @return 下方窗口 ID；窗口位于层底或不存在时返回 ZDWM_WINDOW_ID_INVALID。
+ */
+window_id_t layer_stack_below(const layer_stack_t *layer, window_id_t window);
+
+/**
+ * @brief 获取层栈顶部的窗口。
+ * @return 层栈为空时返回 ZDWM_WINDOW_ID_INVALID。
+ */
+window_id_t layer_stack_top(const layer_stack_t *layer);
@@ -3,6 +3,7 @@
 #include <stddef.h>
 
 #include "base/array.h"
+#include "base/id_map.h"
 #include "base/memory.h"
 #include "core/types.h"
 
@@ -15,7 +16,7 @@ static void free_memory_hold_by_effects(effect_t *effects, size_t count) {
       p_delete(&effect->as.change_window_list.windows);
       break;
     case ZDWM_EFFECT_RESTACK_WINDOWS:
-      p_delete(&effect->as.restack_windows.windows);
+      p_delete(&effect->as.restack_windows.items);
       break;
     case ZDWM_EFFECT_BIND_KEY:
       p_delete(&effect->as.bind_key.keys);
@@ -38,6 +39,7 @@ void plan_cleanup(plan_t *plan) {
   p_delete(&plan->effects);
   plan->count    = 0;
   plan->capacity = 0;
+  id_map_cleanup(&plan->window_effects);
 }
 
 void plan_push_effect(plan_t *plan, const effect_t *effect) {
@@ -95,6 +97,16 @@ void plan_push_withdraw_effect(plan_t *plan, window_id_t window_id) {
   plan_push_effect(plan, &effect);
 }
 
+void plan_push_watch_effect(plan_t *plan, window_id_t window_id) {
+  if (window_id_invalid(window_id)) return;
+
+  effect_t effect = {
+    .type            = ZDWM_EFFECT_WATCH_WINDOW,
+    .as.watch.window = window_id,
+  };
+  plan_push_effect(plan, &effect);
+}
+
 void plan_push_fullscreen_effect(
   plan_t *plan,
   window_id_t window_id,
@@ -162,3 +174,107 @@ void plan_push_change_border_color_effect(
   };
   plan_push_effect(plan, &effect);
 }
+
+void plan_push_restack_effect(
+  plan_t *plan,
+  const restack_item_t *items,
+  size_t count
+) {
+  if (!items || !count) return;
+
+  effect_t effect = {
+    .type               = ZDWM_EFFECT_RESTACK_WINDOWS,
+    .as.restack_windows = {
+      .items = p_copy(items, count),
+      .count = count,
+    },
+  };
+  plan_push_effect(plan, &effect);
+}
+
+/* 被删除的副作用先标记为 0，最后统一压缩 */
+static constexpr effect_type_t EFFECT_DROPPED = 0;
+
+/*
+ * 同一窗口相继的 map 与 unmap 相互抵消。policy 只会 map 隐藏的窗口、unmap
+ * 可见的窗口，因此一对相反的副作用应用前后窗口状态不变；backend 又总是先
+ * unmap 再 map，先 map 后 unmap 的一对如果照常应用，窗口反而会保持映射。
+ */
+static void plan_cancel_map_pairs(plan_t *plan) {
+  auto pending = &plan->window_effects;
+  id_map_reset(pending);
+
+  for (size_t i = 0; i < plan->count; ++i) {
+    auto effect = &plan->effects[i];
+    window_id_t window;
+    if (effect->type == ZDWM_EFFECT_MAP_WINDOW) {
+      window = effect->as.map.window;
+    } else if (effect->type == ZDWM_EFFECT_UNMAP_WINDOW) {
+      window = effect->as.unmap.window;
+    } else {
+      continue;
+    }
+
+    uint32_t index = 0;
+    if (!id_map_get(pending, window, &index)) {
+      id_map_set(pending, window, (uint32_t)i);
+      continue;
+    }
+
+    /* 相反则两个一起删除，相同则是重复，只删除后一个 */
+    auto previous = &plan->effects[index];
+    if (previous->type != effect->type) {
+      previous->type = EFFECT_DROPPED;
+      id_map_remove(pending, window);
+    }
+    effect->type = EFFECT_DROPPED;
+  }
+}
+
+/* 从后向前保留最后一次焦点与每个窗口最后一次边框颜色 */
+static void plan_keep_last_writes(plan_t *plan) {
+  auto seen = &plan->window_effects;
+  id_map_reset(seen);
+
+  bool focus_seen = false;
+  for (size_t i = plan->count; i-- > 0;) {
+    auto effect = &plan->effects[i];
+    switch (effect->type) {
+    case ZDWM_EFFECT_FOCUS_WINDOW:
+      if (focus_seen) effect->type = EFFECT_DROPPED;
+      focus_seen = true;
+      break;
+    case ZDWM_EFFECT_CHANGE_BORDER_COLOR: {
+      auto window = effect->as.change_border_color.window;
+      if (id_map_get(seen, window, nullptr)) {
+        effect->type = EFFECT_DROPPED;
+      } else {
+        id_map_set(seen, window, (uint32_t)i);
+      }
+    } break;
+    case ZDWM_EFFECT_CONFIGURE_WINDOW:
+      if (!effect->as.configure.changed_fields) effect->type = EFFECT_DROPPED;
+      break;
+    default:
+    }
+  }
+}
+
+size_t plan_optimize(plan_t *plan) {
+  if (!plan->count) return 0;
+
+  plan_cancel_map_pairs(plan);
+  plan_keep_last_writes(plan);
+
+  size_t count = 0;
+  for (size_t i = 0; i < plan->count; ++i) {
+    if (plan->effects[i].type == EFFECT_DROPPED) continue;
+    if (count != i) plan->effects[count] = plan->effects[i];
+    count++;
+  }
+
+  size_t dropped = plan->count - count;
+  p_clear(plan->effects + count, dropped);
+  plan->count = count;
+  return dropped;
+}
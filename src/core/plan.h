@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "base/color.h"
+#include "base/id_map.h"
 #include "core/types.h"
 
 typedef enum effect_type_t {
@@ -20,6 +21,8 @@ typedef enum effect_type_t {
   ZDWM_EFFECT_CHANGE_WINDOW_LIST,
   ZDWM_EFFECT_RESTACK_WINDOWS,
   ZDWM_EFFECT_BIND_KEY,
+  /* 重新订阅窗口的事件，窗口已不存在时 backend 报告 WINDOW_REMOVE */
+  ZDWM_EFFECT_WATCH_WINDOW,
 } effect_type_t;
 
 typedef struct effect_move_window_t {
@@ -43,6 +46,12 @@ typedef struct effect_window_list_t {
   size_t count;
 } effect_window_list_t;
 
+/* 只携带堆叠顺序发生变化的窗口，按顺序逐个应用 */
+typedef struct effect_restack_t {
+  const restack_item_t *items;
+  size_t count;
+} effect_restack_t;
+
 typedef struct effect_bind_key_t {
   const key_bind_t *keys;
   size_t count;
@@ -67,8 +76,9 @@ typedef struct effect_t {
     configure_data_t configure;
     effect_change_border_color_t change_border_color;
     effect_window_list_t change_window_list;
-    effect_window_list_t restack_windows;
+    effect_restack_t restack_windows;
     effect_bind_key_t bind_key;
+    only_window_data_t watch;
   } as;
 } effect_t;
 
@@ -76,18 +86,35 @@ typedef struct plan_t {
   effect_t *effects;
   size_t count;
   size_t capacity;
+  /* 需要布局；只有被 state 标记为 dirty 的 output 会重新计算 */
   bool need_relayout;
+  /* plan_optimize() 按窗口查找副作用用的临时表，保留容量供下一批复用 */
+  id_map_t window_effects;
 } plan_t;
 
 void plan_reset(plan_t *plan);
 void plan_cleanup(plan_t *plan);
 void plan_push_effect(plan_t *plan, const effect_t *effect);
 
+/**
+ * @brief 在交给 backend 之前删除冗余的副作用
+ * @details
+ * - 同一窗口相继的 map 与 unmap 相互抵消，重复的 map 或 unmap 只保留第一个；
+ * - 焦点只保留最后一次，边框颜色每个窗口只保留最后一次；
+ * - 删除没有任何字段变化的 configure。
+ *
+ * 其余副作用保持原有的相对顺序。
+ *
+ * @return 删除的副作用数量
+ */
+size_t plan_optimize(plan_t *plan);
+
 void plan_push_map_effect(plan_t *plan, window_id_t window_id);
 void plan_push_unmap_effect(plan_t *plan, window_id_t window_id);
 void plan_push_focus_effect(plan_t *plan, window_id_t window_id);
 void plan_push_kill_effect(plan_t *plan, window_id_t window_id);
 void plan_push_withdraw_effect(plan_t *plan, window_id_t window_id);
+void plan_push_watch_effect(plan_t *plan, window_id_t window_id);
 void plan_push_fullscreen_effect(
   plan_t *plan,
   window_id_t window_id,
@@ -100,3 +127,8 @@ void plan_push_change_border_color_effect(
   window_id_t window_id,
   const color_t *color
 );
+void plan_push_restack_effect(
+  plan_t *plan,
+  const restack_item_t *items,
+  size_t count
+);
@@ -18,6 +18,22 @@
 #include "core/window.h"
 #include "core/wm_desc.h"
 
+/* 把动作的请求翻译为命令，追加到 userdata 指向的命令缓冲区 */
+static void
+action_push_command(const zdwm_action_ctx_t *ctx, command_type_t type) {
+  command_buffer_t *out = ctx->userdata;
+  command_t command     = {.type = type};
+  command_buffer_push(out, &command);
+}
+
+void policy_action_focus_previous(const zdwm_action_ctx_t *ctx) {
+  action_push_command(ctx, ZDWM_COMMAND_FOCUS_PREVIOUS);
+}
+
+void policy_action_focus_next_mru(const zdwm_action_ctx_t *ctx) {
+  action_push_command(ctx, ZDWM_COMMAND_FOCUS_NEXT_MRU);
+}
+
 static void route_key_press(
   binding_table_t *binding_table,
   const zdwm_action_ctx_t *action_ctx,
@@ -89,7 +105,8 @@ static void route_map_request(
   };
 
   rule_action_t action = {.workspace = ZDWM_WORKSPACE_ID_INVALID};
-  bool have_rule_match = rules_resolve(rules, &e->metadata, &action);
+  bool have_rule_match =
+    rules_resolve(rules, &state->strings, &e->metadata, &action);
   if (have_rule_match) {
     manage_window_command_t *data = &manage_window_cmd.as.manage_window;
     if (action.workspace != ZDWM_WORKSPACE_ID_INVALID) {
@@ -250,8 +267,10 @@ static void manage_window(
   const manage_window_command_t *command,
   plan_t *plan
 ) {
-  auto state        = ctx->state;
-  auto window       = state_window_add(state, &command->info);
+  auto state  = ctx->state;
+  auto window = state_window_add(state, &command->info);
+  if (!window) return;
+
   auto window_id    = window->id;
   auto workspace_id = command->workspace;
   state_window_set_workspace(state, window_id, workspace_id);
@@ -265,6 +284,11 @@ static void manage_window(
     state_window_set_border_width(state, window_id, ctx->border->width);
   }
 
+  restack_item_t move = {0};
+  if (state_stack_place(state, window_id, &move)) {
+    plan_push_restack_effect(plan, &move, 1);
+  }
+
   if (!state_workspace_show(state, command->workspace)) return;
 
   plan_push_map_effect(plan, window_id);
@@ -300,15 +324,14 @@ static void add_switch_workspace_effects(
   workspace_id_t new_workspace,
   plan_t *plan
 ) {
-  for (size_t i = 0; i < state->window_count; ++i) {
-    window_t *window = &state->windows[i];
-    if (window->sticky) continue;
-
-    if (window->workspace_id == old_workspace) {
-      plan_push_unmap_effect(plan, window->id);
-    } else if (window->workspace_id == new_workspace) {
-      plan_push_map_effect(plan, window->id);
-    }
+  for (auto window = state_workspace_window_first(state, old_workspace); window;
+       window = state_workspace_window_next(state, window)) {
+    if (!window->sticky) plan_push_unmap_effect(plan, window->id);
+  }
+
+  for (auto window = state_workspace_window_first(state, new_workspace); window;
+       window = state_workspace_window_next(state, window)) {
+    if (!window->sticky) plan_push_map_effect(plan, window->id);
   }
 
   const workspace_t *workspace = state_workspace_get(state, new_workspace);
@@ -358,6 +381,20 @@ focus_window(const policy_context_t *ctx, window_id_t window, plan_t *plan) {
   plan_push_focus_effect(plan, workspace->focused_window_id);
 }
 
+/* 焦点历史的查询与轮换都是 O(1)，不扫描窗口 */
+static void
+focus_history(const policy_context_t *ctx, bool rotate, plan_t *plan) {
+  auto state        = ctx->state;
+  auto workspace_id = derive_window_workspace(state);
+
+  window_id_t window = rotate
+                         ? state_workspace_mru_rotate(state, workspace_id)
+                         : state_workspace_mru_previous(state, workspace_id);
+  if (window_id_invalid(window)) return;
+
+  focus_window(ctx, window, plan);
+}
+
 static void kill_window(state_t *state, window_id_t window, plan_t *plan) {
   auto win = state_window_get(state, window);
   if (!win) return;
@@ -644,6 +681,12 @@ void policy_apply_command(
     case ZDWM_COMMAND_SWITCH_WORKSPACE:
       switch_workspace(state, &cmd->as.switch_workspace, plan);
       break;
+    case ZDWM_COMMAND_FOCUS_PREVIOUS:
+      focus_history(ctx, false, plan);
+      break;
+    case ZDWM_COMMAND_FOCUS_NEXT_MRU:
+      focus_history(ctx, true, plan);
+      break;
     }
   }
 }
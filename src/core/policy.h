@@ -17,9 +17,18 @@ typedef struct policy_context_t {
   const rules_t *rules;
   const border_config_t *border;
   const layout_registry_t *layouts;
+  /* 按键动作的上下文，userdata 为动作产生的命令所追加到的命令缓冲区 */
   const zdwm_action_ctx_t action_ctx;
 } policy_context_t;
 
+/**
+ * @brief 按键动作的回调，供构造 zdwm_action_ctx_t 时填入
+ *
+ * 把请求翻译为命令，追加到 ctx->userdata 指向的 command_buffer_t。
+ */
+void policy_action_focus_previous(const zdwm_action_ctx_t *ctx);
+void policy_action_focus_next_mru(const zdwm_action_ctx_t *ctx);
+
 /**
  * @brief 事件路由：将运行时事件翻译为语义命令
  *
@@ -1,7 +1,6 @@
 #include "core/rules.h"
 
 #include <stddef.h>
-#include <string.h>
 #include <zdwm/types.h>
 
 #include "base/memory.h"
@@ -40,16 +39,39 @@ void rules_cleanup(rules_t *rules) {
   rules->count    = 0;
 }
 
-static inline bool str_match(const char *pattern, const char *value) {
-  return !pattern || (value && strcmp(pattern, value) == 0);
+static inline bool key_match(const char *pattern, const char *value) {
+  return !pattern || pattern == value;
 }
 
-static bool
-rule_match_window(const rule_match_t *match, const window_metadata_t *meta) {
-  return str_match(match->app_id, meta->app_id) &&
-         str_match(match->role, meta->role) &&
-         str_match(match->class_name, meta->class_name) &&
-         str_match(match->instance_name, meta->instance_name);
+static bool rule_key_match(const rule_key_t *key, const rule_key_t *window) {
+  return key_match(key->app_id, window->app_id) &&
+         key_match(key->role, window->role) &&
+         key_match(key->class_name, window->class_name) &&
+         key_match(key->instance_name, window->instance_name);
+}
+
+void rules_intern(rules_t *rules, string_pool_t *pool) {
+  for (size_t i = 0; i < rules->count; ++i) {
+    const rule_match_t *match = &rules->items[i].match;
+    rule_key_t *key           = &rules->items[i].key;
+
+    key->app_id        = string_pool_intern(pool, match->app_id);
+    key->role          = string_pool_intern(pool, match->role);
+    key->class_name    = string_pool_intern(pool, match->class_name);
+    key->instance_name = string_pool_intern(pool, match->instance_name);
+  }
+}
+
+void rules_release(rules_t *rules, string_pool_t *pool) {
+  for (size_t i = 0; i < rules->count; ++i) {
+    rule_key_t *key = &rules->items[i].key;
+
+    string_pool_release(pool, key->app_id);
+    string_pool_release(pool, key->role);
+    string_pool_release(pool, key->class_name);
+    string_pool_release(pool, key->instance_name);
+    p_clear(key, 1);
+  }
 }
 
 static void rule_action_merge(const rule_action_t *src, rule_action_t *dest) {
@@ -66,6 +88,7 @@ static void rule_action_merge(const rule_action_t *src, rule_action_t *dest) {
 
 bool rules_resolve(
   const rules_t *rules,
+  const string_pool_t *pool,
   const window_metadata_t *metadata,
   rule_action_t *action_out
 ) {
@@ -73,8 +96,14 @@ bool rules_resolve(
 
   bool matched = false;
 
+  rule_key_t window = {
+    .app_id        = string_pool_find(pool, metadata->app_id),
+    .role          = string_pool_find(pool, metadata->role),
+    .class_name    = string_pool_find(pool, metadata->class_name),
+    .instance_name = string_pool_find(pool, metadata->instance_name),
+  };
   for (size_t i = 0; i < rules->count; ++i) {
-    if (!rule_match_window(&rules->items[i].match, metadata)) continue;
+    if (!rule_key_match(&rules->items[i].key, &window)) continue;
 
     matched = true;
     rule_action_merge(&rules->items[i].action, action_out);
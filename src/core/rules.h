@@ -2,11 +2,21 @@
 
 #include <stddef.h>
 
+#include "base/string_pool.h"
 #include "core/types.h"
 #include "core/window.h"
 
+/* 规则匹配字符串在字符串池中的驻留指针，nullptr 表示不限制该字段 */
+typedef struct rule_key_t {
+  const char *app_id;
+  const char *role;
+  const char *class_name;
+  const char *instance_name;
+} rule_key_t;
+
 typedef struct rule_item_t {
   rule_match_t match;
+  rule_key_t key; /* 由 rules_intern 填充 */
   rule_action_t action;
 } rule_item_t;
 
@@ -19,8 +29,24 @@ typedef struct rules_t {
 bool rules_move(rules_t *src, rules_t *dest);
 void rules_cleanup(rules_t *rules);
 
+/**
+ * @brief 将每条规则的匹配字符串驻留到 pool
+ *
+ * 必须在 rules_resolve 之前调用；pool 需与 rules_resolve 使用同一个。
+ */
+void rules_intern(rules_t *rules, string_pool_t *pool);
+/** @brief 释放 rules_intern 持有的驻留引用 */
+void rules_release(rules_t *rules, string_pool_t *pool);
+
+/**
+ * @brief 合并所有匹配窗口元数据的规则动作
+ *
+ * 每个元数据字段只在 pool 中查找一次，之后与各规则按指针比较；
+ * 不在 pool 中的字符串不可能与任何规则相等。
+ */
 bool rules_resolve(
   const rules_t *rules,
+  const string_pool_t *pool,
   const window_metadata_t *metadata,
   rule_action_t *action_out
 );
@@ -1,26 +1,45 @@
+#define _GNU_SOURCE /* memfd_create */
+
 #include "core/runtime.h"
 
 #include <dlfcn.h>
+#include <errno.h>
+#include <signal.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <zdwm/layout.h>
 
 #include "action.h"
 #include "base/array.h"
+#include "base/event_loop.h"
+#include "base/log.h"
+#include "base/macros.h"
 #include "base/memory.h"
 #include "core/backend.h"
 #include "core/binding.h"
+#include "core/checkpoint.h"
 #include "core/command_buffer.h"
 #include "core/event.h"
 #include "core/layout.h"
 #include "core/plan.h"
 #include "core/policy.h"
 #include "core/rules.h"
+#include "core/snapshot.h"
 #include "core/state.h"
 #include "core/types.h"
 #include "core/window.h"
 #include "core/wm_desc.h"
 
+static constexpr char RUNTIME_CHECKPOINT_ENV[] = "ZDWM_CHECKPOINT_FD";
+/* 单批最多处理的事件数，避免事件持续到达时副作用迟迟得不到应用 */
+static constexpr size_t RUNTIME_EVENT_BATCH_MAX = 256;
+
 static bool runtime_workspace_desc_has_valid_layouts(
   const layout_registry_t *layouts,
   const workspace_desc_t *workspace
@@ -56,7 +75,13 @@ bool runtime_init(runtime_t *runtime, runtime_init_desc_t *desc) {
   if (!runtime || !runtime_init_desc_valid(desc)) return false;
 
   p_clear(runtime, 1);
+  if (!event_loop_init(&runtime->loop)) return false;
+
   runtime->backend = desc->backend;
+  backend_set_title_refresh_interval(
+    runtime->backend,
+    desc->title_refresh_interval_ms
+  );
   layout_registry_move(&desc->layouts, &runtime->layouts);
   rules_move(&desc->rules, &runtime->rules);
   runtime->border               = desc->border;
@@ -73,6 +98,9 @@ bool runtime_init(runtime_t *runtime, runtime_init_desc_t *desc) {
     desc->workspaces,
     desc->workspace_count
   );
+  rules_intern(&runtime->rules, &runtime->state.strings);
+  snapshot_publisher_init(&runtime->snapshots);
+  snapshot_publisher_publish(&runtime->snapshots, &runtime->state);
 
   workspace_desc_list_cleanup(&desc->workspaces, &desc->workspace_count);
   desc->outputs      = nullptr;
@@ -109,7 +137,9 @@ void runtime_shutdown(runtime_t *runtime) {
   plan_cleanup(&runtime->plan);
   command_buffer_cleanup(&runtime->command_buffer);
   layout_registry_cleanup(&runtime->layouts);
+  rules_release(&runtime->rules, &runtime->state.strings);
   rules_cleanup(&runtime->rules);
+  snapshot_publisher_cleanup(&runtime->snapshots);
   state_cleanup(&runtime->state);
   layout_result_cleanup(&runtime->layout_result);
   binding_table_destroy(runtime->binding_table);
@@ -118,6 +148,7 @@ void runtime_shutdown(runtime_t *runtime) {
   runtime->backend = nullptr;
   if (runtime->config_module_handle) dlclose(runtime->config_module_handle);
   runtime->config_module_handle = nullptr;
+  event_loop_cleanup(&runtime->loop);
 }
 
 void runtime_setup(runtime_t *runtime) {
@@ -153,7 +184,7 @@ static const layout_result_t *runtime_layout_calc(runtime_t *runtime) {
   auto state = &runtime->state;
   for (size_t i = 0; i < state->output_count; ++i) {
     auto output = state_output_at(state, i);
-    if (!output) continue;
+    if (!output || !state_output_need_relayout(state, output->id)) continue;
 
     auto workspace = state_workspace_get(state, output->current_workspace_id);
     if (!workspace) continue;
@@ -165,10 +196,9 @@ static const layout_result_t *runtime_layout_calc(runtime_t *runtime) {
     size_t window_list_capacity = 0;
     window_id_t *window_ids     = nullptr;
 
-    for (size_t j = 0; j < state_window_count(state); j++) {
-      auto window = state_window_at(state, j);
-      if (!window || window->workspace_id != workspace->id) continue;
-
+    for (auto window = state_workspace_window_first(state, workspace->id);
+         window;
+         window = state_workspace_window_next(state, window)) {
       if (window_need_layout(window)) {
         window_id_t *window_id_slot =
           array_push(window_ids, window_count, window_list_capacity);
@@ -257,9 +287,16 @@ static void runtime_arrange(runtime_t *runtime) {
   }
 }
 
-void runtime_run(runtime_t *runtime) {
-  runtime->running = true;
+static void runtime_stop(runtime_t *runtime) {
+  runtime->running = false;
+  event_loop_stop(&runtime->loop);
+}
 
+/*
+ * 取出 backend 已经到达的全部事件并逐批处理。应用副作用时 backend 可能顺带
+ * 读入了新的事件，这些事件不会再让 fd 变为可读，因此一直处理到取空为止。
+ */
+static void runtime_process_events(runtime_t *runtime) {
   backend_t *backend               = runtime->backend;
   command_buffer_t *command_buffer = &runtime->command_buffer;
   plan_t *plan                     = &runtime->plan;
@@ -271,22 +308,191 @@ void runtime_run(runtime_t *runtime) {
     .border     = &runtime->border,
     .layouts    = &runtime->layouts,
     .action_ctx = {
-      .spawn = spawn,
+      .spawn          = spawn,
+      .focus_previous = policy_action_focus_previous,
+      .focus_next_mru = policy_action_focus_next_mru,
+      .userdata       = command_buffer,
     },
   };
 
-  while (runtime->running) {
-    event_t event = {0};
-    if (!backend_next_event(backend, &event)) break;
-
-    command_buffer_reset(command_buffer);
+  event_t event = {0};
+  while (runtime->running && backend_poll_event(backend, &event)) {
     plan_reset(plan);
 
-    policy_route_event(&ctx, &event, command_buffer);
-    policy_apply_command(&ctx, command_buffer, plan);
+    /*
+     * 逐个路由并应用命令，整批只布局一次、应用一次副作用。后一个事件的
+     * 路由依赖前一个事件修改后的 state，因此命令不能攒到最后一起应用。
+     */
+    bool state_changed = false;
+    size_t batch_count = 0;
+    do {
+      command_buffer_reset(command_buffer);
+      policy_route_event(&ctx, &event, command_buffer);
+      policy_apply_command(&ctx, command_buffer, plan);
+      state_changed |= command_buffer->count != 0;
+      event_reset(&event);
+    } while (++batch_count < RUNTIME_EVENT_BATCH_MAX &&
+             backend_poll_event(backend, &event));
+
     if (plan->need_relayout) runtime_arrange(runtime);
+    runtime->effects_eliminated += plan_optimize(plan);
     if (plan->count) backend_apply_effect(backend, plan->effects, plan->count);
+    state_clear_dirty(&runtime->state);
+    /* 没有命令的事件不会修改 state，沿用上一次发布的快照 */
+    if (state_changed) {
+      snapshot_publisher_publish(&runtime->snapshots, &runtime->state);
+    }
+  }
 
-    event_cleanup(&event);
+  /* backend 的定时任务不会让 fd 变为可读，由定时器在到期时再取一次 */
+  auto loop   = &runtime->loop;
+  auto timer  = &runtime->backend_timer;
+  int timeout = backend_poll_timeout(backend);
+  if (timeout < 0) {
+    event_loop_timer_stop(loop, timer);
+  } else {
+    event_loop_timer_start(loop, timer, (uint64_t)timeout * 1000000u, 0);
   }
 }
+
+static void runtime_backend_ready(event_loop_io_t *io, uint32_t events) {
+  runtime_t *runtime = io->userdata;
+  runtime_process_events(runtime);
+
+  /* 连接已断开，已经到达的事件处理完后退出 */
+  if (events & (EPOLLHUP | EPOLLERR)) runtime_stop(runtime);
+}
+
+static void runtime_backend_timeout(event_loop_timer_t *timer) {
+  runtime_process_events(timer->userdata);
+}
+
+static void runtime_signal(event_loop_t *loop, int signo, void *userdata) {
+  runtime_t *runtime = userdata;
+  if (signo == SIGHUP) runtime->will_restart = true;
+  runtime_stop(runtime);
+}
+
+void runtime_run(runtime_t *runtime) {
+  static const int stop_signals[] = {SIGINT, SIGTERM, SIGHUP};
+
+  auto loop           = &runtime->loop;
+  runtime->backend_io = (event_loop_io_t){
+    .fd       = backend_get_fd(runtime->backend),
+    .events   = EPOLLIN,
+    .fn       = runtime_backend_ready,
+    .userdata = runtime,
+  };
+  runtime->backend_timer = (event_loop_timer_t){
+    .fn       = runtime_backend_timeout,
+    .userdata = runtime,
+  };
+  if (!event_loop_add_io(loop, &runtime->backend_io)) return;
+
+  /* 信号保持屏蔽到 runtime_shutdown()，退出前到达的信号不会打断检查点 */
+  for (size_t i = 0; i < countof(stop_signals); ++i) {
+    event_loop_add_signal(loop, stop_signals[i], runtime_signal, runtime);
+  }
+
+  runtime->running = true;
+  /* runtime_setup()、runtime_restore() 期间 backend 可能已经读入了事件 */
+  runtime_process_events(runtime);
+  if (runtime->running) event_loop_run(loop);
+  runtime->running = false;
+
+  event_loop_timer_stop(loop, &runtime->backend_timer);
+  event_loop_remove_io(loop, &runtime->backend_io);
+}
+
+int runtime_checkpoint(const runtime_t *runtime) {
+  int fd = memfd_create("zdwm-checkpoint", 0);
+  if (fd < 0) {
+    warn("memfd_create failed: %s", strerror(errno));
+    return -1;
+  }
+
+  if (!state_checkpoint_write(&runtime->state, fd) ||
+      lseek(fd, 0, SEEK_SET) != 0) {
+    warn("failed to write checkpoint");
+    close(fd);
+    return -1;
+  }
+
+  char value[16];
+  snprintf(value, sizeof(value), "%d", fd);
+  setenv(RUNTIME_CHECKPOINT_ENV, value, 1);
+  return fd;
+}
+
+/* 为恢复出的窗口生成订阅、映射、堆叠与焦点副作用 */
+static void runtime_restore_effects(runtime_t *runtime) {
+  auto state = &runtime->state;
+  auto plan  = &runtime->plan;
+
+  /*
+   * 事件订阅属于旧进程的连接，exec 后随之失效。隐藏的窗口不会再被映射，
+   * 因此每个窗口都要重新订阅；重启期间已经销毁的窗口由 backend 报告移除
+   */
+  for (auto window = state_window_first(state); window;
+       window      = state_window_next(state, window)) {
+    plan_push_watch_effect(plan, window->id);
+  }
+
+  for (size_t i = 0; i < state->output_count; ++i) {
+    auto workspace_id = state->outputs[i].current_workspace_id;
+    for (auto window = state_workspace_window_first(state, workspace_id);
+         window;
+         window = state_workspace_window_next(state, window)) {
+      if (!window->minimized) plan_push_map_effect(plan, window->id);
+    }
+  }
+
+  size_t move_count     = 0;
+  size_t move_capacity  = 0;
+  restack_item_t *moves = nullptr;
+  for (size_t i = ZDWM_WINDOW_LAYER_COUNT; i > 0; --i) {
+    auto layer = &state->stacks[i - 1];
+    for (window_id_t id = layer_stack_top(layer); id;
+         id             = layer_stack_below(layer, id)) {
+      restack_item_t *move = array_push(moves, move_count, move_capacity);
+      state_stack_place(state, id, move);
+    }
+  }
+  /* 自底向顶应用，每个窗口放到已就位的下方窗口之上 */
+  for (size_t i = 0, j = move_count; i + 1 < j; ++i, --j) {
+    restack_item_t tmp = moves[i];
+    moves[i]           = moves[j - 1];
+    moves[j - 1]       = tmp;
+  }
+  plan_push_restack_effect(plan, moves, move_count);
+  p_delete(&moves);
+
+  auto output    = state_output_at(state, state->current_output_index);
+  auto workspace = state_workspace_get(state, output->current_workspace_id);
+  plan_push_focus_effect(plan, workspace->focused_window_id);
+}
+
+bool runtime_restore(runtime_t *runtime) {
+  const char *value = getenv(RUNTIME_CHECKPOINT_ENV);
+  if (!value) return false;
+
+  char *end = nullptr;
+  long fd   = strtol(value, &end, 10);
+  unsetenv(RUNTIME_CHECKPOINT_ENV);
+  if (end == value || *end || fd < 0) return false;
+
+  bool restored = state_checkpoint_read(&runtime->state, (int)fd);
+  close((int)fd);
+  if (!restored) return false;
+
+  auto plan = &runtime->plan;
+  plan_reset(plan);
+  runtime_restore_effects(runtime);
+  runtime_arrange(runtime);
+  backend_apply_effect(runtime->backend, plan->effects, plan->count);
+  plan_reset(plan);
+  state_clear_dirty(&runtime->state);
+  snapshot_publisher_publish(&runtime->snapshots, &runtime->state);
+
+  return true;
+}
@@ -3,12 +3,14 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "base/event_loop.h"
 #include "core/backend.h"
 #include "core/binding.h"
 #include "core/command_buffer.h"
 #include "core/layout.h"
 #include "core/plan.h"
 #include "core/rules.h"
+#include "core/snapshot.h"
 #include "core/state.h"
 #include "core/types.h"
 
@@ -20,6 +22,7 @@ typedef struct runtime_init_desc_t {
   layout_registry_t layouts;
   rules_t rules;
   border_config_t border;
+  uint32_t title_refresh_interval_ms;
   workspace_desc_t *workspaces;
   size_t workspace_count;
   void *config_module_handle;
@@ -31,8 +34,12 @@ typedef struct runtime_t {
   bool will_restart;
 
   plan_t plan;
+  /* plan_optimize() 累计删除的冗余副作用数 */
+  uint64_t effects_eliminated;
   command_buffer_t command_buffer;
   state_t state;
+  /* 每批事件处理完后发布的只读快照，供其他线程读取 */
+  snapshot_publisher_t snapshots;
   layout_result_t layout_result;
   layout_registry_t layouts;
   rules_t rules;
@@ -40,10 +47,42 @@ typedef struct runtime_t {
   backend_t *backend;
   void *config_module_handle;
   binding_table_t *binding_table;
+
+  /*
+   * 主循环。除 backend 连接、backend 的定时任务与退出/重启信号外，其他服务
+   * 可以在 runtime_run() 之前向其注册自己的 fd、定时器与信号。
+   */
+  event_loop_t loop;
+  event_loop_io_t backend_io;
+  event_loop_timer_t backend_timer;
 } runtime_t;
 
 bool runtime_init(runtime_t *runtime, runtime_init_desc_t *desc);
 void runtime_init_desc_cleanup(runtime_init_desc_t *desc);
 void runtime_shutdown(runtime_t *runtime);
 void runtime_setup(runtime_t *runtime);
+/**
+ * @brief 运行主循环，直到收到 SIGINT/SIGTERM/SIGHUP 或 backend 连接断开
+ *
+ * SIGHUP 会设置 will_restart。
+ */
 void runtime_run(runtime_t *runtime);
+
+/**
+ * @brief 重启前将 state 写入检查点
+ *
+ * 检查点写在不带 CLOEXEC 的 memfd 中，fd 通过环境变量传给 exec 之后的
+ * 新进程，须在 runtime_shutdown() 之前调用。
+ *
+ * @return 成功返回 memfd，失败返回 -1
+ */
+int runtime_checkpoint(const runtime_t *runtime);
+/**
+ * @brief 从上一个进程留下的检查点恢复 state
+ *
+ * 在 runtime_init() 之后调用。成功时重新订阅全部窗口的事件，重新映射可见
+ * 窗口、恢复堆叠顺序与焦点并重新布局，无需逐个查询窗口；重启期间已经
+ * 销毁的窗口随后作为 WINDOW_REMOVE 事件到达。没有检查点或检查点无效时
+ * 返回 false，state 保持为空。
+ */
+bool runtime_restore(runtime_t *runtime);
@@ -0,0 +1,252 @@
+#include "core/snapshot.h"
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base/array.h"
+#include "base/memory.h"
+#include "core/state.h"
+#include "core/types.h"
+#include "core/window.h"
+
+static size_t snapshot_align(size_t size) {
+  constexpr size_t align = alignof(max_align_t);
+  return (size + align - 1) & ~(align - 1);
+}
+
+static size_t snapshot_string_size(const char *str) {
+  return str ? strlen(str) + 1 : 0;
+}
+
+static const char *snapshot_copy_string(char **cursor, const char *str) {
+  if (!str) return nullptr;
+
+  size_t size = strlen(str) + 1;
+  char *dst   = *cursor;
+  memcpy(dst, str, size);
+  *cursor += size;
+  return dst;
+}
+
+static void snapshot_window_fill(
+  snapshot_window_t *dst,
+  const state_t *state,
+  const window_t *window,
+  char **cursor
+) {
+  auto attrs         = state_window_attrs(state, window->id);
+  dst->window        = *window;
+  dst->title         = snapshot_copy_string(cursor, attrs->title);
+  dst->app_id        = snapshot_copy_string(cursor, attrs->app_id);
+  dst->role          = snapshot_copy_string(cursor, attrs->role);
+  dst->class_name    = snapshot_copy_string(cursor, attrs->class_name);
+  dst->instance_name = snapshot_copy_string(cursor, attrs->instance_name);
+}
+
+state_snapshot_t *state_snapshot_create(const state_t *state) {
+  size_t output_count    = state->output_count;
+  size_t workspace_count = state->workspace_count;
+  size_t window_count    = state->window_count;
+
+  size_t string_size = 0;
+  for (size_t i = 0; i < output_count; ++i) {
+    string_size += snapshot_string_size(state->outputs[i].name);
+  }
+  for (size_t i = 0; i < workspace_count; ++i) {
+    string_size += snapshot_string_size(state->workspaces[i].name);
+  }
+  for (auto window = state_window_first(state); window;
+       window      = state_window_next(state, window)) {
+    auto attrs   = state_window_attrs(state, window->id);
+    string_size += snapshot_string_size(attrs->title);
+    string_size += snapshot_string_size(attrs->app_id);
+    string_size += snapshot_string_size(attrs->role);
+    string_size += snapshot_string_size(attrs->class_name);
+    string_size += snapshot_string_size(attrs->instance_name);
+  }
+
+  size_t outputs_offset = snapshot_align(sizeof(state_snapshot_t));
+  size_t workspaces_offset =
+    outputs_offset + snapshot_align(sizeof(snapshot_output_t) * output_count);
+  size_t windows_offset =
+    workspaces_offset +
+    snapshot_align(sizeof(snapshot_workspace_t) * workspace_count);
+  size_t strings_offset =
+    windows_offset + snapshot_align(sizeof(snapshot_window_t) * window_count);
+
+  char *block = p_new(char, strings_offset + string_size);
+  auto outputs    = (snapshot_output_t *)(block + outputs_offset);
+  auto workspaces = (snapshot_workspace_t *)(block + workspaces_offset);
+  auto windows    = (snapshot_window_t *)(block + windows_offset);
+  char *cursor    = block + strings_offset;
+
+  for (size_t i = 0; i < output_count; ++i) {
+    const output_t *output = &state->outputs[i];
+    snapshot_output_t *dst = &outputs[i];
+    dst->id                   = output->id;
+    dst->current_workspace_id = output->current_workspace_id;
+    dst->name                 = snapshot_copy_string(&cursor, output->name);
+    dst->geometry             = output->geometry;
+    dst->workarea             = output->workarea;
+  }
+
+  size_t window_index = 0;
+  for (size_t i = 0; i < workspace_count; ++i) {
+    const workspace_t *workspace = &state->workspaces[i];
+    snapshot_workspace_t *dst    = &workspaces[i];
+    dst->id                      = workspace->id;
+    dst->output_id               = workspace->output_id;
+    dst->layout_id               = workspace->layout_id;
+    dst->focused_window_id       = workspace->focused_window_id;
+    dst->name          = snapshot_copy_string(&cursor, workspace->name);
+    dst->window_offset = window_index;
+
+    for (auto window = state_workspace_window_first(state, workspace->id);
+         window;
+         window = state_workspace_window_next(state, window)) {
+      snapshot_window_fill(&windows[window_index++], state, window, &cursor);
+    }
+    dst->window_count = window_index - dst->window_offset;
+  }
+
+  for (auto window = state_window_first(state); window;
+       window      = state_window_next(state, window)) {
+    if (state_workspace_valid(state, window->workspace_id)) continue;
+    snapshot_window_fill(&windows[window_index++], state, window, &cursor);
+  }
+
+  auto snapshot = (state_snapshot_t *)block;
+  atomic_init(&snapshot->refcount, 1);
+  snapshot->focused_window_id = ZDWM_WINDOW_ID_INVALID;
+  if (state->current_output_index < output_count) {
+    const output_t *output = &state->outputs[state->current_output_index];
+    auto workspace = state_workspace_get(state, output->current_workspace_id);
+    snapshot->current_output_id = output->id;
+    if (workspace) snapshot->focused_window_id = workspace->focused_window_id;
+  }
+  snapshot->outputs         = outputs;
+  snapshot->output_count    = output_count;
+  snapshot->workspaces      = workspaces;
+  snapshot->workspace_count = workspace_count;
+  snapshot->windows         = windows;
+  snapshot->window_count    = window_index;
+
+  return snapshot;
+}
+
+state_snapshot_t *state_snapshot_retain(state_snapshot_t *snapshot) {
+  atomic_fetch_add_explicit(&snapshot->refcount, 1, memory_order_relaxed);
+  return snapshot;
+}
+
+void state_snapshot_release(state_snapshot_t *snapshot) {
+  if (!snapshot) return;
+
+  if (atomic_fetch_sub_explicit(
+        &snapshot->refcount,
+        1,
+        memory_order_acq_rel
+      ) == 1) {
+    free(snapshot);
+  }
+}
+
+void snapshot_publisher_init(snapshot_publisher_t *publisher) {
+  atomic_init(&publisher->current, nullptr);
+  atomic_init(&publisher->epoch, 0);
+  atomic_init(&publisher->acquiring[0], 0);
+  atomic_init(&publisher->acquiring[1], 0);
+  publisher->sequence         = 0;
+  publisher->retired          = nullptr;
+  publisher->retired_count    = 0;
+  publisher->retired_capacity = 0;
+  publisher->grace_count      = 0;
+}
+
+static void snapshot_publisher_release_retired(
+  snapshot_publisher_t *publisher,
+  size_t count
+) {
+  if (!count) return;
+
+  for (size_t i = 0; i < count; ++i) {
+    state_snapshot_release(publisher->retired[i]);
+  }
+  publisher->retired_count -= count;
+  memmove(
+    publisher->retired,
+    publisher->retired + count,
+    sizeof(*publisher->retired) * publisher->retired_count
+  );
+}
+
+void snapshot_publisher_cleanup(snapshot_publisher_t *publisher) {
+  state_snapshot_release(atomic_exchange(&publisher->current, nullptr));
+  snapshot_publisher_release_retired(publisher, publisher->retired_count);
+  p_delete(&publisher->retired);
+  publisher->retired_capacity = 0;
+  publisher->grace_count      = 0;
+}
+
+/* 翻转 epoch 之前开始 acquire 的读者都已离开时，释放当时已被替换的快照 */
+static bool snapshot_publisher_end_grace(snapshot_publisher_t *publisher) {
+  unsigned int epoch = atomic_load(&publisher->epoch);
+  if (atomic_load(&publisher->acquiring[(epoch - 1) & 1])) return false;
+
+  snapshot_publisher_release_retired(publisher, publisher->grace_count);
+  publisher->grace_count = 0;
+  return true;
+}
+
+static void snapshot_publisher_reclaim(snapshot_publisher_t *publisher) {
+  if (publisher->grace_count && !snapshot_publisher_end_grace(publisher)) {
+    return;
+  }
+  if (!publisher->retired_count) return;
+
+  publisher->grace_count = publisher->retired_count;
+  atomic_fetch_add(&publisher->epoch, 1);
+  snapshot_publisher_end_grace(publisher);
+}
+
+void snapshot_publisher_publish(
+  snapshot_publisher_t *publisher,
+  const state_t *state
+) {
+  auto snapshot      = state_snapshot_create(state);
+  snapshot->sequence = ++publisher->sequence;
+
+  auto old = atomic_exchange(&publisher->current, snapshot);
+  if (old) {
+    state_snapshot_t **slot = array_push(
+      publisher->retired,
+      publisher->retired_count,
+      publisher->retired_capacity
+    );
+    *slot = old;
+  }
+  snapshot_publisher_reclaim(publisher);
+}
+
+state_snapshot_t *snapshot_publisher_acquire(snapshot_publisher_t *publisher) {
+  unsigned int epoch = atomic_load(&publisher->epoch);
+  atomic_fetch_add(&publisher->acquiring[epoch & 1], 1);
+
+  /*
+   * 计入之后 epoch 已经翻转时，发布者可能已在旧计数为 0 时释放过快照，
+   * 改为计入新的计数，确认 epoch 不再变化之后才读取指针
+   */
+  for (unsigned int now; (now = atomic_load(&publisher->epoch)) != epoch;
+       epoch = now) {
+    atomic_fetch_add(&publisher->acquiring[now & 1], 1);
+    atomic_fetch_sub(&publisher->acquiring[epoch & 1], 1);
+  }
+
+  state_snapshot_t *snapshot = atomic_load(&publisher->current);
+  if (snapshot) state_snapshot_retain(snapshot);
+  atomic_fetch_sub(&publisher->acquiring[epoch & 1], 1);
+  return snapshot;
+}
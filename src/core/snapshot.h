@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/state.h"
+#include "core/types.h"
+#include "core/window.h"
+
+/**
+ * @file snapshot.h
+ * @brief 供其他线程读取的只读 state 快照。
+ *
+ * 快照在事件循环线程上由 state 整体复制而来，创建后不再修改，字符串也都
+ * 复制进快照自己的内存，与 state 的字符串池无关。快照带原子引用计数，
+ * 读者持有期间无需加锁，也不会阻塞事件循环。
+ *
+ * 一个快照只占一块连续内存：头部之后依次是 outputs、workspaces、windows
+ * 与字符串区。
+ */
+
+typedef struct snapshot_output_t {
+  output_id_t id;
+  workspace_id_t current_workspace_id;
+  const char *name;
+  rect_t geometry;
+  rect_t workarea;
+} snapshot_output_t;
+
+typedef struct snapshot_workspace_t {
+  workspace_id_t id;
+  output_id_t output_id;
+  layout_id_t layout_id;
+  window_id_t focused_window_id;
+  const char *name;
+
+  /* 归属该 workspace 的窗口为 windows[window_offset, +window_count) */
+  size_t window_offset;
+  size_t window_count;
+} snapshot_workspace_t;
+
+typedef struct snapshot_window_t {
+  window_t window;
+
+  const char *title;
+  const char *app_id;
+  const char *role;
+  const char *class_name;
+  const char *instance_name;
+} snapshot_window_t;
+
+typedef struct state_snapshot_t {
+  atomic_uint refcount;
+  uint64_t sequence; /* 发布序号，单调递增 */
+
+  output_id_t current_output_id;
+  window_id_t focused_window_id; /* 当前 output 当前 workspace 的焦点窗口 */
+
+  /* workspaces[i].id == i */
+  const snapshot_output_t *outputs;
+  size_t output_count;
+  const snapshot_workspace_t *workspaces;
+  size_t workspace_count;
+  /* 按 workspace 分组、组内按加入顺序排列；不属于任何 workspace 的在最后 */
+  const snapshot_window_t *windows;
+  size_t window_count;
+} state_snapshot_t;
+
+/**
+ * @brief 由 state 创建快照，初始引用计数为 1
+ *
+ * 只能在修改 state 的线程上调用。
+ */
+state_snapshot_t *state_snapshot_create(const state_t *state);
+state_snapshot_t *state_snapshot_retain(state_snapshot_t *snapshot);
+/** @brief 减少引用计数，归零时释放快照；snapshot 可为 nullptr */
+void state_snapshot_release(state_snapshot_t *snapshot);
+
+/*
+ * 快照发布点
+ *
+ * 事件循环线程是唯一的发布者；任意线程都可以 acquire 最新快照。
+ * acquire 只是几条原子指令，期间按当时 epoch 的奇偶计入 acquiring。
+ * 被替换的快照先放入 retired，发布者翻转 epoch 后，等到某次发布时旧奇偶
+ * 的计数为 0 才释放它们。新的读者只会计入另一个计数，旧计数总能归零，
+ * 读者不会拿到已被释放的快照，发布者也从不等待读者。
+ */
+typedef struct snapshot_publisher_t {
+  _Atomic(state_snapshot_t *) current;
+  atomic_uint epoch;
+  atomic_uint acquiring[2];
+  uint64_t sequence;
+
+  /*
+   * 只由发布者访问。retired 的前 grace_count 个在上一次翻转 epoch 之前
+   * 被替换，旧计数归零后即可释放；其余等下一次翻转。
+   */
+  state_snapshot_t **retired;
+  size_t retired_count;
+  size_t retired_capacity;
+  size_t grace_count;
+} snapshot_publisher_t;
+
+void snapshot_publisher_init(snapshot_publisher_t *publisher);
+/*
+ * 释放当前快照与尚未释放的旧快照，调用时不能有读者正在 acquire；
+ * 读者仍持有的快照在其 release 时释放
+ */
+void snapshot_publisher_cleanup(snapshot_publisher_t *publisher);
+/** @brief 以 state 的当前内容创建并发布新快照 */
+void snapshot_publisher_publish(
+  snapshot_publisher_t *publisher,
+  const state_t *state
+);
+/**
+ * @brief 获取最新快照并增加其引用计数
+ *
+ * @return 调用方负责 state_snapshot_release；尚未发布过时返回 nullptr
+ */
+state_snapshot_t *snapshot_publisher_acquire(snapshot_publisher_t *publisher);
@@ -6,6 +6,7 @@
 #include <zdwm/types.h>
 
 #include "base/array.h"
+#include "base/id_map.h"
 #include "base/log.h"
 #include "base/memory.h"
 #include "base/window_list.h"
@@ -53,6 +54,10 @@ void state_init(
     workspace->layout_id    = workspace_desc->initial_layout_id;
     workspace->layout_count = workspace_desc->layout_count;
     workspace->name         = p_strdup(workspace_desc->name);
+    workspace->window_head  = WINDOW_SLOT_NONE;
+    workspace->window_tail  = WINDOW_SLOT_NONE;
+    workspace->mru_head     = WINDOW_SLOT_NONE;
+    workspace->mru_tail     = WINDOW_SLOT_NONE;
 
     if (output->current_workspace_id == ZDWM_WORKSPACE_ID_INVALID) {
       output->current_workspace_id = workspace->id;
@@ -60,6 +65,13 @@ void state_init(
   }
   state->workspace_count = workspace_count;
 
+  state->window_free_head = WINDOW_SLOT_NONE;
+  state->window_head      = WINDOW_SLOT_NONE;
+  state->window_tail      = WINDOW_SLOT_NONE;
+  for (size_t i = 0; i < ZDWM_WINDOW_LAYER_COUNT; ++i) {
+    layer_stack_init(&state->stacks[i]);
+  }
+
   for (size_t i = 0; i < state->output_count; i++) {
     const output_t *output = &state->outputs[i];
     if (output->current_workspace_id == ZDWM_WORKSPACE_ID_INVALID) {
@@ -69,23 +81,22 @@ void state_init(
 }
 
 void state_cleanup(state_t *state) {
-  for (size_t i = 0; i < state->window_count; i++) {
-    window_t *window = &state->windows[i];
-    p_delete(&window->title);
-    p_delete(&window->app_id);
-    p_delete(&window->role);
-    p_delete(&window->class_name);
-    p_delete(&window->instance_name);
+  for (size_t i = 0; i < state->window_slot_count; i++) {
+    if (!state->window_slots[i].used) continue;
+
+    p_delete(&state->window_attrs[i].title);
   }
   state->window_count = 0;
   p_delete(&state->windows);
-  state->window_capacity = 0;
+  p_delete(&state->window_slots);
+  p_delete(&state->window_attrs);
+  string_pool_cleanup(&state->strings);
+  state->window_slot_count = 0;
+  state->window_capacity   = 0;
+  id_map_cleanup(&state->window_index);
 
   for (size_t i = 0; i < ZDWM_WINDOW_LAYER_COUNT; ++i) {
-    layer_stack_t *layer = &state->stacks[i];
-    p_delete(&layer->order);
-    layer->order    = 0;
-    layer->capacity = 0;
+    layer_stack_cleanup(&state->stacks[i]);
   }
 
   for (size_t i = 0; i < state->workspace_count; i++) {
@@ -118,6 +129,69 @@ const workspace_t *state_workspace_at(const state_t *state, size_t index) {
   return nullptr;
 }
 
+static inline void
+state_workspace_mark_dirty(state_t *state, workspace_id_t workspace_id) {
+  if (workspace_id < state->workspace_count) {
+    state->workspaces[workspace_id].dirty = true;
+  }
+}
+
+/* 只有 NORMAL/TOP 层的窗口参与焦点回退 */
+static inline bool state_window_in_mru(const window_t *window) {
+  return window->layer == ZDWM_WINDOW_LAYER_NORMAL ||
+         window->layer == ZDWM_WINDOW_LAYER_TOP;
+}
+
+static void
+state_workspace_mru_push_head(state_t *state, workspace_t *ws, uint32_t index) {
+  window_slot_t *slot = &state->window_slots[index];
+  slot->mru_prev      = WINDOW_SLOT_NONE;
+  slot->mru_next      = ws->mru_head;
+  if (ws->mru_head != WINDOW_SLOT_NONE) {
+    state->window_slots[ws->mru_head].mru_prev = index;
+  } else {
+    ws->mru_tail = index;
+  }
+  ws->mru_head = index;
+}
+
+static void
+state_workspace_mru_push_tail(state_t *state, workspace_t *ws, uint32_t index) {
+  window_slot_t *slot = &state->window_slots[index];
+  slot->mru_prev      = ws->mru_tail;
+  slot->mru_next      = WINDOW_SLOT_NONE;
+  if (ws->mru_tail != WINDOW_SLOT_NONE) {
+    state->window_slots[ws->mru_tail].mru_next = index;
+  } else {
+    ws->mru_head = index;
+  }
+  ws->mru_tail = index;
+}
+
+static void
+state_workspace_mru_unlink(state_t *state, workspace_t *ws, uint32_t index) {
+  window_slot_t *slot = &state->window_slots[index];
+  if (slot->mru_prev != WINDOW_SLOT_NONE) {
+    state->window_slots[slot->mru_prev].mru_next = slot->mru_next;
+  } else {
+    ws->mru_head = slot->mru_next;
+  }
+  if (slot->mru_next != WINDOW_SLOT_NONE) {
+    state->window_slots[slot->mru_next].mru_prev = slot->mru_prev;
+  } else {
+    ws->mru_tail = slot->mru_prev;
+  }
+  slot->mru_prev = WINDOW_SLOT_NONE;
+  slot->mru_next = WINDOW_SLOT_NONE;
+}
+
+static inline window_id_t
+state_workspace_mru_window(const state_t *state, uint32_t index) {
+  if (index == WINDOW_SLOT_NONE) return ZDWM_WINDOW_ID_INVALID;
+  return state->windows[index].id;
+}
+
+/* 焦点窗口已不属于该 workspace 时，回退到焦点历史中最近的窗口 */
 static void state_workspace_adjust_focused_window(
   const state_t *state,
   workspace_id_t workspace_id
@@ -130,19 +204,8 @@ static void state_workspace_adjust_focused_window(
     state_window_get(state, workspace->focused_window_id);
   if (window && window->workspace_id == workspace_id) return;
 
-  for (size_t i = ZDWM_WINDOW_LAYER_TOP; i >= ZDWM_WINDOW_LAYER_NORMAL; --i) {
-    const layer_stack_t *layer = &state->stacks[i];
-    for (size_t i = layer->count; i > 0; --i) {
-      window_id_t window_id = layer->order[i - 1];
-      window                = state_window_get(state, window_id);
-      if (window && window->workspace_id == workspace_id) {
-        workspace->focused_window_id = window_id;
-        return;
-      }
-    }
-  }
-
-  workspace->focused_window_id = ZDWM_WINDOW_ID_INVALID;
+  workspace->focused_window_id =
+    state_workspace_mru_window(state, workspace->mru_head);
 }
 
 bool state_workspace_cycle_layout(state_t *state, workspace_id_t workspace_id) {
@@ -164,6 +227,7 @@ bool state_workspace_cycle_layout(state_t *state, workspace_id_t workspace_id) {
 
   auto next_layout_id  = workspace->available_layouts[next_index];
   workspace->layout_id = next_layout_id;
+  workspace->dirty     = true;
   return true;
 }
 
@@ -178,6 +242,7 @@ bool state_workspace_set_layout_by_index(
   if (index >= workspace->layout_count) return false;
 
   workspace->layout_id = workspace->available_layouts[index];
+  workspace->dirty     = true;
   return true;
 }
 
@@ -192,6 +257,7 @@ bool state_workspace_set_layout_by_id(
   for (size_t i = 0; i < workspace->layout_count; i++) {
     if (workspace->available_layouts[i] == layout_id) {
       workspace->layout_id = layout_id;
+      workspace->dirty     = true;
       return true;
     }
   }
@@ -208,17 +274,43 @@ void state_workspace_set_focused_window(
     (workspace_t *)state_workspace_get(state, workspace_id);
   if (!workspace) return;
 
-  for (size_t i = 0; i < state->window_count; i++) {
-    window_t *window = &state->windows[i];
-    if (window->id == window_id && window->workspace_id == workspace_id) {
-      workspace->focused_window_id = window_id;
-      return;
+  const window_t *window = state_window_get(state, window_id);
+  if (window && window->workspace_id == workspace_id) {
+    workspace->focused_window_id = window_id;
+    if (state_window_in_mru(window)) {
+      uint32_t index = (uint32_t)(window - state->windows);
+      state_workspace_mru_unlink(state, workspace, index);
+      state_workspace_mru_push_head(state, workspace, index);
     }
+    return;
   }
 
   state_workspace_adjust_focused_window(state, workspace_id);
 }
 
+window_id_t
+state_workspace_mru_previous(const state_t *state, workspace_id_t workspace_id) {
+  const workspace_t *workspace = state_workspace_get(state, workspace_id);
+  if (!workspace || workspace->mru_head == WINDOW_SLOT_NONE) {
+    return ZDWM_WINDOW_ID_INVALID;
+  }
+
+  uint32_t next = state->window_slots[workspace->mru_head].mru_next;
+  return state_workspace_mru_window(state, next);
+}
+
+window_id_t state_workspace_mru_rotate(state_t *state, workspace_id_t id) {
+  workspace_t *workspace = (workspace_t *)state_workspace_get(state, id);
+  if (!workspace || workspace->mru_head == workspace->mru_tail) {
+    return ZDWM_WINDOW_ID_INVALID;
+  }
+
+  uint32_t head = workspace->mru_head;
+  state_workspace_mru_unlink(state, workspace, head);
+  state_workspace_mru_push_tail(state, workspace, head);
+  return state_workspace_mru_window(state, workspace->mru_head);
+}
+
 size_t state_workspace_count(const state_t *state) {
   return state->workspace_count;
 }
@@ -238,6 +330,23 @@ bool state_workspace_valid(const state_t *state, workspace_id_t id) {
 #endif
 }
 
+const window_t *
+state_workspace_window_first(const state_t *state, workspace_id_t id) {
+  auto workspace = state_workspace_get(state, id);
+  if (!workspace || workspace->window_head == WINDOW_SLOT_NONE) return nullptr;
+
+  return &state->windows[workspace->window_head];
+}
+
+const window_t *
+state_workspace_window_next(const state_t *state, const window_t *window) {
+  uint32_t index = (uint32_t)(window - state->windows);
+  uint32_t next  = state->window_slots[index].workspace_next;
+  if (next == WINDOW_SLOT_NONE) return nullptr;
+
+  return &state->windows[next];
+}
+
 bool state_workspace_show(const state_t *state, workspace_id_t workspace_id) {
   auto workspace = state_workspace_get(state, workspace_id);
   auto output    = state_output_get(state, workspace->output_id);
@@ -260,7 +369,10 @@ void state_output_set_workarea(
   rect_t workarea
 ) {
   output_t *output = (output_t *)state_output_get(state, output_id);
-  if (output) output->workarea = workarea;
+  if (!output || rect_equal(output->workarea, workarea)) return;
+
+  output->workarea = workarea;
+  output->dirty    = true;
 }
 
 bool state_output_set_current_workspace(
@@ -278,11 +390,31 @@ bool state_output_set_current_workspace(
 
   if (old_workspace_id) *old_workspace_id = output->current_workspace_id;
   output->current_workspace_id = workspace_id;
+  output->dirty                = true;
   return true;
 }
 
 size_t state_output_count(const state_t *state) { return state->output_count; }
 
+bool state_output_need_relayout(const state_t *state, output_id_t id) {
+  const output_t *output = state_output_get(state, id);
+  if (!output) return false;
+  if (output->dirty) return true;
+
+  const workspace_t *workspace =
+    state_workspace_get(state, output->current_workspace_id);
+  return workspace && workspace->dirty;
+}
+
+void state_clear_dirty(state_t *state) {
+  for (size_t i = 0; i < state->output_count; ++i) {
+    state->outputs[i].dirty = false;
+  }
+  for (size_t i = 0; i < state->workspace_count; ++i) {
+    state->workspaces[i].dirty = false;
+  }
+}
+
 bool state_output_valid(const state_t *state, output_id_t id) {
   return id < state->output_count;
 
@@ -321,96 +453,340 @@ bool state_set_current_output(state_t *state, output_id_t output_id) {
   return false;
 }
 
+static inline uint32_t
+state_window_slot_index(const state_t *state, const window_t *window) {
+  return (uint32_t)(window - state->windows);
+}
+
+static uint32_t state_window_slot_alloc(state_t *state) {
+  uint32_t index = state->window_free_head;
+  if (index != WINDOW_SLOT_NONE) {
+    state->window_free_head = state->window_slots[index].next;
+    return index;
+  }
+
+  size_t capacity = state->window_capacity;
+  array_push(state->windows, state->window_slot_count, state->window_capacity);
+  if (capacity != state->window_capacity) {
+    p_realloc(&state->window_slots, state->window_capacity);
+    p_realloc(&state->window_attrs, state->window_capacity);
+  }
+
+  /* 代数从 1 开始，保证零值句柄永远无效 */
+  index = (uint32_t)(state->window_slot_count - 1);
+
+  state->window_slots[index].generation = 1;
+  return index;
+}
+
+static void state_window_slot_free(state_t *state, uint32_t index) {
+  window_slot_t *slot = &state->window_slots[index];
+  slot->used          = false;
+  if (!++slot->generation) slot->generation = 1;
+  slot->prev              = WINDOW_SLOT_NONE;
+  slot->next              = state->window_free_head;
+  state->window_free_head = index;
+}
+
+static void state_window_order_append(state_t *state, uint32_t index) {
+  window_slot_t *slot = &state->window_slots[index];
+  slot->prev          = state->window_tail;
+  slot->next          = WINDOW_SLOT_NONE;
+  if (state->window_tail != WINDOW_SLOT_NONE) {
+    state->window_slots[state->window_tail].next = index;
+  } else {
+    state->window_head = index;
+  }
+  state->window_tail = index;
+}
+
+static void state_window_order_unlink(state_t *state, uint32_t index) {
+  window_slot_t *slot = &state->window_slots[index];
+  if (slot->prev != WINDOW_SLOT_NONE) {
+    state->window_slots[slot->prev].next = slot->next;
+  } else {
+    state->window_head = slot->next;
+  }
+  if (slot->next != WINDOW_SLOT_NONE) {
+    state->window_slots[slot->next].prev = slot->prev;
+  } else {
+    state->window_tail = slot->prev;
+  }
+}
+
+static void
+state_window_transient_link(state_t *state, uint32_t parent, uint32_t child) {
+  window_slot_t *parent_slot = &state->window_slots[parent];
+  window_slot_t *child_slot  = &state->window_slots[child];
+
+  child_slot->transient_prev = WINDOW_SLOT_NONE;
+  child_slot->transient_next = parent_slot->transient_head;
+  if (parent_slot->transient_head != WINDOW_SLOT_NONE) {
+    state->window_slots[parent_slot->transient_head].transient_prev = child;
+  }
+  parent_slot->transient_head = child;
+}
+
+static void
+state_window_transient_unlink(state_t *state, uint32_t parent, uint32_t child) {
+  window_slot_t *child_slot = &state->window_slots[child];
+  if (child_slot->transient_prev != WINDOW_SLOT_NONE) {
+    state->window_slots[child_slot->transient_prev].transient_next =
+      child_slot->transient_next;
+  } else {
+    state->window_slots[parent].transient_head = child_slot->transient_next;
+  }
+  if (child_slot->transient_next != WINDOW_SLOT_NONE) {
+    state->window_slots[child_slot->transient_next].transient_prev =
+      child_slot->transient_prev;
+  }
+  child_slot->transient_prev = WINDOW_SLOT_NONE;
+  child_slot->transient_next = WINDOW_SLOT_NONE;
+}
+
+static void state_workspace_window_append(
+  state_t *state,
+  workspace_t *workspace,
+  uint32_t index
+) {
+  window_slot_t *slot  = &state->window_slots[index];
+  slot->workspace_prev = workspace->window_tail;
+  slot->workspace_next = WINDOW_SLOT_NONE;
+  if (workspace->window_tail != WINDOW_SLOT_NONE) {
+    state->window_slots[workspace->window_tail].workspace_next = index;
+  } else {
+    workspace->window_head = index;
+  }
+  workspace->window_tail = index;
+  workspace->window_count++;
+  workspace->dirty = true;
+
+  if (state_window_in_mru(&state->windows[index])) {
+    state_workspace_mru_push_tail(state, workspace, index);
+  }
+}
+
+static void state_workspace_window_unlink(
+  state_t *state,
+  workspace_t *workspace,
+  uint32_t index
+) {
+  window_slot_t *slot = &state->window_slots[index];
+  if (slot->workspace_prev != WINDOW_SLOT_NONE) {
+    state->window_slots[slot->workspace_prev].workspace_next =
+      slot->workspace_next;
+  } else {
+    workspace->window_head = slot->workspace_next;
+  }
+  if (slot->workspace_next != WINDOW_SLOT_NONE) {
+    state->window_slots[slot->workspace_next].workspace_prev =
+      slot->workspace_prev;
+  } else {
+    workspace->window_tail = slot->workspace_prev;
+  }
+  slot->workspace_prev = WINDOW_SLOT_NONE;
+  slot->workspace_next = WINDOW_SLOT_NONE;
+  workspace->window_count--;
+  workspace->dirty = true;
+
+  if (state_window_in_mru(&state->windows[index])) {
+    state_workspace_mru_unlink(state, workspace, index);
+  }
+}
+
+static bool state_window_slot_of(
+  const state_t *state,
+  window_id_t id,
+  uint32_t *index_out
+) {
+  return id_map_get(&state->window_index, id, index_out);
+}
+
+static window_attrs_t *state_window_attrs_mut(state_t *state, window_id_t id) {
+  uint32_t index = 0;
+  if (!state_window_slot_of(state, id, &index)) return nullptr;
+
+  return &state->window_attrs[index];
+}
+
+static void state_attrs_set_title(window_attrs_t *attrs, const char *title) {
+  p_delete(&attrs->title);
+  attrs->title = p_strdup_nullable(title);
+}
+
+/* 先驻留新值再释放旧值，相同字符串不会在池中被删除后重建 */
+static void
+state_attrs_intern(state_t *state, const char **field, const char *value) {
+  const char *old = *field;
+  *field          = string_pool_intern(&state->strings, value);
+  string_pool_release(&state->strings, old);
+}
+
+static void state_window_attrs_clear(state_t *state, window_attrs_t *attrs) {
+  p_delete(&attrs->title);
+  string_pool_release(&state->strings, attrs->app_id);
+  string_pool_release(&state->strings, attrs->role);
+  string_pool_release(&state->strings, attrs->class_name);
+  string_pool_release(&state->strings, attrs->instance_name);
+  p_clear(attrs, 1);
+}
+
 const window_t *state_window_add(state_t *state, const window_info_t *info) {
-  window_id_t id   = info->id;
+  window_id_t id = info->id;
+  if (window_id_invalid(id)) return nullptr;
+
   window_t *window = (window_t *)state_window_get(state, id);
   if (!window) {
-    window =
-      array_push(state->windows, state->window_count, state->window_capacity);
+    uint32_t index = state_window_slot_alloc(state);
+    id_map_set(&state->window_index, id, index);
+
+    window_slot_t *slot  = &state->window_slots[index];
+    slot->used           = true;
+    slot->transient_head = WINDOW_SLOT_NONE;
+    slot->transient_prev = WINDOW_SLOT_NONE;
+    slot->transient_next = WINDOW_SLOT_NONE;
+    slot->workspace_prev = WINDOW_SLOT_NONE;
+    slot->workspace_next = WINDOW_SLOT_NONE;
+    slot->mru_prev       = WINDOW_SLOT_NONE;
+    slot->mru_next       = WINDOW_SLOT_NONE;
+    state_window_order_append(state, index);
+    state->window_count++;
 
     layer_stack_t *layer = &state->stacks[info->layer_type];
     layer_stack_append(layer, id);
 
+    p_clear(&state->window_attrs[index], 1);
+    window = &state->windows[index];
     p_clear(window, 1);
     window->id            = id;
-    window->transient_for = info->transient_for;
+    window->transient_for = ZDWM_WINDOW_ID_INVALID;
     window->workspace_id  = ZDWM_WORKSPACE_ID_INVALID;
     window->layer         = info->layer_type;
+
+    uint32_t parent = WINDOW_SLOT_NONE;
+    if (info->transient_for != id &&
+        state_window_slot_of(state, info->transient_for, &parent)) {
+      window->transient_for = info->transient_for;
+      state_window_transient_link(state, parent, index);
+    }
   }
 
+  /* 已存在的窗口再次加入时，参与布局的字段变化需要重新布局所在工作区 */
+  bool was_floating = window->floating;
+  bool relayout     = window->fullscreen != info->fullscreen ||
+                      window->maximized != info->maximized ||
+                      window->minimized != info->minimized ||
+                      !rect_equal(window->frame_rect, info->frame_rect);
+
   window_set_fullscreen(window, info->fullscreen);
   window_set_maximized(window, info->maximized);
   window_set_minimized(window, info->minimized);
   window_set_urgent(window, info->urgent);
   window_set_fixed_size(window, info->fixed_size);
   window_set_frame_rect(window, info->frame_rect);
-  window_set_title(window, info->title);
-  window_set_app_id(window, info->app_id);
-  window_set_role(window, info->role);
-  window_set_class(window, info->class_name);
-  window_set_instance(window, info->instance_name);
   window_set_skip_taskbar(window, info->skip_taskbar);
+  if (relayout || window->floating != was_floating) {
+    state_workspace_mark_dirty(state, window->workspace_id);
+  }
+
+  auto attrs = state_window_attrs_mut(state, id);
+  state_attrs_set_title(attrs, info->title);
+  state_attrs_intern(state, &attrs->app_id, info->app_id);
+  state_attrs_intern(state, &attrs->role, info->role);
+  state_attrs_intern(state, &attrs->class_name, info->class_name);
+  state_attrs_intern(state, &attrs->instance_name, info->instance_name);
 
   return window;
 }
 
 const window_t *state_window_get(const state_t *state, window_id_t id) {
-  for (size_t i = 0; i < state->window_count; i++) {
-    if (state->windows[i].id == id) return &state->windows[i];
-  }
+  uint32_t index = 0;
+  if (!state_window_slot_of(state, id, &index)) return nullptr;
 
-  return nullptr;
+  return &state->windows[index];
 }
 
-const window_t *state_window_at(const state_t *state, size_t index) {
-  if (index < state->window_count) return &state->windows[index];
+const window_attrs_t *state_window_attrs(const state_t *state, window_id_t id) {
+  uint32_t index = 0;
+  if (!state_window_slot_of(state, id, &index)) return nullptr;
 
-  return nullptr;
+  return &state->window_attrs[index];
+}
+
+window_handle_t state_window_handle(const state_t *state, window_id_t id) {
+  uint32_t index = 0;
+  if (!state_window_slot_of(state, id, &index)) return (window_handle_t){0};
+
+  return (window_handle_t){
+    .index      = index,
+    .generation = state->window_slots[index].generation,
+  };
+}
+
+const window_t *
+state_window_resolve(const state_t *state, window_handle_t handle) {
+  if (handle.index >= state->window_slot_count) return nullptr;
+
+  const window_slot_t *slot = &state->window_slots[handle.index];
+  if (!slot->used || slot->generation != handle.generation) return nullptr;
+
+  return &state->windows[handle.index];
+}
+
+const window_t *state_window_first(const state_t *state) {
+  if (state->window_head == WINDOW_SLOT_NONE) return nullptr;
+  return &state->windows[state->window_head];
+}
+
+const window_t *
+state_window_next(const state_t *state, const window_t *window) {
+  uint32_t index = state_window_slot_index(state, window);
+  uint32_t next  = state->window_slots[index].next;
+  if (next == WINDOW_SLOT_NONE) return nullptr;
+  return &state->windows[next];
 }
 
 void state_window_remove(state_t *state, window_id_t id) {
-  bool matched = false;
-  size_t index = 0;
-  for (size_t i = 0; i < state->window_count; i++) {
-    if (state->windows[i].id == id) {
-      matched = true;
-      index   = i;
-      break;
-    }
-  }
-  if (!matched) return;
+  uint32_t index = 0;
+  if (!state_window_slot_of(state, id, &index)) return;
+  id_map_remove(&state->window_index, id);
 
   window_t *window               = &state->windows[index];
   window_layer_type_t layer_type = window->layer;
   workspace_id_t workspace_id    = window->workspace_id;
-  p_delete(&window->title);
-  p_delete(&window->app_id);
-  p_delete(&window->role);
-  p_delete(&window->class_name);
-  p_delete(&window->instance_name);
-
-  if (array_erase(state->windows, state->window_count, index)) {
-    window = &state->windows[state->window_count];
-    p_clear(window, 1);
-    window->id            = ZDWM_WINDOW_ID_INVALID;
-    window->transient_for = ZDWM_WINDOW_ID_INVALID;
-    window->workspace_id  = ZDWM_WORKSPACE_ID_INVALID;
 
-    for (size_t i = 0; i < state->window_count; ++i) {
-      window = &state->windows[i];
-      if (window->transient_for != id) continue;
+  uint32_t parent = WINDOW_SLOT_NONE;
+  if (state_window_slot_of(state, window->transient_for, &parent)) {
+    state_window_transient_unlink(state, parent, index);
+  }
 
-      window->transient_for = ZDWM_WINDOW_ID_INVALID;
-    }
+  /* 仅遍历以本窗口为父窗口的子窗口 */
+  window_slot_t *slot = &state->window_slots[index];
+  while (slot->transient_head != WINDOW_SLOT_NONE) {
+    uint32_t child = slot->transient_head;
+    state->windows[child].transient_for = ZDWM_WINDOW_ID_INVALID;
+    state_window_transient_unlink(state, index, child);
   }
 
+  workspace_t *workspace =
+    (workspace_t *)state_workspace_get(state, workspace_id);
+  if (workspace) state_workspace_window_unlink(state, workspace, index);
+
+  state_window_attrs_clear(state, &state->window_attrs[index]);
+  p_clear(window, 1);
+  window->id            = ZDWM_WINDOW_ID_INVALID;
+  window->transient_for = ZDWM_WINDOW_ID_INVALID;
+  window->workspace_id  = ZDWM_WORKSPACE_ID_INVALID;
+
+  state_window_order_unlink(state, index);
+  state_window_slot_free(state, index);
+  state->window_count--;
+
   layer_stack_t *layer = &state->stacks[layer_type];
   if (layer) {
     layer_stack_remove(layer, id);
   }
 
-  workspace_t *workspace =
-    (workspace_t *)state_workspace_get(state, workspace_id);
   if (workspace && workspace->focused_window_id == id) {
     state_workspace_adjust_focused_window(state, workspace_id);
   }
@@ -423,27 +799,46 @@ void state_window_set_workspace(
   window_id_t window_id,
   workspace_id_t workspace_id
 ) {
-  const workspace_t *workspace = state_workspace_get(state, workspace_id);
-  window_t *window             = (window_t *)state_window_get(state, window_id);
+  workspace_t *workspace =
+    (workspace_t *)state_workspace_get(state, workspace_id);
+  window_t *window = (window_t *)state_window_get(state, window_id);
   if (!workspace || !window || window->workspace_id == workspace_id) return;
 
-  workspace            = state_workspace_get(state, window->workspace_id);
+  uint32_t index = state_window_slot_index(state, window);
+  workspace_t *old_workspace =
+    (workspace_t *)state_workspace_get(state, window->workspace_id);
+  if (old_workspace) state_workspace_window_unlink(state, old_workspace, index);
+  state_workspace_window_append(state, workspace, index);
   window->workspace_id = workspace_id;
 
-  if (workspace && workspace->focused_window_id == window_id) {
-    state_workspace_adjust_focused_window(state, workspace->id);
+  if (old_workspace && old_workspace->focused_window_id == window_id) {
+    state_workspace_adjust_focused_window(state, old_workspace->id);
   }
 
   state_workspace_adjust_focused_window(state, workspace_id);
 }
 
+/* sticky 与 fixed_size 会连带改变 floating，是否参与布局随之变化 */
+static void state_window_mark_floating_dirty(
+  state_t *state,
+  const window_t *window,
+  bool was_floating
+) {
+  if (window->floating != was_floating) {
+    state_workspace_mark_dirty(state, window->workspace_id);
+  }
+}
+
 void state_window_set_fullscreen(
   state_t *state,
   window_id_t window_id,
   bool fullscreen
 ) {
-  auto window = (window_t *)state_window_get(state, window_id);
-  if (window) window_set_fullscreen(window, fullscreen);
+  window_t *window = (window_t *)state_window_get(state, window_id);
+  if (!window || window->fullscreen == fullscreen) return;
+
+  window_set_fullscreen(window, fullscreen);
+  state_workspace_mark_dirty(state, window->workspace_id);
 }
 
 void state_window_set_maximized(
@@ -451,8 +846,11 @@ void state_window_set_maximized(
   window_id_t window_id,
   bool maximized
 ) {
-  auto window = (window_t *)state_window_get(state, window_id);
-  if (window) window_set_maximized(window, maximized);
+  window_t *window = (window_t *)state_window_get(state, window_id);
+  if (!window || window->maximized == maximized) return;
+
+  window_set_maximized(window, maximized);
+  state_workspace_mark_dirty(state, window->workspace_id);
 }
 
 void state_window_set_minimized(
@@ -460,8 +858,11 @@ void state_window_set_minimized(
   window_id_t window_id,
   bool minimized
 ) {
-  auto window = (window_t *)state_window_get(state, window_id);
-  if (window) window_set_minimized(window, minimized);
+  window_t *window = (window_t *)state_window_get(state, window_id);
+  if (!window || window->minimized == minimized) return;
+
+  window_set_minimized(window, minimized);
+  state_workspace_mark_dirty(state, window->workspace_id);
 }
 
 void state_window_set_floating(
@@ -470,7 +871,11 @@ void state_window_set_floating(
   bool floating
 ) {
   window_t *window = (window_t *)state_window_get(state, window_id);
-  if (window) window_set_floating(window, floating);
+  if (!window) return;
+
+  bool was_floating = window->floating;
+  window_set_floating(window, floating);
+  state_window_mark_floating_dirty(state, window, was_floating);
 }
 
 void state_window_set_sticky(
@@ -479,7 +884,11 @@ void state_window_set_sticky(
   bool sticky
 ) {
   window_t *window = (window_t *)state_window_get(state, window_id);
-  if (window) window_set_sticky(window, sticky);
+  if (!window) return;
+
+  bool was_floating = window->floating;
+  window_set_sticky(window, sticky);
+  state_window_mark_floating_dirty(state, window, was_floating);
 }
 
 void state_window_set_urgent(
@@ -497,7 +906,11 @@ void state_window_set_fixed_size(
   bool fixed_size
 ) {
   window_t *window = (window_t *)state_window_get(state, window_id);
-  if (window) window_set_fixed_size(window, fixed_size);
+  if (!window) return;
+
+  bool was_floating = window->floating;
+  window_set_fixed_size(window, fixed_size);
+  state_window_mark_floating_dirty(state, window, was_floating);
 }
 
 void state_window_set_border_width(
@@ -506,7 +919,10 @@ void state_window_set_border_width(
   uint32_t border_width
 ) {
   window_t *window = (window_t *)state_window_get(state, window_id);
-  if (window) window_set_border_width(window, border_width);
+  if (!window || window->border_width == border_width) return;
+
+  window_set_border_width(window, border_width);
+  state_workspace_mark_dirty(state, window->workspace_id);
 }
 
 void state_window_set_skip_taskbar(
@@ -542,10 +958,25 @@ bool state_window_take_metadata(
   window_metadata_t *metadata,
   uint32_t changed_fields
 ) {
-  window_t *window = (window_t *)state_window_get(state, window_id);
-  if (!window) return false;
+  auto attrs = state_window_attrs_mut(state, window_id);
+  if (!attrs) return false;
 
-  window_take_metadata(window, metadata, changed_fields);
+  if (changed_fields & ZDWM_WINDOW_METADATA_CHANGE_TITLE) {
+    p_take(&attrs->title, &metadata->title);
+  }
+
+#define METADATA_INTERN(FLAG, FIELD)                           \
+  if (changed_fields & (FLAG)) {                               \
+    state_attrs_intern(state, &attrs->FIELD, metadata->FIELD); \
+    p_delete(&metadata->FIELD);                                \
+  }
+
+  METADATA_INTERN(ZDWM_WINDOW_METADATA_CHANGE_APP_ID, app_id);
+  METADATA_INTERN(ZDWM_WINDOW_METADATA_CHANGE_ROLE, role);
+  METADATA_INTERN(ZDWM_WINDOW_METADATA_CHANGE_CLASS, class_name);
+  METADATA_INTERN(ZDWM_WINDOW_METADATA_CHANGE_INSTANCE, instance_name);
+
+#undef METADATA_INTERN
 
   return true;
 }
@@ -555,10 +986,10 @@ bool state_window_set_title(
   window_id_t window_id,
   const char *title
 ) {
-  window_t *window = (window_t *)state_window_get(state, window_id);
-  if (!window) return false;
+  auto attrs = state_window_attrs_mut(state, window_id);
+  if (!attrs) return false;
 
-  window_set_title(window, title);
+  state_attrs_set_title(attrs, title);
   return true;
 }
 
@@ -567,10 +998,10 @@ bool state_window_set_app_id(
   window_id_t window_id,
   const char *app_id
 ) {
-  window_t *window = (window_t *)state_window_get(state, window_id);
-  if (!window) return false;
+  auto attrs = state_window_attrs_mut(state, window_id);
+  if (!attrs) return false;
 
-  window_set_app_id(window, app_id);
+  state_attrs_intern(state, &attrs->app_id, app_id);
   return true;
 }
 
@@ -579,10 +1010,10 @@ bool state_window_set_role(
   window_id_t window_id,
   const char *role
 ) {
-  window_t *window = (window_t *)state_window_get(state, window_id);
-  if (!window) return false;
+  auto attrs = state_window_attrs_mut(state, window_id);
+  if (!attrs) return false;
 
-  window_set_role(window, role);
+  state_attrs_intern(state, &attrs->role, role);
   return true;
 }
 
@@ -591,10 +1022,10 @@ bool state_window_set_class(
   window_id_t window_id,
   const char *class_name
 ) {
-  window_t *window = (window_t *)state_window_get(state, window_id);
-  if (!window) return false;
+  auto attrs = state_window_attrs_mut(state, window_id);
+  if (!attrs) return false;
 
-  window_set_class(window, class_name);
+  state_attrs_intern(state, &attrs->class_name, class_name);
   return true;
 }
 
@@ -603,31 +1034,76 @@ bool state_window_set_instance(
   window_id_t window_id,
   const char *instance_name
 ) {
-  window_t *window = (window_t *)state_window_get(state, window_id);
+  auto attrs = state_window_attrs_mut(state, window_id);
+  if (!attrs) return false;
+
+  state_attrs_intern(state, &attrs->instance_name, instance_name);
+  return true;
+}
+
+/* 全局堆叠顺序中位于 layer 所有窗口下方的最高窗口 */
+static window_id_t
+state_stack_top_below_layer(const state_t *state, window_layer_type_t layer) {
+  for (size_t i = layer; i > 0; --i) {
+    window_id_t top = layer_stack_top(&state->stacks[i - 1]);
+    if (!window_id_invalid(top)) return top;
+  }
+
+  return ZDWM_WINDOW_ID_INVALID;
+}
+
+static window_id_t
+state_stack_sibling(const state_t *state, const window_t *window) {
+  auto layer        = &state->stacks[window->layer];
+  window_id_t below = layer_stack_below(layer, window->id);
+  if (!window_id_invalid(below)) return below;
+
+  return state_stack_top_below_layer(state, window->layer);
+}
+
+bool state_stack_place(
+  const state_t *state,
+  window_id_t window_id,
+  restack_item_t *move_out
+) {
+  const window_t *window = state_window_get(state, window_id);
   if (!window) return false;
 
-  window_set_instance(window, instance_name);
+  if (move_out) {
+    move_out->window  = window_id;
+    move_out->sibling = state_stack_sibling(state, window);
+  }
   return true;
 }
 
-bool state_stack_raise(state_t *state, window_id_t window_id) {
+bool state_stack_raise(
+  state_t *state,
+  window_id_t window_id,
+  restack_item_t *move_out
+) {
   const window_t *window = state_window_get(state, window_id);
   if (!window) return false;
 
-  layer_stack_t *layer = &state->stacks[window->layer];
-  if (!layer) return false;
+  if (!layer_stack_raise(&state->stacks[window->layer], window_id)) {
+    return false;
+  }
 
-  return layer_stack_raise(layer, window_id);
+  return state_stack_place(state, window_id, move_out);
 }
 
-bool state_stack_lower(state_t *state, window_id_t window_id) {
+bool state_stack_lower(
+  state_t *state,
+  window_id_t window_id,
+  restack_item_t *move_out
+) {
   const window_t *window = state_window_get(state, window_id);
   if (!window) return false;
 
-  layer_stack_t *layer = &state->stacks[window->layer];
-  if (!layer) return false;
+  if (!layer_stack_lower(&state->stacks[window->layer], window_id)) {
+    return false;
+  }
 
-  return layer_stack_lower(layer, window_id);
+  return state_stack_place(state, window_id, move_out);
 }
 
 void state_get_windows_need_layout_in_workspace(
@@ -635,9 +1111,9 @@ void state_get_windows_need_layout_in_workspace(
   workspace_id_t workspace_id,
   window_list_t *window_list_out
 ) {
-  for (size_t i = 0; i < state->window_count; ++i) {
-    auto window = &state->windows[i];
-    if (window->workspace_id == workspace_id && window_need_layout(window)) {
+  for (auto window = state_workspace_window_first(state, workspace_id); window;
+       window = state_workspace_window_next(state, window)) {
+    if (window_need_layout(window)) {
       window_list_push(window_list_out, window->id);
     }
   }
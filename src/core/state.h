@@ -3,18 +3,71 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "base/id_map.h"
+#include "base/string_pool.h"
 #include "base/window_list.h"
 #include "core/layer.h"
 #include "core/types.h"
 #include "core/window.h"
 #include "core/wm_desc.h"
 
+static constexpr uint32_t WINDOW_SLOT_NONE = UINT32_MAX;
+
+/*
+ * 窗口句柄
+ *
+ * slot 下标加代数。slot 被回收时代数递增，因此旧句柄在窗口删除后会自动
+ * 失效，且不受其他窗口插入、删除的影响。
+ * 零值句柄永远无效。
+ */
+typedef struct window_handle_t {
+  uint32_t index;
+  uint32_t generation;
+} window_handle_t;
+
+typedef struct window_slot_t {
+  uint32_t generation;
+  bool used;
+
+  /* used 时为插入顺序链表；空闲时 next 串起空闲链表 */
+  uint32_t prev;
+  uint32_t next;
+
+  /* 所属 workspace 的成员链表 */
+  uint32_t workspace_prev;
+  uint32_t workspace_next;
+
+  /* 所属 workspace 的焦点历史链表，只包含 NORMAL/TOP 层的窗口 */
+  uint32_t mru_prev;
+  uint32_t mru_next;
+
+  /* transient 反向索引：以 transient_for 指向本窗口的子窗口链表 */
+  uint32_t transient_head;
+  uint32_t transient_prev;
+  uint32_t transient_next;
+} window_slot_t;
+
 typedef struct workspace_t {
   workspace_id_t id;
   output_id_t output_id; /* 固定归属某个输出 */
   layout_id_t layout_id; /* 当前活动布局（可用布局列表中的一个） */
   window_id_t focused_window_id;
 
+  /* 归属该 workspace 的窗口链表（window slot 下标），按加入顺序排列 */
+  uint32_t window_head;
+  uint32_t window_tail;
+  size_t window_count;
+
+  /*
+   * 焦点历史（MRU）链表，head 为最近获得焦点的窗口。
+   * 焦点窗口离开 workspace 时直接回退到新的 head。
+   */
+  uint32_t mru_head;
+  uint32_t mru_tail;
+
+  /* 影响布局的状态在上次 state_clear_dirty() 后发生了变化 */
+  bool dirty;
+
   /* 当前 workspace 的可用布局列表 */
   const layout_id_t *available_layouts;
   size_t layout_count;
@@ -29,6 +82,7 @@ typedef struct output_t {
   const char *name;
   rect_t geometry; /* 输出完整几何 */
   rect_t workarea; /* 可用区域（排除面板等） */
+  bool dirty;      /* 几何或当前 workspace 发生了变化 */
 } output_t;
 
 /* 全局状态容器 */
@@ -41,9 +95,25 @@ typedef struct state_t {
   size_t output_count;
   size_t current_output_index;
 
+  /*
+   * 窗口 slot map：windows[i]、window_slots[i] 与 window_attrs[i]
+   * 一一对应。windows[] 只存放热数据，元数据字符串放在 window_attrs[]。
+   * 删除窗口只回收 slot（进入空闲链表），不移动其他窗口。
+   */
   window_t *windows;
-  size_t window_count;
+  window_slot_t *window_slots;
+  window_attrs_t *window_attrs;
+  size_t window_slot_count; /* 已使用过的 slot 数，含空闲 slot */
   size_t window_capacity;
+  size_t window_count; /* 存活窗口数 */
+  uint32_t window_free_head;
+  /* 存活窗口按插入顺序串成的链表 */
+  uint32_t window_head;
+  uint32_t window_tail;
+  /* window id -> slot 下标，由 state_window_add/remove 维护 */
+  id_map_t window_index;
+  /* window_attrs[] 中 app_id/role/class/instance 的驻留字符串 */
+  string_pool_t strings;
 
   /* 分层堆叠顺序：每层内部从低到高排列 */
   layer_stack_t stacks[ZDWM_WINDOW_LAYER_COUNT];
@@ -97,9 +167,38 @@ void state_workspace_set_focused_window(
   workspace_id_t workspace_id,
   window_id_t window_id
 );
+/**
+ * @brief 焦点历史中排在当前焦点窗口之后的窗口
+ *
+ * 聚焦返回的窗口会把它移到历史最前，因此反复调用会在最近的两个窗口
+ * 之间切换。
+ *
+ * @return 不存在时返回 ZDWM_WINDOW_ID_INVALID
+ */
+window_id_t
+state_workspace_mru_previous(const state_t *state, workspace_id_t workspace_id);
+/**
+ * @brief 把焦点历史最前的窗口移到末尾，返回新的最前窗口
+ *
+ * 配合聚焦返回的窗口，反复调用会按最近使用顺序依次遍历所有窗口。
+ *
+ * @return 历史中少于两个窗口时返回 ZDWM_WINDOW_ID_INVALID
+ */
+window_id_t state_workspace_mru_rotate(state_t *state, workspace_id_t id);
 size_t state_workspace_count(const state_t *state);
 bool state_workspace_valid(const state_t *state, workspace_id_t id);
 
+/*
+ * 按加入顺序遍历归属 workspace 的窗口，开销只与该 workspace 的窗口数相关
+ *
+ * for (auto w = state_workspace_window_first(state, id); w;
+ *      w = state_workspace_window_next(state, w))
+ */
+const window_t *
+state_workspace_window_first(const state_t *state, workspace_id_t id);
+const window_t *
+state_workspace_window_next(const state_t *state, const window_t *window);
+
 /**
  * @brief 当前 workspace 是否显示
  *
@@ -139,6 +238,12 @@ bool state_output_set_current_workspace(
   workspace_id_t *old_workspace_id
 );
 size_t state_output_count(const state_t *state);
+/**
+ * @brief output 当前显示的 workspace 是否需要重新布局
+ *
+ * output 自身或其当前 workspace 被标记为 dirty 时返回 true。
+ */
+bool state_output_need_relayout(const state_t *state, output_id_t id);
 bool state_output_valid(const state_t *state, output_id_t id);
 void state_cycle_current_output(state_t *state, int delta);
 /**
@@ -158,18 +263,50 @@ bool state_set_current_output(state_t *state, output_id_t output_id);
  * 接口返回的 window 对象仅提供只读访问。
  * window 的运行期可变状态必须通过专门的 state 级更新接口修改。
  */
+/*
+ * 返回的 window 指针在其他窗口删除后仍然有效，但添加窗口可能导致存储扩容
+ * 而使其失效；需要跨越窗口添加长期持有时应使用 window_handle_t。
+ */
 /*
  * 添加窗口，并将其追加到对应堆栈顶部
  *
  * info 提供窗口的基础信息
  * workspace 归属与其他策略相关字段由后续 state_window_* 接口设置。
+ * transient_for 只记录已被管理的窗口；父窗口不存在时按无父窗口处理。
+ * id 无效时不做任何修改，返回 nullptr。
  */
 const window_t *state_window_add(state_t *state, const window_info_t *info);
 const window_t *state_window_get(const state_t *state, window_id_t id);
-const window_t *state_window_at(const state_t *state, size_t index);
 /* 删除窗口，同步将其从对应的堆叠栈中移除，并调整对应 workspace 的焦点窗口 */
 void state_window_remove(state_t *state, window_id_t id);
 size_t state_window_count(const state_t *state);
+/* 窗口不存在时返回 nullptr */
+const window_attrs_t *state_window_attrs(const state_t *state, window_id_t id);
+
+/* 窗口不存在时返回零值句柄 */
+window_handle_t state_window_handle(const state_t *state, window_id_t id);
+/* 句柄对应的窗口已被删除时返回 nullptr */
+const window_t *
+state_window_resolve(const state_t *state, window_handle_t handle);
+
+/*
+ * 按添加顺序遍历存活窗口
+ *
+ * for (auto w = state_window_first(state); w; w = state_window_next(state, w))
+ */
+const window_t *state_window_first(const state_t *state);
+const window_t *
+state_window_next(const state_t *state, const window_t *window);
+
+/*
+ * 脏标记
+ *
+ * 会影响布局结果的更新接口（workspace 成员变化、布局切换、窗口的
+ * fullscreen/maximized/minimized/floating/border_width、output 的工作区域与
+ * 当前 workspace）会标记对应的 workspace 或 output，frame_rect 等布局输出
+ * 不会。运行时只为被标记的 output 重新布局，应用完副作用后统一清除。
+ */
+void state_clear_dirty(state_t *state);
 
 /* state 持有的单个 window 状态更新接口 */
 void state_window_set_workspace(
@@ -278,8 +415,37 @@ bool state_window_set_instance(
   const char *instance_name
 );
 
-bool state_stack_raise(state_t *state, window_id_t window_id);
-bool state_stack_lower(state_t *state, window_id_t window_id);
+/**
+ * @brief 计算窗口在全局堆叠顺序中的位置
+ *
+ * @param move_out 写入"将窗口放到 sibling 正上方"的移动描述；sibling 为
+ *                 同层下方窗口，层底时为更低层的最高窗口，没有时为无效 id
+ * @return 窗口存在时返回 true
+ */
+bool state_stack_place(
+  const state_t *state,
+  window_id_t window_id,
+  restack_item_t *move_out
+);
+/**
+ * @brief 将窗口提升到所在层顶部 / 下沉到所在层底部
+ *
+ * 只有被移动的窗口本身需要重新堆叠，move_out 给出其唯一的移动描述，
+ * 可直接作为 ZDWM_EFFECT_RESTACK_WINDOWS 的内容。
+ *
+ * @param move_out 顺序发生变化时写入移动描述，可为 nullptr
+ * @return 仅在窗口存在且顺序发生变化时返回 true
+ */
+bool state_stack_raise(
+  state_t *state,
+  window_id_t window_id,
+  restack_item_t *move_out
+);
+bool state_stack_lower(
+  state_t *state,
+  window_id_t window_id,
+  restack_item_t *move_out
+);
 
 /**
  * @brief 获取 workspace_id 对应 workspace 需要自动布局的窗口列表
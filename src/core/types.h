@@ -24,6 +24,10 @@ typedef uint32_t keysym_t;
 
 #define ZDWM_OUTPUT_ID_INVALID ((output_id_t)UINT32_MAX)
 
+static inline bool rect_equal(rect_t a, rect_t b) {
+  return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
 typedef struct point_t {
   int32_t x;
   int32_t y;
@@ -92,6 +96,15 @@ typedef struct configure_data_t {
   uint32_t stack_mode;
 } configure_data_t;
 
+/*
+ * 堆叠顺序的单步移动：将 window 放到 sibling 正上方。
+ * sibling 为 ZDWM_WINDOW_ID_INVALID 时表示放到所有受管窗口的最底部。
+ */
+typedef struct restack_item_t {
+  window_id_t window;
+  window_id_t sibling;
+} restack_item_t;
+
 typedef struct border_config_t {
   uint32_t width;
   color_t normal_color;
@@ -64,33 +64,47 @@ typedef struct window_metadata_t {
   char *instance_name;
 } window_metadata_t;
 
+/*
+ * state 中存放的窗口元数据（冷数据）
+ *
+ * 核心算法不依赖，仅用于规则匹配和信息展示；单独存放在与 windows[]
+ * 下标一一对应的表里，不占用热路径的缓存行。
+ * title 由窗口独占，其余字段是 state 字符串池中的驻留字符串，
+ * 指针相等即内容相等。
+ */
+typedef struct window_attrs_t {
+  char *title;
+  const char *app_id;
+  const char *role;
+  const char *class_name;
+  const char *instance_name;
+} window_attrs_t;
+
+/*
+ * 窗口热数据
+ *
+ * 布局与过滤遍历只访问这里的字段，状态位以位域紧凑存放，
+ * 一个 window_t 小于一条缓存行。
+ */
 typedef struct window_t {
   window_id_t id;
   window_id_t transient_for;
   workspace_id_t workspace_id;
-
-  window_layer_type_t layer;
-  bool fullscreen;
-  bool maximized;
-  bool minimized;
-  bool floating;
-  bool sticky;
-  bool urgent;
-  bool fixed_size;
-  bool skip_taskbar;
+  uint32_t border_width;
 
   /* 几何信息（均为包含边框后的外框矩形） */
   rect_t float_rect; /* floating 模式下记忆的外框矩形 */
   rect_t frame_rect; /* 当前外框矩形（由 layout 或 float_rect 解析） */
 
-  /* 元数据（核心算法不依赖，仅用于规则匹配和信息展示） */
-  char *title;
-  char *app_id;
-  char *role;
-  char *class_name;
-  char *instance_name;
-
-  uint32_t border_width;
+  uint8_t layer; /* window_layer_type_t */
+  bool fullscreen   : 1;
+  bool maximized    : 1;
+  bool minimized    : 1;
+  bool floating     : 1;
+  bool sticky       : 1;
+  bool urgent       : 1;
+  bool fixed_size   : 1;
+  bool skip_taskbar : 1;
 } window_t;
 
 window_layer_type_t window_classify_layer(const window_layer_props_t *props);
@@ -108,22 +122,38 @@ void window_set_fixed_size(window_t *window, bool fixed_size);
 void window_set_skip_taskbar(window_t *window, bool skip_taskbar);
 void window_set_float_rect(window_t *window, rect_t rect);
 void window_set_frame_rect(window_t *window, rect_t rect);
-void window_set_title(window_t *window, const char *title);
-void window_set_app_id(window_t *window, const char *app_id);
-void window_set_role(window_t *window, const char *role);
-void window_set_class(window_t *window, const char *class_name);
-void window_set_instance(window_t *window, const char *instance_name);
 void window_set_border_width(window_t *window, uint32_t border_width);
-void window_take_metadata(
-  window_t *window,
-  window_metadata_t *metadata,
-  uint32_t changed_fields
-);
+
+/*
+ * 以下判断位于布局和过滤遍历的热路径上，定义为内联函数，
+ * 让编译器把对相邻状态位的检查合并为一次掩码比较。
+ */
 
 /**
  * @brief 窗口是否需要参与布局计算
  */
-bool window_need_layout(const window_t *window);
-bool window_need_move(const window_t *window, int32_t x, int32_t y);
-bool window_need_resize(const window_t *window, int32_t width, int32_t height);
-bool window_should_has_border(const window_t *window);
+static inline bool window_need_layout(const window_t *window) {
+  if (window->floating) return false;
+
+  if (window->fullscreen || window->maximized || window->minimized) {
+    return false;
+  }
+
+  return true;
+}
+
+static inline bool
+window_need_move(const window_t *window, int32_t x, int32_t y) {
+  return window->frame_rect.x != x || window->frame_rect.y != y;
+}
+
+static inline bool
+window_need_resize(const window_t *window, int32_t width, int32_t height) {
+  return window->frame_rect.width != width ||
+         window->frame_rect.height != height;
+}
+
+static inline bool window_should_has_border(const window_t *window) {
+  if (window->fullscreen || window->maximized) return false;
+  return window->floating;
+}
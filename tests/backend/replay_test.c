@@ -0,0 +1,175 @@
+#define _GNU_SOURCE /* open_memstream */
+
+#include "backend/replay/replay.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base/macros.h"
+#include "core/backend.h"
+#include "core/event.h"
+#include "core/plan.h"
+#include "core/types.h"
+#include "core/window.h"
+
+static backend_t *replay_create(const char *text) {
+  return replay_backend_create_from_text(text, strlen(text));
+}
+
+static void test_replay_parse(void) {
+  backend_t *backend = replay_create(
+    "# comment\n"
+    "output left 0 0 1280 720\n"
+    "output right 1280 0 1920 1080\n"
+    "map 0x10 1 2 300 200 class=term title=a urgent type=dialog state=above\n"
+    "title 0x10 hello # world\n"
+    "configure 0x10 width=640 border=2\n"
+    "remove 0x10 destroy\n"
+  );
+  assert(backend);
+
+  backend_detect_t *detect = backend_detect(backend);
+  assert(detect->output_count == 2);
+  assert(strcmp(detect->outputs[1].name, "right") == 0);
+  assert(detect->outputs[1].geometry.x == 1280);
+  assert(detect->outputs[1].geometry.width == 1920);
+  backend_detect_destroy(detect);
+
+  event_t event = {0};
+  assert(backend_poll_event(backend, &event));
+  assert(event.type == ZDWM_EVENT_WINDOW_MAP_REQUEST);
+  auto map = &event.as.window_map_request;
+  assert(map->window == 0x10);
+  assert(map->rect.x == 1 && map->rect.height == 200);
+  assert(map->urgent && !map->fullscreen);
+  assert(strcmp(map->metadata.class_name, "term") == 0);
+  assert(strcmp(map->metadata.title, "a") == 0);
+  assert(map->props.type_count == 1);
+  assert(map->props.types[0] == ZDWM_WINDOW_TYPE_DIALOG);
+  assert(map->props.state_count == 1);
+  assert(map->props.states[0] == ZDWM_WINDOW_STATE_ABOVE);
+  event_cleanup(&event);
+
+  /* 标题取到行尾，其中的 # 不是注释 */
+  assert(backend_poll_event(backend, &event));
+  assert(event.type == ZDWM_EVENT_WINDOW_METADATA_CHANGED);
+  assert(
+    strcmp(event.as.window_metadata_change.metadata.title, "hello # world") == 0
+  );
+  event_cleanup(&event);
+
+  assert(backend_poll_event(backend, &event));
+  assert(event.type == ZDWM_EVENT_CONFIGURE_REQUEST);
+  auto configure = &event.as.configure_request;
+  assert(configure->changed_fields ==
+         (ZDWM_CONFIGURE_FIELD_WIDTH | ZDWM_CONFIGURE_FIELD_BORDER_WIDTH));
+  assert(configure->width == 640 && configure->border_width == 2);
+  event_cleanup(&event);
+
+  assert(backend_poll_event(backend, &event));
+  assert(event.type == ZDWM_EVENT_WINDOW_REMOVE);
+  assert(event.as.window_remove.reason == ZDWM_WINDOW_REMOVE_DESTROY);
+  event_cleanup(&event);
+
+  assert(!backend_poll_event(backend, &event));
+  assert(replay_backend_event_count(backend) == 4);
+  backend_destroy(backend);
+}
+
+static void test_replay_sync(void) {
+  backend_t *backend = replay_create(
+    "sync\n"
+    "enter 0x1\n"
+    "enter 0x2\n"
+    "sync\n"
+    "sync\n"
+    "enter 0x3\n"
+    "sync\n"
+  );
+  assert(backend);
+
+  /* 开头与重复的 sync 不产生空批次 */
+  event_t event = {0};
+  assert(backend_poll_event(backend, &event));
+  assert(event.as.pointer_enter.window == 0x1);
+  assert(backend_poll_event(backend, &event));
+  assert(event.as.pointer_enter.window == 0x2);
+  assert(!backend_poll_event(backend, &event));
+  assert(backend_poll_event(backend, &event));
+  assert(event.as.pointer_enter.window == 0x3);
+  assert(!backend_poll_event(backend, &event));
+  assert(!backend_poll_event(backend, &event));
+  backend_destroy(backend);
+
+  /* backend_next_event() 跨过批次边界 */
+  backend = replay_create("enter 0x1\nsync\nenter 0x2\n");
+  assert(backend_next_event(backend, &event));
+  assert(backend_next_event(backend, &event));
+  assert(event.as.pointer_enter.window == 0x2);
+  assert(!backend_next_event(backend, &event));
+  backend_destroy(backend);
+}
+
+static void test_replay_invalid(void) {
+  assert(!replay_create("map 0x10 0 0 1 bogus\n"));
+  assert(!replay_create("enter\n"));
+  assert(!replay_create("enter 0x1 0x2\n"));
+  assert(!replay_create("state 0x1 fullscreen flip\n"));
+  assert(!replay_create("unknown 0x1\n"));
+}
+
+static void test_replay_record(void) {
+  backend_t *backend = replay_create("");
+  assert(backend);
+
+  char *text  = nullptr;
+  size_t size = 0;
+  FILE *out   = open_memstream(&text, &size);
+  assert(out);
+  replay_backend_record(backend, out);
+
+  window_id_t windows[]    = {0x1, 0x2};
+  restack_item_t items[]   = {{0x2, 0x1}};
+  const effect_t effects[] = {
+    {.type = ZDWM_EFFECT_MAP_WINDOW, .as.map = {0x1}},
+    {.type = ZDWM_EFFECT_FULLSCREEN_WINDOW, .as.fullscreen = {0x2, true}},
+    {.type         = ZDWM_EFFECT_CONFIGURE_WINDOW,
+     .as.configure = {
+       .window         = 0x1,
+       .changed_fields = ZDWM_CONFIGURE_FIELD_X | ZDWM_CONFIGURE_FIELD_HEIGHT,
+       .x              = -5,
+       .height         = 30,
+     }},
+    {.type                  = ZDWM_EFFECT_CHANGE_WINDOW_LIST,
+     .as.change_window_list = {.windows = windows, .count = 2}},
+    {.type               = ZDWM_EFFECT_RESTACK_WINDOWS,
+     .as.restack_windows = {.items = items, .count = 1}},
+    {.type = ZDWM_EFFECT_WATCH_WINDOW, .as.watch = {0x2}},
+  };
+  assert(backend_apply_effect(backend, effects, countof(effects)));
+  fclose(out);
+
+  assert(strcmp(
+           text,
+           "apply 6\n"
+           "map 0x1\n"
+           "fullscreen 0x2 1\n"
+           "configure 0x1 x=-5 height=30\n"
+           "window_list 0x1 0x2\n"
+           "restack 0x2:0x1\n"
+           "watch 0x2\n"
+         ) == 0);
+  free(text);
+  backend_destroy(backend);
+}
+
+int main(void) {
+  test_replay_parse();
+  test_replay_sync();
+  test_replay_invalid();
+  test_replay_record();
+  return 0;
+}
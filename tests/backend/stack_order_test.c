@@ -0,0 +1,145 @@
+#include "backend/stack_order.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/memory.h"
+#include "base/window_list.h"
+#include "core/types.h"
+
+static void order_set(window_list_t *order, const window_id_t *ids, size_t n) {
+  window_list_reset(order);
+  for (size_t i = 0; i < n; ++i) window_list_push(order, ids[i]);
+}
+
+static bool order_equal(const window_list_t *a, const window_list_t *b) {
+  if (a->count != b->count) return false;
+  for (size_t i = 0; i < a->count; ++i) {
+    if (a->windows[i] != b->windows[i]) return false;
+  }
+  return true;
+}
+
+/* 把 moves 作用到 from 的副本上，结果应当与 to 一致 */
+static void assert_moves_reach(
+  const window_list_t *from,
+  const window_list_t *to,
+  const restack_item_t *moves,
+  size_t move_count
+) {
+  window_list_t result = {0};
+  stack_order_copy(&result, from);
+  for (size_t i = 0; i < move_count; ++i) {
+    assert(stack_order_apply(&result, &moves[i]));
+  }
+  assert(order_equal(&result, to));
+  p_delete(&result.windows);
+}
+
+static void test_stack_order_apply(void) {
+  window_list_t order = {0};
+
+  /* 不在顺序中的窗口被插入；sibling 无效时放到最底部 */
+  assert(stack_order_apply(&order, &(restack_item_t){1, 0}));
+  assert(stack_order_apply(&order, &(restack_item_t){2, 1}));
+  assert(stack_order_apply(&order, &(restack_item_t){3, 0}));
+  assert(stack_order_apply(&order, &(restack_item_t){1, 2}));
+  window_list_t expected = {0};
+  order_set(&expected, (window_id_t[]){3, 2, 1}, 3);
+  assert(order_equal(&order, &expected));
+
+  /* sibling 未知时不修改顺序 */
+  assert(!stack_order_apply(&order, &(restack_item_t){3, 9}));
+  assert(order_equal(&order, &expected));
+
+  assert(stack_order_remove(&order, 2));
+  assert(!stack_order_remove(&order, 2));
+  order_set(&expected, (window_id_t[]){3, 1}, 2);
+  assert(order_equal(&order, &expected));
+
+  p_delete(&expected.windows);
+  p_delete(&order.windows);
+}
+
+static void test_stack_order_diff(void) {
+  window_list_t from = {0};
+  window_list_t to   = {0};
+  restack_item_t moves[8];
+
+  /* 顺序相同时不需要移动 */
+  order_set(&from, (window_id_t[]){1, 2, 3, 4, 5}, 5);
+  order_set(&to, (window_id_t[]){1, 2, 3, 4, 5}, 5);
+  assert(stack_order_diff(&from, &to, moves) == 0);
+
+  /* 提升最底部的窗口只需一次移动 */
+  order_set(&to, (window_id_t[]){2, 3, 4, 5, 1}, 5);
+  assert(stack_order_diff(&from, &to, moves) == 1);
+  assert(moves[0].window == 1 && moves[0].sibling == 5);
+
+  /* 下沉到最底部时 sibling 为无效 id */
+  order_set(&to, (window_id_t[]){4, 1, 2, 3, 5}, 5);
+  assert(stack_order_diff(&from, &to, moves) == 1);
+  assert(moves[0].window == 4 && window_id_invalid(moves[0].sibling));
+
+  /* 完全反转：最长递增子序列长度为 1 */
+  order_set(&to, (window_id_t[]){5, 4, 3, 2, 1}, 5);
+  size_t count = stack_order_diff(&from, &to, moves);
+  assert(count == 4);
+  assert_moves_reach(&from, &to, moves, count);
+
+  /* from 中没有的窗口总要移动 */
+  order_set(&to, (window_id_t[]){1, 6, 2, 3, 4, 5}, 6);
+  assert(stack_order_diff(&from, &to, moves) == 1);
+  assert(moves[0].window == 6 && moves[0].sibling == 1);
+
+  p_delete(&to.windows);
+  p_delete(&from.windows);
+}
+
+/* xorshift32，保证每次运行的序列一致 */
+static uint32_t next_rand(uint32_t *seed) {
+  uint32_t x  = *seed;
+  x          ^= x << 13;
+  x          ^= x >> 17;
+  x          ^= x << 5;
+  *seed       = x;
+  return x;
+}
+
+static void test_stack_order_diff_random(void) {
+  static constexpr size_t N = 64;
+
+  uint32_t seed       = 0x2545f491u;
+  window_list_t from  = {0};
+  window_list_t to    = {0};
+  restack_item_t *buf = p_new(restack_item_t, N);
+  for (size_t round = 0; round < 200; ++round) {
+    window_list_reset(&from);
+    for (size_t i = 0; i < N; ++i) window_list_push(&from, (window_id_t)i + 1);
+
+    /* 随机提升或下沉几个窗口，移动数不超过被移动的窗口数 */
+    size_t moved = next_rand(&seed) % 4;
+    stack_order_copy(&to, &from);
+    for (size_t i = 0; i < moved; ++i) {
+      window_id_t window  = next_rand(&seed) % N + 1;
+      window_id_t sibling = next_rand(&seed) % (N + 1);
+      assert(stack_order_apply(&to, &(restack_item_t){window, sibling}));
+    }
+
+    size_t count = stack_order_diff(&from, &to, buf);
+    assert(count <= moved);
+    assert_moves_reach(&from, &to, buf, count);
+  }
+
+  p_delete(&buf);
+  p_delete(&to.windows);
+  p_delete(&from.windows);
+}
+
+int main(void) {
+  test_stack_order_apply();
+  test_stack_order_diff();
+  test_stack_order_diff_random();
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include "backend/window_list_property.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "base/macros.h"
+#include "core/types.h"
+
+static void assert_write(
+  window_list_property_t *property,
+  bool append,
+  const window_id_t *windows,
+  size_t count
+) {
+  window_list_write_t write = {0};
+  assert(window_list_property_flush(property, &write));
+  assert(write.append == append);
+  assert(write.count == count);
+  if (count) {
+    assert(memcmp(write.windows, windows, count * sizeof(*windows)) == 0);
+  }
+}
+
+static void test_window_list_property_flush(void) {
+  window_list_property_t property = {0};
+  window_list_write_t write       = {0};
+
+  /* 没有收到内容时不写入 */
+  assert(!window_list_property_flush(&property, &write));
+
+  /* 第一次写入整体替换，即使列表为空 */
+  window_list_property_set(&property, nullptr, 0);
+  assert_write(&property, false, nullptr, 0);
+
+  const window_id_t first[] = {1, 2};
+  window_list_property_set(&property, first, countof(first));
+  assert_write(&property, true, first, countof(first));
+
+  /* 只新增窗口时只追加新增部分 */
+  const window_id_t grown[] = {1, 2, 3, 4};
+  window_list_property_set(&property, grown, countof(grown));
+  assert_write(&property, true, grown + 2, 2);
+
+  /* 内容不变时不写入，已经取出过的内容也不再写入 */
+  window_list_property_set(&property, grown, countof(grown));
+  assert(!window_list_property_flush(&property, &write));
+  assert(!window_list_property_flush(&property, &write));
+
+  /* 删除窗口时整体替换 */
+  const window_id_t removed[] = {1, 3, 4};
+  window_list_property_set(&property, removed, countof(removed));
+  assert_write(&property, false, removed, countof(removed));
+
+  /* 重排时整体替换 */
+  const window_id_t reordered[] = {3, 1, 4};
+  window_list_property_set(&property, reordered, countof(reordered));
+  assert_write(&property, false, reordered, countof(reordered));
+
+  /* 一次应用中只有最后一次要求生效 */
+  window_list_property_set(&property, first, countof(first));
+  window_list_property_set(&property, removed, countof(removed));
+  const window_id_t last[] = {3, 1, 4, 5};
+  window_list_property_set(&property, last, countof(last));
+  assert_write(&property, true, last + 3, 1);
+
+  window_list_property_cleanup(&property);
+}
+
+int main(void) {
+  test_window_list_property_flush();
+  return 0;
+}
@@ -0,0 +1,251 @@
+#include "base/event_loop.h"
+
+#include <assert.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+typedef struct test_io_t {
+  event_loop_io_t io;
+  event_loop_t *loop;
+  int calls;
+  uint32_t events;
+  event_loop_io_t *remove; /* 回调中要删除的另一个 io */
+} test_io_t;
+
+static void test_io_ready(event_loop_io_t *io, uint32_t events) {
+  test_io_t *t = io->userdata;
+  t->calls++;
+  t->events = events;
+
+  char buf[16];
+  (void)read(io->fd, buf, sizeof(buf));
+  if (t->remove) event_loop_remove_io(t->loop, t->remove);
+}
+
+static void test_event_loop_io(void) {
+  event_loop_t loop;
+  assert(event_loop_init(&loop));
+
+  int fds[2];
+  assert(pipe(fds) == 0);
+
+  test_io_t t = {.loop = &loop};
+  t.io        = (event_loop_io_t){fds[0], EPOLLIN, test_io_ready, &t};
+  assert(event_loop_add_io(&loop, &t.io));
+
+  /* 没有数据时超时返回，不回调 */
+  assert(event_loop_dispatch(&loop, 0));
+  assert(t.calls == 0);
+
+  assert(write(fds[1], "x", 1) == 1);
+  assert(event_loop_dispatch(&loop, -1));
+  assert(t.calls == 1);
+  assert(t.events & EPOLLIN);
+
+  /* 写端关闭后报告 EPOLLHUP */
+  close(fds[1]);
+  assert(event_loop_dispatch(&loop, -1));
+  assert(t.calls == 2);
+  assert(t.events & EPOLLHUP);
+
+  event_loop_remove_io(&loop, &t.io);
+  assert(event_loop_dispatch(&loop, 0));
+  assert(t.calls == 2);
+
+  close(fds[0]);
+  event_loop_cleanup(&loop);
+}
+
+static void test_event_loop_remove_ready_io(void) {
+  event_loop_t loop;
+  assert(event_loop_init(&loop));
+
+  int a[2];
+  int b[2];
+  assert(pipe(a) == 0);
+  assert(pipe(b) == 0);
+
+  test_io_t ta = {.loop = &loop};
+  test_io_t tb = {.loop = &loop};
+  ta.io        = (event_loop_io_t){a[0], EPOLLIN, test_io_ready, &ta};
+  tb.io        = (event_loop_io_t){b[0], EPOLLIN, test_io_ready, &tb};
+  ta.remove    = &tb.io;
+  tb.remove    = &ta.io;
+  assert(event_loop_add_io(&loop, &ta.io));
+  assert(event_loop_add_io(&loop, &tb.io));
+
+  /* 两个 fd 同时就绪，先回调的一方删除另一方后，另一方不再被回调 */
+  assert(write(a[1], "x", 1) == 1);
+  assert(write(b[1], "x", 1) == 1);
+  assert(event_loop_dispatch(&loop, -1));
+  assert(ta.calls + tb.calls == 1);
+
+  close(a[0]);
+  close(a[1]);
+  close(b[0]);
+  close(b[1]);
+  event_loop_cleanup(&loop);
+}
+
+typedef struct test_timer_t {
+  event_loop_timer_t timer;
+  event_loop_t *loop;
+  int calls;
+  int stop_after;
+} test_timer_t;
+
+static void test_timer_fired(event_loop_timer_t *timer) {
+  test_timer_t *t = timer->userdata;
+  t->calls++;
+  if (t->calls == t->stop_after) {
+    event_loop_timer_stop(t->loop, timer);
+    event_loop_stop(t->loop);
+  }
+}
+
+static void test_event_loop_timers(void) {
+  event_loop_t loop;
+  assert(event_loop_init(&loop));
+
+  test_timer_t once = {
+    .timer = {.fn = test_timer_fired, .userdata = &once},
+    .loop  = &loop,
+  };
+  test_timer_t periodic = {
+    .timer      = {.fn = test_timer_fired, .userdata = &periodic},
+    .loop       = &loop,
+    .stop_after = 3,
+  };
+  test_timer_t stopped = {
+    .timer = {.fn = test_timer_fired, .userdata = &stopped},
+    .loop  = &loop,
+  };
+
+  event_loop_timer_start(&loop, &once.timer, 1000000, 0);
+  event_loop_timer_start(&loop, &periodic.timer, 2000000, 1000000);
+  event_loop_timer_start(&loop, &stopped.timer, 1000000, 0);
+  event_loop_timer_stop(&loop, &stopped.timer);
+  assert(!stopped.timer.active);
+
+  uint64_t start = event_loop_now_ns();
+  assert(event_loop_run(&loop));
+  assert(event_loop_now_ns() - start >= 4000000);
+
+  assert(once.calls == 1);
+  assert(!once.timer.active);
+  assert(periodic.calls == 3);
+  assert(!periodic.timer.active);
+  assert(stopped.calls == 0);
+  assert(loop.timer_count == 0);
+
+  event_loop_cleanup(&loop);
+}
+
+typedef struct order_timer_t {
+  event_loop_timer_t timer;
+  event_loop_t *loop;
+  int id;
+  bool last;
+} order_timer_t;
+
+static int fired_ids[8];
+static int fired_count;
+
+static void test_order_timer_fired(event_loop_timer_t *timer) {
+  order_timer_t *t = timer->userdata;
+  /* 按 tick 向上取整，不会早于到期时间触发 */
+  assert(event_loop_now_ns() >= timer->deadline_ns);
+  fired_ids[fired_count++] = t->id;
+  if (t->last) event_loop_stop(t->loop);
+}
+
+static void test_event_loop_timer_wheel(void) {
+  static constexpr uint64_t MS = 1000000;
+
+  event_loop_t loop;
+  assert(event_loop_init(&loop));
+
+  /* 跨越第 0、1 层，以及第 2、3 层和超出时间轮范围的远期定时器 */
+  const uint64_t delays[] = {
+    130 * MS, 3 * MS, 70 * MS, 64 * MS, 1 * MS, 600000 * MS, 36000000 * MS,
+  };
+  order_timer_t timers[7];
+  for (int i = 0; i < 7; ++i) {
+    timers[i] = (order_timer_t){
+      .timer = {.fn = test_order_timer_fired, .userdata = &timers[i]},
+      .loop  = &loop,
+      .id    = i,
+      .last  = i == 0,
+    };
+    event_loop_timer_start(&loop, &timers[i].timer, delays[i], 0);
+  }
+  assert(loop.timer_count == 7);
+  /* timerfd 只按最早的定时器设置 */
+  assert(loop.armed_tick == timers[4].timer.expires_tick);
+
+  assert(event_loop_run(&loop));
+  assert(fired_count == 5);
+  assert(fired_ids[0] == 4);
+  assert(fired_ids[1] == 1);
+  assert(fired_ids[2] == 3);
+  assert(fired_ids[3] == 2);
+  assert(fired_ids[4] == 0);
+
+  assert(loop.timer_count == 2);
+  assert(timers[5].timer.active && timers[6].timer.active);
+  assert(loop.armed_tick == timers[5].timer.expires_tick);
+
+  event_loop_timer_stop(&loop, &timers[5].timer);
+  assert(loop.armed_tick == timers[6].timer.expires_tick);
+  event_loop_timer_stop(&loop, &timers[6].timer);
+  assert(loop.timer_count == 0);
+  assert(loop.armed_tick == 0);
+
+  event_loop_cleanup(&loop);
+}
+
+static int signal_calls;
+static int signal_last;
+
+static void test_signal_received(event_loop_t *loop, int signo, void *data) {
+  signal_calls++;
+  signal_last = signo;
+  event_loop_stop(loop);
+}
+
+static void test_event_loop_signals(void) {
+  event_loop_t loop;
+  assert(event_loop_init(&loop));
+
+  assert(event_loop_add_signal(&loop, SIGUSR1, test_signal_received, nullptr));
+  assert(event_loop_add_signal(&loop, SIGUSR2, test_signal_received, nullptr));
+
+  /* 信号被屏蔽，不会终止进程，而是在下一次分派时回调 */
+  raise(SIGUSR2);
+  assert(signal_calls == 0);
+  assert(event_loop_run(&loop));
+  assert(signal_calls == 1);
+  assert(signal_last == SIGUSR2);
+
+  event_loop_remove_signal(&loop, SIGUSR2);
+  sigset_t blocked;
+  sigprocmask(SIG_BLOCK, nullptr, &blocked);
+  assert(sigismember(&blocked, SIGUSR1));
+  assert(!sigismember(&blocked, SIGUSR2));
+
+  /* cleanup 恢复注册前的屏蔽字 */
+  event_loop_cleanup(&loop);
+  sigprocmask(SIG_BLOCK, nullptr, &blocked);
+  assert(!sigismember(&blocked, SIGUSR1));
+}
+
+int main(void) {
+  test_event_loop_io();
+  test_event_loop_remove_ready_io();
+  test_event_loop_timers();
+  test_event_loop_timer_wheel();
+  test_event_loop_signals();
+  return 0;
+}
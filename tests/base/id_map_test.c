@@ -0,0 +1,75 @@
+#include "base/id_map.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+static void test_id_map_empty(void) {
+  id_map_t map   = {0};
+  uint32_t value = 0;
+
+  assert(!id_map_get(&map, 1, &value));
+  assert(!id_map_remove(&map, 1));
+
+  /* 0 作为空槽位标记，不允许插入 */
+  id_map_set(&map, 0, 1);
+  assert(map.count == 0);
+
+  id_map_cleanup(&map);
+}
+
+static void test_id_map_set_get_overwrite(void) {
+  id_map_t map   = {0};
+  uint32_t value = 0;
+
+  id_map_set(&map, 0x1a00003, 7);
+  assert(id_map_get(&map, 0x1a00003, &value));
+  assert(value == 7);
+
+  id_map_set(&map, 0x1a00003, 9);
+  assert(map.count == 1);
+  assert(id_map_get(&map, 0x1a00003, &value));
+  assert(value == 9);
+
+  id_map_cleanup(&map);
+}
+
+static void test_id_map_grow_and_remove(void) {
+  static constexpr uint32_t count = 4096;
+  id_map_t map                    = {0};
+  uint32_t value                  = 0;
+
+  for (uint32_t i = 1; i <= count; ++i) {
+    id_map_set(&map, 0x1a00000 + i, i);
+  }
+  assert(map.count == count);
+  assert(map.count * 2 <= map.capacity);
+
+  /* 删除一半，剩余条目必须仍然可以找到（校验 backward shift） */
+  for (uint32_t i = 1; i <= count; i += 2) {
+    assert(id_map_remove(&map, 0x1a00000 + i));
+  }
+  assert(map.count == count / 2);
+
+  for (uint32_t i = 1; i <= count; ++i) {
+    bool found = id_map_get(&map, 0x1a00000 + i, &value);
+    if (i % 2) {
+      assert(!found);
+    } else {
+      assert(found);
+      assert(value == i);
+    }
+  }
+
+  id_map_reset(&map);
+  assert(map.count == 0);
+  assert(!id_map_get(&map, 0x1a00002, nullptr));
+
+  id_map_cleanup(&map);
+}
+
+int main(void) {
+  test_id_map_empty();
+  test_id_map_set_get_overwrite();
+  test_id_map_grow_and_remove();
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include "base/string_pool.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static void test_string_pool_shares_equal_strings(void) {
+  string_pool_t pool = {0};
+
+  char buffer[] = "firefox";
+  const char *a = string_pool_intern(&pool, "firefox");
+  const char *b = string_pool_intern(&pool, buffer);
+  assert(a == b && a != buffer);
+  assert(strcmp(a, "firefox") == 0);
+  assert(string_pool_refcount(a) == 2);
+  assert(pool.count == 1);
+
+  assert(string_pool_find(&pool, "firefox") == a);
+  assert(!string_pool_find(&pool, "chromium"));
+  assert(string_pool_refcount(a) == 2);
+
+  assert(!string_pool_intern(&pool, nullptr));
+  assert(!string_pool_find(&pool, nullptr));
+  string_pool_release(&pool, nullptr);
+
+  /* 空字符串也是合法的驻留字符串 */
+  const char *empty = string_pool_intern(&pool, "");
+  assert(empty && empty != a && pool.count == 2);
+
+  string_pool_cleanup(&pool);
+}
+
+static void test_string_pool_release_drops_entry(void) {
+  string_pool_t pool = {0};
+
+  const char *a = string_pool_intern(&pool, "term");
+  string_pool_intern(&pool, "term");
+  string_pool_release(&pool, a);
+  assert(string_pool_find(&pool, "term") == a);
+
+  string_pool_release(&pool, a);
+  assert(!string_pool_find(&pool, "term"));
+  assert(pool.count == 0);
+
+  string_pool_cleanup(&pool);
+}
+
+static void test_string_pool_many_strings(void) {
+  string_pool_t pool = {0};
+  static constexpr size_t COUNT = 4096;
+  const char *interned[COUNT];
+  char name[32];
+
+  for (size_t i = 0; i < COUNT; ++i) {
+    snprintf(name, sizeof(name), "class-%zu", i);
+    interned[i] = string_pool_intern(&pool, name);
+  }
+  assert(pool.count == COUNT);
+
+  /* 删除一半后其余字符串仍可通过探测链找到 */
+  for (size_t i = 0; i < COUNT; i += 2) {
+    string_pool_release(&pool, interned[i]);
+  }
+  for (size_t i = 0; i < COUNT; ++i) {
+    snprintf(name, sizeof(name), "class-%zu", i);
+    const char *found = string_pool_find(&pool, name);
+    assert(i % 2 ? found == interned[i] : !found);
+  }
+  assert(pool.count == COUNT / 2);
+
+  string_pool_cleanup(&pool);
+}
+
+int main(void) {
+  test_string_pool_shares_equal_strings();
+  test_string_pool_release_drops_entry();
+  test_string_pool_many_strings();
+
+  return 0;
+}
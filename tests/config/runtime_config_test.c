@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -11,7 +12,7 @@
 #include "helpers.h"
 
 struct backend_t {
-  int unused;
+  uint32_t title_refresh_interval_ms;
 };
 
 void backend_destroy(backend_t *backend) { free(backend); }
@@ -22,6 +23,22 @@ bool backend_next_event(backend_t *backend, event_t *event) {
   return false;
 }
 
+bool backend_poll_event(backend_t *backend, event_t *event) {
+  (void)backend;
+  (void)event;
+  return false;
+}
+
+int backend_get_fd(const backend_t *backend) {
+  (void)backend;
+  return -1;
+}
+
+int backend_poll_timeout(const backend_t *backend) {
+  (void)backend;
+  return -1;
+}
+
 bool backend_apply_effect(
   backend_t *backend,
   const effect_t *effects,
@@ -30,6 +47,18 @@ bool backend_apply_effect(
   return false;
 }
 
+void backend_set_title_refresh_interval(
+  backend_t *backend,
+  uint32_t interval_ms
+) {
+  backend->title_refresh_interval_ms = interval_ms;
+}
+
+void backend_get_stats(const backend_t *backend, backend_stats_t *stats) {
+  (void)backend;
+  *stats = (backend_stats_t){0};
+}
+
 static backend_t *test_backend_create(void) {
   return calloc(1, sizeof(backend_t));
 }
@@ -111,6 +140,7 @@ static void test_runtime_config_keeps_module_loaded_after_runtime_init(
   runtime_init_desc_cleanup(&desc);
 
   assert(runtime.config_module_handle != nullptr);
+  assert(runtime.backend->title_refresh_interval_ms == 100);
 
   layout_fn layout = layout_get(&runtime.layouts, 0);
   assert(layout != nullptr);
@@ -174,6 +204,7 @@ test_runtime_config_falls_back_to_defaults_when_implicit_library_is_missing(
   assert(strcmp(desc.workspaces[1].name, "main") == 0);
   assert(desc.workspaces[0].output_index == 0);
   assert(desc.workspaces[1].output_index == 1);
+  assert(desc.title_refresh_interval_ms == 100);
 
   runtime_config_cleanup(&desc);
   config_test_rmdir(temp_root);
@@ -1,3 +1,7 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
 #include "base/log.h"
 #include "config/runtime_config.h"
 #include "core/backend.h"
@@ -32,13 +36,30 @@ static void bootstrap(runtime_t *runtime) {
   }
 };
 
-int main(void) {
+int main(int argc, char *argv[]) {
   runtime_t runtime = {0};
 
   bootstrap(&runtime);
   runtime_setup(&runtime);
-  runtime_run(&runtime);
+  runtime_restore(&runtime);
+
+  /*
+   * 新进程只从检查点恢复窗口，启动时不扫描已有窗口。检查点写入失败时
+   * 重启会丢掉全部窗口，因此放弃这次重启，继续运行
+   */
+  for (;;) {
+    runtime_run(&runtime);
+    if (!runtime.will_restart || runtime_checkpoint(&runtime) >= 0) break;
+
+    warn("checkpoint failed, restart cancelled");
+    runtime.will_restart = false;
+  }
   runtime_shutdown(&runtime);
 
+  if (runtime.will_restart) {
+    execv(argv[0], argv);
+    fatal("execv() failed: %s", strerror(errno));
+  }
+
   return 0;
 }
@@ -0,0 +1,112 @@
+#include "core/plan.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "base/color.h"
+#include "core/types.h"
+
+static const color_t red  = {.argb = 0xffff0000u};
+static const color_t blue = {.argb = 0xff0000ffu};
+
+static void push_configure(plan_t *plan, window_id_t window, uint32_t fields) {
+  effect_t effect = {
+    .type         = ZDWM_EFFECT_CONFIGURE_WINDOW,
+    .as.configure = {.window = window, .changed_fields = fields},
+  };
+  plan_push_effect(plan, &effect);
+}
+
+static void test_plan_optimize_empty(void) {
+  plan_t plan = {0};
+  assert(plan_optimize(&plan) == 0);
+  assert(plan.count == 0);
+  plan_cleanup(&plan);
+}
+
+static void test_plan_optimize_map_pairs(void) {
+  plan_t plan = {0};
+
+  /* 1: map 后 unmap 抵消；2: unmap 后 map 抵消；3: 重复 map 只留第一个 */
+  plan_push_map_effect(&plan, 1);
+  plan_push_unmap_effect(&plan, 2);
+  plan_push_map_effect(&plan, 3);
+  plan_push_unmap_effect(&plan, 1);
+  plan_push_map_effect(&plan, 2);
+  plan_push_map_effect(&plan, 3);
+  /* 4: unmap、map、unmap 只剩最后一个 unmap */
+  plan_push_unmap_effect(&plan, 4);
+  plan_push_map_effect(&plan, 4);
+  plan_push_unmap_effect(&plan, 4);
+
+  assert(plan_optimize(&plan) == 7);
+  assert(plan.count == 2);
+  assert(plan.effects[0].type == ZDWM_EFFECT_MAP_WINDOW);
+  assert(plan.effects[0].as.map.window == 3);
+  assert(plan.effects[1].type == ZDWM_EFFECT_UNMAP_WINDOW);
+  assert(plan.effects[1].as.unmap.window == 4);
+
+  plan_cleanup(&plan);
+}
+
+static void test_plan_optimize_last_writes(void) {
+  plan_t plan = {0};
+
+  plan_push_focus_effect(&plan, 1);
+  plan_push_change_border_color_effect(&plan, 1, &red);
+  push_configure(&plan, 1, 0);
+  plan_push_change_border_color_effect(&plan, 2, &red);
+  plan_push_focus_effect(&plan, 2);
+  push_configure(&plan, 2, ZDWM_CONFIGURE_FIELD_X);
+  plan_push_change_border_color_effect(&plan, 1, &blue);
+  plan_push_focus_effect(&plan, 1);
+
+  assert(plan_optimize(&plan) == 4);
+  assert(plan.count == 4);
+
+  /* 保留下来的副作用保持原有顺序 */
+  assert(plan.effects[0].type == ZDWM_EFFECT_CHANGE_BORDER_COLOR);
+  assert(plan.effects[0].as.change_border_color.window == 2);
+  assert(plan.effects[1].type == ZDWM_EFFECT_CONFIGURE_WINDOW);
+  assert(plan.effects[1].as.configure.window == 2);
+  assert(plan.effects[2].type == ZDWM_EFFECT_CHANGE_BORDER_COLOR);
+  assert(plan.effects[2].as.change_border_color.window == 1);
+  assert(plan.effects[2].as.change_border_color.color == &blue);
+  assert(plan.effects[3].type == ZDWM_EFFECT_FOCUS_WINDOW);
+  assert(plan.effects[3].as.focus.window == 1);
+
+  /* 删除的槽位被清空，再次优化没有可删除的副作用 */
+  assert(plan.effects[4].type == 0);
+  assert(plan_optimize(&plan) == 0);
+
+  plan_cleanup(&plan);
+}
+
+static void test_plan_optimize_keeps_owned_effects(void) {
+  plan_t plan = {0};
+
+  restack_item_t items[] = {{.window = 1, .sibling = 2}};
+  push_configure(&plan, 1, 0);
+  plan_push_restack_effect(&plan, items, 1);
+  plan_push_map_effect(&plan, 1);
+  plan_push_unmap_effect(&plan, 1);
+
+  assert(plan_optimize(&plan) == 3);
+  assert(plan.count == 1);
+  assert(plan.effects[0].type == ZDWM_EFFECT_RESTACK_WINDOWS);
+  assert(plan.effects[0].as.restack_windows.items[0].window == 1);
+
+  /* 堆内存仍由保留下来的副作用持有，reset 时释放 */
+  plan_reset(&plan);
+  assert(plan.count == 0);
+  plan_cleanup(&plan);
+}
+
+int main(void) {
+  test_plan_optimize_empty();
+  test_plan_optimize_map_pairs();
+  test_plan_optimize_last_writes();
+  test_plan_optimize_keeps_owned_effects();
+  return 0;
+}
@@ -0,0 +1,116 @@
+#define _GNU_SOURCE /* open_memstream */
+
+#include "core/runtime.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend/replay/replay.h"
+#include "base/memory.h"
+#include "core/backend.h"
+#include "core/layout.h"
+#include "core/state.h"
+#include "core/types.h"
+#include "core/wm_desc.h"
+#include "layouts/fair.h"
+
+enum { WORKSPACE_COUNT = 2 };
+
+static const layout_id_t layout_ids[] = {0};
+
+static void test_add_window(
+  state_t *state,
+  window_id_t id,
+  workspace_id_t workspace_id
+) {
+  window_info_t info = {.id = id, .layer_type = ZDWM_WINDOW_LAYER_NORMAL};
+  assert(state_window_add(state, &info));
+  state_window_set_workspace(state, id, workspace_id);
+}
+
+static bool test_runtime_init(runtime_t *runtime, backend_t *backend) {
+  workspace_desc_t *workspaces = p_new(workspace_desc_t, WORKSPACE_COUNT);
+  for (size_t i = 0; i < WORKSPACE_COUNT; ++i) {
+    workspaces[i] = (workspace_desc_t){
+      .output_index      = 0,
+      .name              = p_strdup("test"),
+      .layout_ids        = p_copy(layout_ids, 1),
+      .layout_count      = 1,
+      .initial_layout_id = 0,
+    };
+  }
+
+  backend_detect_t *detect = backend_detect(backend);
+  runtime_init_desc_t desc = {
+    .backend         = backend,
+    .outputs         = detect->outputs,
+    .output_count    = detect->output_count,
+    .workspaces      = workspaces,
+    .workspace_count = WORKSPACE_COUNT,
+  };
+  layout_register(&desc.layouts, "fair", "[F]", nullptr, fair);
+
+  bool inited = runtime_init(runtime, &desc);
+  runtime_init_desc_cleanup(&desc);
+  backend_detect_destroy(detect);
+  return inited;
+}
+
+/* 上一个进程：建立窗口后写入检查点 */
+static void test_checkpoint_prepare(void) {
+  runtime_t runtime = {0};
+  assert(test_runtime_init(&runtime, replay_backend_create_from_text("", 0)));
+
+  auto state = &runtime.state;
+  test_add_window(state, 0x1, 0);
+  test_add_window(state, 0x2, 0);
+  test_add_window(state, 0x3, 1);
+  state_window_set_minimized(state, 0x2, true);
+  assert(runtime_checkpoint(&runtime) >= 0);
+  runtime_shutdown(&runtime);
+}
+
+static void test_restore_drops_vanished_hidden_window(void) {
+  test_checkpoint_prepare();
+
+  /* 隐藏 workspace 上的窗口在重启期间被销毁，backend 订阅失败后报告移除 */
+  const char trace[] = "remove 0x3 destroy\n";
+  backend_t *backend = replay_backend_create_from_text(trace, strlen(trace));
+  char *text         = nullptr;
+  size_t size        = 0;
+  FILE *out          = open_memstream(&text, &size);
+  runtime_t runtime  = {0};
+  assert(backend && out);
+  replay_backend_record(backend, out);
+  assert(test_runtime_init(&runtime, backend));
+
+  assert(runtime_restore(&runtime));
+  assert(state_window_count(&runtime.state) == 3);
+  fflush(out);
+
+  /* 每个窗口都重新订阅，只有可见且未最小化的窗口被映射 */
+  assert(strstr(text, "\nwatch 0x1\n"));
+  assert(strstr(text, "\nwatch 0x2\n"));
+  assert(strstr(text, "\nwatch 0x3\n"));
+  assert(strstr(text, "\nmap 0x1\n"));
+  assert(!strstr(text, "\nmap 0x2\n"));
+  assert(!strstr(text, "\nmap 0x3\n"));
+
+  runtime_run(&runtime);
+  assert(state_window_count(&runtime.state) == 2);
+  assert(!state_window_get(&runtime.state, 0x3));
+  assert(state_window_get(&runtime.state, 0x1));
+  assert(state_window_get(&runtime.state, 0x2)->minimized);
+
+  runtime_shutdown(&runtime);
+  fclose(out);
+  free(text);
+}
+
+int main(void) {
+  test_restore_drops_vanished_hidden_window();
+  return 0;
+}
@@ -0,0 +1,475 @@
+#include "core/state.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "base/memory.h"
+#include "base/string_pool.h"
+#include "core/checkpoint.h"
+#include "core/snapshot.h"
+#include "core/types.h"
+#include "core/window.h"
+#include "core/wm_desc.h"
+
+static const layout_id_t layout_ids[] = {0};
+
+static void test_state_init(state_t *state, size_t workspace_count) {
+  output_info_t output = {
+    .name     = "test",
+    .geometry = {.x = 0, .y = 0, .width = 1920, .height = 1080},
+  };
+
+  workspace_desc_t workspaces[workspace_count];
+  for (size_t i = 0; i < workspace_count; ++i) {
+    workspaces[i] = (workspace_desc_t){
+      .output_index      = 0,
+      .name              = "test",
+      .layout_ids        = layout_ids,
+      .layout_count      = 1,
+      .initial_layout_id = 0,
+    };
+  }
+
+  state_init(state, &output, 1, workspaces, workspace_count);
+}
+
+static void
+test_add_window(state_t *state, window_id_t id, window_id_t transient_for) {
+  window_info_t info = {
+    .id            = id,
+    .transient_for = transient_for,
+    .layer_type    = ZDWM_WINDOW_LAYER_NORMAL,
+  };
+  assert(state_window_add(state, &info));
+  state_window_set_workspace(state, id, 0);
+}
+
+static void test_window_handles_survive_other_removals(void) {
+  state_t state = {0};
+  test_state_init(&state, 1);
+
+  for (window_id_t id = 1; id <= 64; ++id) test_add_window(&state, id, 0);
+
+  window_handle_t handle = state_window_handle(&state, 40);
+  assert(state_window_resolve(&state, handle)->id == 40);
+
+  for (window_id_t id = 1; id <= 64; id += 2) state_window_remove(&state, id);
+  for (window_id_t id = 100; id < 132; ++id) test_add_window(&state, id, 0);
+
+  assert(state_window_count(&state) == 64);
+  assert(state_window_resolve(&state, handle)->id == 40);
+  assert(!state_window_resolve(&state, (window_handle_t){0}));
+
+  state_window_remove(&state, 40);
+  assert(!state_window_resolve(&state, handle));
+
+  /* slot 复用后旧句柄仍然无效 */
+  test_add_window(&state, 200, 0);
+  assert(!state_window_resolve(&state, handle));
+
+  state_cleanup(&state);
+}
+
+static void test_window_iteration_keeps_insert_order(void) {
+  state_t state = {0};
+  test_state_init(&state, 1);
+
+  for (window_id_t id = 1; id <= 5; ++id) test_add_window(&state, id, 0);
+  state_window_remove(&state, 2);
+  state_window_remove(&state, 4);
+  test_add_window(&state, 6, 0);
+
+  static const window_id_t expected[] = {1, 3, 5, 6};
+  size_t count                        = 0;
+  for (auto window = state_window_first(&state); window;
+       window = state_window_next(&state, window)) {
+    assert(window->id == expected[count]);
+    count++;
+  }
+  assert(count == 4);
+
+  state_cleanup(&state);
+}
+
+static void test_window_add_rejects_invalid_id(void) {
+  state_t state = {0};
+  test_state_init(&state, 1);
+
+  window_info_t info = {.id = ZDWM_WINDOW_ID_INVALID, .title = "none"};
+  assert(!state_window_add(&state, &info));
+  assert(state_window_count(&state) == 0);
+  assert(!state_window_first(&state));
+  assert(!layer_stack_top(&state.stacks[ZDWM_WINDOW_LAYER_NORMAL]));
+
+  state_cleanup(&state);
+}
+
+static void test_window_remove_clears_transient_children(void) {
+  state_t state = {0};
+  test_state_init(&state, 1);
+
+  test_add_window(&state, 1, 0);
+  test_add_window(&state, 2, 1);
+  test_add_window(&state, 3, 1);
+  test_add_window(&state, 4, 3);
+  /* 父窗口未被管理时不记录 transient_for */
+  test_add_window(&state, 5, 99);
+
+  assert(state_window_get(&state, 2)->transient_for == 1);
+  assert(state_window_get(&state, 5)->transient_for == 0);
+
+  state_window_remove(&state, 1);
+  assert(state_window_get(&state, 2)->transient_for == 0);
+  assert(state_window_get(&state, 3)->transient_for == 0);
+  assert(state_window_get(&state, 4)->transient_for == 3);
+
+  state_window_remove(&state, 4);
+  state_window_remove(&state, 3);
+  assert(state_window_count(&state) == 2);
+
+  state_cleanup(&state);
+}
+
+static size_t test_workspace_window_ids(
+  const state_t *state,
+  workspace_id_t workspace_id,
+  window_id_t *out
+) {
+  size_t count = 0;
+  for (auto window = state_workspace_window_first(state, workspace_id); window;
+       window = state_workspace_window_next(state, window)) {
+    assert(window->workspace_id == workspace_id);
+    out[count++] = window->id;
+  }
+  assert(count == state_workspace_get(state, workspace_id)->window_count);
+  return count;
+}
+
+static void test_workspace_membership_follows_moves(void) {
+  state_t state = {0};
+  test_state_init(&state, 2);
+
+  for (window_id_t id = 1; id <= 4; ++id) test_add_window(&state, id, 0);
+  state_window_set_workspace(&state, 2, 1);
+  state_window_set_workspace(&state, 4, 1);
+  state_window_remove(&state, 1);
+
+  window_id_t ids[4] = {0};
+  assert(test_workspace_window_ids(&state, 0, ids) == 1);
+  assert(ids[0] == 3);
+  assert(test_workspace_window_ids(&state, 1, ids) == 2);
+  assert(ids[0] == 2 && ids[1] == 4);
+
+  state_window_set_workspace(&state, 2, 0);
+  assert(test_workspace_window_ids(&state, 0, ids) == 2);
+  assert(ids[0] == 3 && ids[1] == 2);
+  assert(test_workspace_window_ids(&state, 1, ids) == 1);
+  assert(ids[0] == 4);
+
+  state_cleanup(&state);
+}
+
+static void test_stack_raise_lower_report_single_move(void) {
+  state_t state = {0};
+  test_state_init(&state, 1);
+
+  for (window_id_t id = 1; id <= 4; ++id) test_add_window(&state, id, 0);
+  window_info_t dock = {.id = 10, .layer_type = ZDWM_WINDOW_LAYER_TOP};
+  assert(state_window_add(&state, &dock));
+
+  restack_item_t move = {0};
+  assert(state_stack_raise(&state, 2, &move));
+  assert(move.window == 2 && move.sibling == 4);
+  assert(!state_stack_raise(&state, 2, &move));
+
+  assert(state_stack_lower(&state, 3, &move));
+  assert(move.window == 3 && window_id_invalid(move.sibling));
+
+  /* 层底窗口以更低层的最高窗口为参照 */
+  assert(state_stack_lower(&state, 10, nullptr) == false);
+  assert(state_stack_place(&state, 10, &move));
+  assert(move.window == 10 && move.sibling == 2);
+
+  /* 层内顺序（自底向顶）：3 1 4 2 */
+  state_window_remove(&state, 2);
+  assert(state_stack_place(&state, 10, &move) && move.sibling == 4);
+  assert(state_stack_place(&state, 1, &move) && move.sibling == 3);
+
+  state_cleanup(&state);
+}
+
+static void test_window_attrs_are_interned(void) {
+  state_t state = {0};
+  test_state_init(&state, 1);
+
+  window_info_t info = {.id = 7, .class_name = "term", .title = "shell"};
+  assert(state_window_add(&state, &info));
+  info = (window_info_t){.id = 8, .class_name = "term"};
+  assert(state_window_add(&state, &info));
+
+  const char *class_name = state_window_attrs(&state, 7)->class_name;
+  assert(strcmp(class_name, "term") == 0);
+  assert(state_window_attrs(&state, 8)->class_name == class_name);
+  assert(string_pool_refcount(class_name) == 2);
+
+  window_metadata_t change = {
+    .title      = p_strdup("vim"),
+    .class_name = p_strdup("editor"),
+  };
+  auto flags = ZDWM_WINDOW_METADATA_CHANGE_TITLE |
+               ZDWM_WINDOW_METADATA_CHANGE_CLASS;
+  assert(state_window_take_metadata(&state, 7, &change, flags));
+  assert(!change.title && !change.class_name);
+  assert(strcmp(state_window_attrs(&state, 7)->title, "vim") == 0);
+  assert(string_pool_refcount(class_name) == 1);
+
+  /* slot 复用时不残留上一个窗口的元数据 */
+  state_window_remove(&state, 7);
+  state_window_remove(&state, 8);
+  assert(!state_window_attrs(&state, 7));
+  assert(state.strings.count == 0);
+  test_add_window(&state, 9, 0);
+  assert(!state_window_attrs(&state, 9)->class_name);
+
+  state_cleanup(&state);
+}
+
+static void test_focus_falls_back_through_mru(void) {
+  state_t state = {0};
+  test_state_init(&state, 2);
+
+  for (window_id_t id = 1; id <= 4; ++id) test_add_window(&state, id, 0);
+  state_workspace_set_focused_window(&state, 0, 3);
+  state_workspace_set_focused_window(&state, 0, 1);
+  state_workspace_set_focused_window(&state, 0, 4);
+
+  /* 焦点历史：4 1 3 2 */
+  const workspace_t *workspace = state_workspace_get(&state, 0);
+  assert(state_workspace_mru_previous(&state, 0) == 1);
+
+  state_window_remove(&state, 4);
+  assert(workspace->focused_window_id == 1);
+
+  state_window_set_workspace(&state, 1, 1);
+  assert(workspace->focused_window_id == 3);
+  assert(state_workspace_get(&state, 1)->focused_window_id == 1);
+
+  /* 轮换：3 2 -> 2 3 -> 3 2 */
+  assert(state_workspace_mru_rotate(&state, 0) == 2);
+  state_workspace_set_focused_window(&state, 0, 2);
+  assert(state_workspace_mru_rotate(&state, 0) == 3);
+  assert(state_workspace_mru_rotate(&state, 1) == ZDWM_WINDOW_ID_INVALID);
+
+  state_window_remove(&state, 2);
+  state_window_remove(&state, 3);
+  assert(workspace->focused_window_id == ZDWM_WINDOW_ID_INVALID);
+  assert(state_workspace_mru_previous(&state, 0) == ZDWM_WINDOW_ID_INVALID);
+
+  state_cleanup(&state);
+}
+
+static void test_snapshot_outlives_state_changes(void) {
+  state_t state = {0};
+  test_state_init(&state, 2);
+
+  snapshot_publisher_t publisher;
+  snapshot_publisher_init(&publisher);
+  assert(!snapshot_publisher_acquire(&publisher));
+
+  window_info_t info = {.id = 1, .class_name = "term", .title = "shell"};
+  assert(state_window_add(&state, &info));
+  state_window_set_workspace(&state, 1, 1);
+  test_add_window(&state, 2, 0);
+  test_add_window(&state, 3, 0);
+  state_workspace_set_focused_window(&state, 0, 3);
+  snapshot_publisher_publish(&publisher, &state);
+
+  state_snapshot_t *snapshot = snapshot_publisher_acquire(&publisher);
+  assert(snapshot && snapshot->sequence == 1);
+  assert(snapshot->output_count == 1 && snapshot->workspace_count == 2);
+  assert(snapshot->window_count == 3);
+  assert(snapshot->focused_window_id == 3);
+
+  const snapshot_workspace_t *workspace = &snapshot->workspaces[0];
+  assert(workspace->window_count == 2);
+  assert(snapshot->windows[workspace->window_offset].window.id == 2);
+  workspace = &snapshot->workspaces[1];
+  const snapshot_window_t *window = &snapshot->windows[workspace->window_offset];
+  assert(workspace->window_count == 1 && window->window.id == 1);
+  assert(strcmp(window->class_name, "term") == 0);
+  assert(window->class_name != state_window_attrs(&state, 1)->class_name);
+
+  /* 旧快照在 state 变化和新快照发布后保持不变 */
+  state_window_remove(&state, 1);
+  state_window_remove(&state, 3);
+  snapshot_publisher_publish(&publisher, &state);
+  assert(snapshot->window_count == 3);
+  assert(strcmp(window->title, "shell") == 0);
+
+  state_snapshot_t *latest = snapshot_publisher_acquire(&publisher);
+  assert(latest->sequence == 2 && latest->window_count == 1);
+  assert(latest->focused_window_id == 2);
+
+  /* 有读者正在 acquire 时，被替换的快照推迟到它离开之后的发布再释放 */
+  auto acquiring = &publisher.acquiring[atomic_load(&publisher.epoch) & 1];
+  atomic_fetch_add(acquiring, 1);
+  snapshot_publisher_publish(&publisher, &state);
+  assert(publisher.retired_count == 1 && publisher.retired[0] == latest);
+  assert(atomic_load(&latest->refcount) == 2);
+  snapshot_publisher_publish(&publisher, &state);
+  assert(publisher.retired_count == 2);
+  atomic_fetch_sub(acquiring, 1);
+  snapshot_publisher_publish(&publisher, &state);
+  assert(publisher.retired_count == 0);
+  assert(atomic_load(&latest->refcount) == 1);
+
+  state_snapshot_release(snapshot);
+  state_snapshot_release(latest);
+  snapshot_publisher_cleanup(&publisher);
+  state_cleanup(&state);
+}
+
+static void test_layout_mutators_mark_dirty(void) {
+  state_t state = {0};
+  test_state_init(&state, 2);
+  const workspace_t *workspace = state_workspace_get(&state, 0);
+
+  test_add_window(&state, 1, 0);
+  assert(workspace->dirty && state_output_need_relayout(&state, 0));
+  state_clear_dirty(&state);
+  assert(!state_output_need_relayout(&state, 0));
+
+  /* 不影响布局或没有实际变化的更新不标记 */
+  state_window_set_frame_rect(&state, 1, (rect_t){.width = 10, .height = 10});
+  state_window_set_urgent(&state, 1, true);
+  state_window_set_floating(&state, 1, false);
+  assert(!workspace->dirty);
+
+  state_window_set_fixed_size(&state, 1, true);
+  assert(workspace->dirty);
+  state_clear_dirty(&state);
+  state_window_set_fullscreen(&state, 1, true);
+  assert(workspace->dirty);
+  state_clear_dirty(&state);
+
+  /* 隐藏的 workspace 变化不影响当前 output */
+  state_window_set_workspace(&state, 1, 1);
+  assert(workspace->dirty && state_workspace_get(&state, 1)->dirty);
+  state_clear_dirty(&state);
+  state_window_set_border_width(&state, 1, 2);
+  assert(state_workspace_get(&state, 1)->dirty);
+  assert(!state_output_need_relayout(&state, 0));
+
+  assert(state_output_set_current_workspace(&state, 0, 1, nullptr));
+  assert(state.outputs[0].dirty);
+  state_clear_dirty(&state);
+  state_output_set_workarea(&state, 0, state.outputs[0].workarea);
+  assert(!state_output_need_relayout(&state, 0));
+
+  /* 已存在的窗口再次加入：只有参与布局的字段变化时才标记 */
+  state_clear_dirty(&state);
+  const window_t *window = state_window_get(&state, 1);
+  window_info_t info     = {
+    .id         = 1,
+    .frame_rect = window->frame_rect,
+    .layer_type = window->layer,
+    .fullscreen = true,
+    .fixed_size = true,
+  };
+  assert(state_window_add(&state, &info) == window);
+  assert(!state_workspace_get(&state, 1)->dirty);
+  info.minimized = true;
+  assert(state_window_add(&state, &info) == window);
+  assert(state_workspace_get(&state, 1)->dirty);
+  state_clear_dirty(&state);
+  info.frame_rect.x = 5;
+  state_window_add(&state, &info);
+  assert(state_workspace_get(&state, 1)->dirty);
+
+  state_cleanup(&state);
+}
+
+static void test_checkpoint_round_trip(void) {
+  state_t state = {0};
+  test_state_init(&state, 2);
+
+  window_info_t info = {.id = 1, .class_name = "term", .title = "shell"};
+  assert(state_window_add(&state, &info));
+  state_window_set_workspace(&state, 1, 0);
+  for (window_id_t id = 2; id <= 4; ++id) test_add_window(&state, id, 1);
+  test_add_window(&state, 5, 0);
+  state_window_set_workspace(&state, 3, 1);
+  state_window_set_floating(&state, 4, true);
+  state_window_set_float_rect(&state, 4, (rect_t){1, 2, 300, 200});
+  state_window_set_border_width(&state, 2, 3);
+  state_stack_raise(&state, 2, nullptr);
+  state_workspace_set_focused_window(&state, 0, 4);
+  state_workspace_set_focused_window(&state, 0, 2);
+  assert(state_output_set_current_workspace(&state, 0, 1, nullptr));
+
+  FILE *file = tmpfile();
+  int fd     = fileno(file);
+  assert(state_checkpoint_write(&state, fd));
+
+  state_t restored = {0};
+  test_state_init(&restored, 2);
+  lseek(fd, 0, SEEK_SET);
+  assert(state_checkpoint_read(&restored, fd));
+
+  assert(state_window_count(&restored) == 5);
+  assert(restored.outputs[0].current_workspace_id == 1);
+  for (workspace_id_t id = 0; id < 2; ++id) {
+    auto a = state_workspace_window_first(&state, id);
+    auto b = state_workspace_window_first(&restored, id);
+    for (; a && b; a = state_workspace_window_next(&state, a),
+                   b = state_workspace_window_next(&restored, b)) {
+      assert(memcmp(a, b, sizeof(*a)) == 0);
+    }
+    assert(!a && !b);
+  }
+  auto stack_a = &state.stacks[ZDWM_WINDOW_LAYER_NORMAL];
+  auto stack_b = &restored.stacks[ZDWM_WINDOW_LAYER_NORMAL];
+  for (window_id_t a = layer_stack_top(stack_a), b = layer_stack_top(stack_b);
+       a || b;
+       a = layer_stack_below(stack_a, a), b = layer_stack_below(stack_b, b)) {
+    assert(a == b);
+  }
+  assert(state_workspace_get(&restored, 0)->focused_window_id == 2);
+  assert(state_workspace_mru_previous(&restored, 0) == 4);
+  assert(state_window_get(&restored, 2)->transient_for == 1);
+  assert(strcmp(state_window_attrs(&restored, 1)->title, "shell") == 0);
+
+  /* 负载损坏时拒绝加载且不修改 state */
+  state_t rejected = {0};
+  test_state_init(&rejected, 2);
+  lseek(fd, 40, SEEK_SET);
+  assert(write(fd, "x", 1) == 1);
+  lseek(fd, 0, SEEK_SET);
+  assert(!state_checkpoint_read(&rejected, fd));
+  assert(state_window_count(&rejected) == 0);
+
+  fclose(file);
+  state_cleanup(&rejected);
+  state_cleanup(&restored);
+  state_cleanup(&state);
+}
+
+int main(void) {
+  test_window_handles_survive_other_removals();
+  test_window_iteration_keeps_insert_order();
+  test_window_add_rejects_invalid_id();
+  test_window_remove_clears_transient_children();
+  test_workspace_membership_follows_moves();
+  test_stack_raise_lower_report_single_move();
+  test_window_attrs_are_interned();
+  test_focus_falls_back_through_mru();
+  test_snapshot_outlives_state_changes();
+  test_layout_mutators_mark_dirty();
+  test_checkpoint_round_trip();
+  return 0;
+}